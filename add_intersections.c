@@ -4,24 +4,52 @@
     $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
     
     - Compilation:
-        >> gcc -o add_int -W -Wall -Werror add_intersections.c libs/graph_management.c libs/intersections.c -lm
+        >> gcc -o add_int -W -Wall -Werror add_intersections.c libs/graph_management.c libs/intersections.c libs/sweep_line.c libs/segment_kernel.c -lm -lpthread
 
     - Usage:
-        >> ./add_int stored_graph.bin data_output.bin counter_filename.txt
+        >> ./add_int stored_graph.bin data_output.bin counter_filename.txt (+ engine cell_size_in_degrees nthreads checkpoint.bin checkpoint_interval_in_s)
 
     - Output:
         >> The graph that is stored in data_output.bin.
         >> The counter of intersections per each path in counter_filename.txt
+        >> The summary of the telemetry in counter_filename_telemetry.csv
 
     - Comments:
         >> This program opens a stored graph in a binary file and appends the intersections between edges as new nodes.
         >> The id of each node is assigned by order of appearance. Thus, they are stored in an array in the position corresponding to their id.
         >> The edges are unidirectional.
-        >> The intersections type 1 are implemented once they are detected. 
+        >> Every engine finds the intersections of the original edges and splices them at the end, so all of them give the same graph.
+            The edges that cross (type 1) get a new node, and the ones that touch or overlap (types 2 to 17) are counted as touching.
+        >> The engine selects how the pairs of edges to check are found:
+            >> 0: Nested loop. Every edge of a path is compared with every edge of the other.
+            >> 1: Uniform grid (default). Only the pairs of edges that share a cell are checked, in the same order as
+                comparing all of them, so the crossings are the same. The cell size is chosen automatically
+                as the mean size of the edges unless cell_size is given.
+            >> 2: Sweep line. All the intersections of the original edges are found at once with the Bentley-Ottmann algorithm
+                and spliced at the end. The pairs of edges that do not intersect are not tested, so the ignored ones are not counted.
+            >> 3: Parallel grid. The crossings of the original edges are found with the uniform grid by nthreads threads
+                (all the processors by default), each one taking the next path 1 to compute. They are merged by path 1
+                and spliced at the end, so the resulting graph does not depend on the number of threads and is the same as with 1.
+            >> 4: Vectorised loop. The hierarchies of bounding boxes of both paths are descended at once, and every original
+                edge of an overlapping run of a path is compared with the run of the other one, stored contiguously,
+                several at once with SIMD instructions (add -mavx2 to the compilation to test 4 at once).
+                Only the few pairs that pass the filter are classified. The crossings are spliced at the end.
+        >> With a checkpoint filename, the engines 0 and 1 store their progress in it every checkpoint_interval seconds
+            (600 by default): the graph, the intersections found so far, the intersections per path, the first path 1
+            not computed yet and the number of nodes before the computation, so only the original edges are indexed when resuming. If the file exists when the program starts, the computation is resumed from it and the result is
+            the same as without interruption. The file is removed once the graph is stored.
+        >> The new nodes take their edges and path nodes from arenas, freed at once at the end.
+        >> The progress is reported every second: the work done, the time left, estimated from the pairs of original edges
+            of the paths not computed yet, and the pairs of paths examined and pruned, the pairs of edges tested, the
+            intersections found and the memory allocated, counted by every thread apart. They are stored in a csv file at the end.
+        >> The crossings are spliced at once: every crossed edge is split in all its pieces
+            in a single pass and the nodes array is reallocated only once.
+        >> In the same splice, an edge that touches or overlaps another one is split at the endpoints of the other edge that
+            lie inside it, which get a new edge, and the coincident nodes of different paths are linked both ways by edges of
+            no travelling time, so no new nodes are created for them.
 
     
     - Further development:
-        >> Sort by coordinates the nodes and identify intersections with a Sweep line algorithm.
 
     - Status:
         >> Finished
@@ -33,82 +61,88 @@
 #include <string.h>
 #include <math.h>
 #include "libs/graph_management.h"
+#include "libs/sweep_line.h"
 #include "libs/intersections.h"
 
 int main (int argc, char *argv[]) {
     if (argc < 4) ExitError("Inputs missing to the program", 1);
 
-    // 1. Read the binary file
+    // 1. Read the binary file, or the checkpoint if there is one
     printf("Reading bin file...\n");
 
     Node *nodes;
     Path *paths;
     unsigned long nnodes, nedges, npaths;
     char *bin_filename;
+    Intersections_checkpoint checkpoint;
+    FILE *checkpoint_file;
+    char *end_ptr;
+    int engine, nthreads;
+    double cell_size;
+
+    engine = Uniform_grid;
+    cell_size = 0.;
+    nthreads = 0;
+    if (argc > 4) engine = (int) strtol(argv[4], &end_ptr, 10);
+    if (argc > 5) cell_size = strtod(argv[5], &end_ptr);
+    if (argc > 6) nthreads = (int) strtol(argv[6], &end_ptr, 10);
+    if (engine < Nested_loop || engine > Vector_loop) ExitError("the engine must be 0, 1, 2, 3 or 4", 7);
+
+    // The summary of the telemetry is stored next to the counter, replacing its extension
+    Intersections_telemetry telemetry;
+    char *extension;
+
+    telemetry.interval = 1.;
+    telemetry.filename = (char *) malloc(strlen(argv[3]) + strlen("_telemetry.csv") + 1);
+    if (telemetry.filename == NULL) ExitError("when allocating memory for the telemetry filename", 10);
+    strcpy(telemetry.filename, argv[3]);
+    extension = strrchr(telemetry.filename, '.');
+    if (extension != NULL && strchr(extension, '/') == NULL) *extension = '\0';
+    strcat(telemetry.filename, "_telemetry.csv");
+
+    checkpoint.filename = NULL;
+    checkpoint.interval = 600.;
+    checkpoint.first_path = 0;
+    checkpoint.nnodes = 0;
+    checkpoint.crossings = NULL;
+    checkpoint.ncrossings = 0;
+    if (argc > 7) {
+        if (engine > Uniform_grid) ExitError("the checkpoints are only available with the engines 0 and 1", 8);
+        checkpoint.filename = strdup(argv[7]);
+        if (checkpoint.filename == NULL) ExitError("when copying the checkpoint filename", 9);
+        if (argc > 8) checkpoint.interval = strtod(argv[8], &end_ptr);
+    }
 
-    
     nodes = NULL;
     paths = NULL;
     bin_filename = strdup(argv[1]);
     if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
-    read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
+    checkpoint_file = checkpoint.filename != NULL ? fopen(checkpoint.filename, "rb") : NULL;
+    if (checkpoint_file != NULL) {
+        fclose(checkpoint_file);
+        printf("Resuming from %s...\n", checkpoint.filename);
+        read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, checkpoint.filename);
+    } else read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
 
     // 2. Compute intersections
     printf("Computing intersections...\n");
 
-    unsigned long i_path_1, i_path_2, initial_path_2;
-    unsigned short compute_paths;
-    Path_node *p1, *p2, *q1, *q2;
-    unsigned long i_path_p1;
-    unsigned short intersection_type;
-    double t, u;
-    unsigned long intersections_computed, intersections_ignored, max_nnodes;
+    unsigned long i_path_1;
     unsigned long *int_per_path;
+    Intersections_counter counter;
+    Intersections_arena arena;
 
-    int_per_path = (unsigned long *) malloc(npaths * sizeof(unsigned long));
+    int_per_path = (unsigned long *) malloc((npaths ? npaths : 1) * sizeof(unsigned long));
     if (int_per_path == NULL) ExitError("when allocating memory for int_per_path", 3);
-    for (i_path_1 = 0; i_path_1 < npaths; i_path_1++) int_per_path[i_path_1] = 0;
-
-    intersections_computed = 0;
-    intersections_ignored = 0;
-    max_nnodes = nnodes;
-    for (i_path_1 = 0; i_path_1 < npaths - 1; i_path_1++) {
-        printf("\rPath 1: %lu out of %lu", i_path_1, npaths);
-        if (paths[i_path_1].npaths) initial_path_2 = paths[i_path_1].npaths + 1;
-        else initial_path_2 = i_path_1 + 1;
-        if (initial_path_2 > npaths) break;
-        for (i_path_2 = initial_path_2; i_path_2 < npaths; i_path_2++) {
-            // 2.1. Check whether it is necessary or not to compute these pair of paths
-            compute_paths = need_compute_paths(paths, i_path_1, i_path_2);
-            if (compute_paths == 0) continue;
-
-            // 2.2. Select edges p1-q1 and p2-q2 to compute
-            p1 = &paths[i_path_1].start_node;
-            for (i_path_p1 = 0; i_path_p1 < paths[i_path_1].len - 1; i_path_p1++) {
-                q1 = p1->next;
-                for (p2 = &paths[i_path_2].start_node; p2->next != NULL; p2 = q2) {
-                    q2 = p2->next;
-                    intersection_type = identify_intersection(&nodes[p1->node_id], &nodes[q1->node_id], &nodes[p2->node_id], &nodes[q2->node_id], &t, &u);
-                    if (intersection_type != 1) {
-                        if (intersection_type >1) {
-                            intersections_ignored++;
-                        }
-                    } else {
-                        add_intersection(&nodes, &nnodes, &max_nnodes, &nedges, p1->node_id, q1->node_id, p2->node_id, q2->node_id, 
-                                        intersection_type, t, u, paths, i_path_1, i_path_2, p1, p2);
-
-                        intersections_computed++;
-                        int_per_path[i_path_1]++;
-                        int_per_path[i_path_2]++;
-                        q1 = p1->next;
-                    }
-                }
-                p1 = p1->next;
-            }
-            checked_paths(paths, i_path_1, i_path_2);
-        }
-    }
-    printf("\nComputed intersections: %lu\nIgnored intersections: %lu\n", intersections_computed, intersections_ignored);
+    if (checkpoint_file != NULL && read_checkpoint(&checkpoint, npaths, engine, int_per_path, &counter))
+        printf("Starting at path 1: %lu out of %lu\n", checkpoint.first_path, npaths);
+
+    compute_intersections(&nodes, &nnodes, &nedges, paths, npaths, engine, cell_size, nthreads, int_per_path, &counter, &arena,
+                        checkpoint.filename != NULL ? &checkpoint : NULL, &telemetry);
+    printf("Computed intersections: %lu\nTouching intersections: %lu\nIgnored intersections: %lu\n", counter.computed, counter.touching,
+            counter.ignored);
+    printf("Pairs of paths computed: %lu out of %lu (%.2f %% pruned)\n", counter.pairs_computed, counter.pairs_checked,
+            counter.pairs_checked ? 100. * (double) (counter.pairs_checked - counter.pairs_computed) / (double) counter.pairs_checked : 0.);
 
     // 3. Store in a new binary file
     printf("Storing graph...\n");
@@ -137,8 +171,19 @@ int main (int argc, char *argv[]) {
     // 5. Free allocated memory
     printf("Freeing memory...\n");
 
+    release_intersections(nodes, nnodes, paths, npaths, &arena);
     free_paths(paths, npaths);
     free_nodes(nodes, nnodes);
+    free(int_per_path);
+    free(bin_filename);
+    free(bin_new_filename);
+    free(counter_filename);
+    free(telemetry.filename);
+    if (checkpoint.filename != NULL) {
+        remove(checkpoint.filename);
+        free(checkpoint.filename);
+        free(checkpoint.crossings);
+    }
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$    APPEND_PATHS.C VERSION 1.0    $$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    
+    - Compilation:
+        >> gcc -o append -W -Wall -Werror append_paths.c libs/graph_management.c -lm
+
+    - Usage:
+        >> ./append intersected_graph.bin new_paths_1.bin (+ new_paths_2.bin ...) data_output.bin
+
+    - Output:
+        >> The graph with the new paths appended in data_output.bin
+
+    - Comments:
+        >> This program appends the nodes and paths of one or several stored graphs to an already intersected graph.
+            The ids of the new nodes and paths follow the existing ones.
+        >> Every path of the intersected graph keeps the last path it was checked with, so computing the intersections
+            of the output graph only computes the pairs of paths with a new path: new with old and new with new.
+            With every engine, only the edges of the paths with some pair to compute are processed.
+    
+    - Further development:
+
+    - Status:
+        >> Finished
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libs/graph_management.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 4) ExitError("Inputs missing to the program", 1);
+
+    // 1. Read the intersected graph
+    printf("Reading bin file...\n");
+
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, nedges, npaths, initial_npaths;
+    char *bin_filename;
+
+    nodes = NULL;
+    paths = NULL;
+    bin_filename = strdup(argv[1]);
+    if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
+    read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
+    initial_npaths = npaths;
+
+    // 2. Append the new graphs
+    int i_file;
+    for (i_file = 2; i_file < argc - 1; i_file++) {
+        printf("Appending %s...\n", argv[i_file]);
+        append_graph(&nodes, &paths, &nnodes, &nedges, &npaths, argv[i_file]);
+    }
+    printf("Paths appended: %lu to the %lu existing ones\n", npaths - initial_npaths, initial_npaths);
+
+    // 3. Store in a new binary file
+    printf("Storing graph...\n");
+
+    char *bin_new_filename;
+    bin_new_filename = strdup(argv[argc - 1]);
+    if (bin_new_filename == NULL) ExitError("when copying the binary new filename", 3);
+
+    store_nodes(nodes, paths, nnodes, nedges, npaths, bin_new_filename);
+
+    // 4. Free allocated memory
+    printf("Freeing memory...\n");
+
+    free_paths(paths, npaths);
+    free_nodes(nodes, nnodes);
+    free(bin_filename);
+    free(bin_new_filename);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$    BENCHMARK_INTERSECTIONS.C VERSION 1.0    $$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Compilation:
+        >> gcc -o bench_int -W -Wall -Werror benchmark_intersections.c libs/graph_management.c libs/intersections.c libs/sweep_line.c libs/segment_kernel.c -lm -lpthread
+
+    - Usage:
+        >> ./bench_int benchmark_filename.csv stored_graph_1.bin (+ stored_graph_2.bin ...)
+
+    - Output:
+        >> A row per graph and engine in benchmark_filename.csv
+
+    - Comments:
+        >> This program computes the intersections of every graph with every engine (nested loop, uniform grid,
+            sweep line, parallel grid with all the processors and vectorised loop) and stores the time required and the intersections found, to compare them.
+        >> The graph is read again before every engine, so all of them start from the same state.
+        >> The time is the elapsed (wall clock) time, as the parallel engine uses several processors.
+        >> The density of every graph is described by its number of paths and edges and the percentage of pairs of paths
+            whose bounding boxes overlap. The graphs of every shiptype stored separately by store_exe are good real profiles.
+
+    - Further development:
+
+    - Status:
+        >> Finished.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "libs/graph_management.h"
+#include "libs/sweep_line.h"
+#include "libs/intersections.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 3) ExitError("Inputs missing to the program", 1);
+
+    FILE *benchmark_file;
+    benchmark_file = fopen(argv[1], "w");
+    if (benchmark_file == NULL) ExitError("when opening the benchmark file", 2);
+    fprintf(benchmark_file, "GRAPH,ENGINE,NPATHS,NEDGES,OVERLAPPING PAIRS [%%],TIME [s],COMPUTED,IGNORED,NNODES\n");
+
+    char *engine_names[5] = {"Nested loop", "Uniform grid", "Sweep line", "Parallel grid", "Vectorised loop"};
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, nedges, npaths, initial_nedges;
+    unsigned long *int_per_path;
+    Intersections_counter counter;
+    Intersections_arena arena;
+    int i_graph, engine;
+    struct timespec start_time, end_time;
+    double elapsed_time;
+
+    for (i_graph = 2; i_graph < argc; i_graph++) {
+        for (engine = Nested_loop; engine <= Vector_loop; engine++) {
+            // 1. Read the binary file
+            printf("Reading %s for the %s engine...\n", argv[i_graph], engine_names[engine]);
+            nodes = NULL;
+            paths = NULL;
+            read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, argv[i_graph]);
+            initial_nedges = nedges;
+
+            int_per_path = (unsigned long *) malloc((npaths ? npaths : 1) * sizeof(unsigned long));
+            if (int_per_path == NULL) ExitError("when allocating memory for int_per_path", 3);
+
+            // 2. Compute the intersections
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            compute_intersections(&nodes, &nnodes, &nedges, paths, npaths, engine, 0., 0, int_per_path, &counter, &arena, NULL, NULL);
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+            elapsed_time = (double) (end_time.tv_sec - start_time.tv_sec) + 1e-9 * (double) (end_time.tv_nsec - start_time.tv_nsec);
+
+            printf("%s: %.3f s, %lu intersections computed, %lu touching, %lu ignored\n", engine_names[engine], elapsed_time,
+                    counter.computed, counter.touching, counter.ignored);
+            fprintf(benchmark_file, "%s,%s,%lu,%lu,%g,%g,%lu,%lu,%lu\n", argv[i_graph], engine_names[engine], npaths, initial_nedges,
+                    counter.pairs_checked ? 100. * (double) counter.pairs_computed / (double) counter.pairs_checked : 0.,
+                    elapsed_time, counter.computed, counter.ignored, nnodes);
+
+            // 3. Free allocated memory
+            free(int_per_path);
+            release_intersections(nodes, nnodes, paths, npaths, &arena);
+            free_paths(paths, npaths);
+            free_nodes(nodes, nnodes);
+        }
+    }
+    fclose(benchmark_file);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$    CONSOLIDATE_NODES.C VERSION 1.0    $$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Compilation:
+        >> gcc -o merge_exe -W -Wall -Werror consolidate_nodes.c libs/graph_management.c libs/lanes.c libs/consolidation.c -lm
+
+    - Usage:
+        >> ./merge_exe intersected_graph.bin data_output.bin distance_in_km
+
+    - Output:
+        >> The consolidated graph in data_output.bin
+
+    - Comments:
+        >> This program merges the intersection nodes closer than distance_in_km into a single node.
+            Where many paths cross at nearly the same point, every pair of them creates its own node, so the intersections
+            leave clusters of nodes joined by tiny edges. They are replaced by a node at their centroid.
+        >> The junctions are found through a spatial hash of cells of distance_in_km, so the cost is linear in the number of junctions.
+        >> The edges inside a cluster disappear and the rest are rewired to the new nodes. The travelling time of every path is kept.
+        >> It is meant to be executed on the intersected graph. The output can be used directly by path_exe.
+
+    - Further development:
+
+    - Status:
+        >> Finished.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libs/graph_management.h"
+#include "libs/lanes.h"
+#include "libs/consolidation.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 4) ExitError("Inputs missing to the program", 1);
+
+    // 1. Read the binary file
+    printf("Reading bin file...\n");
+
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, nedges, npaths;
+    char *bin_filename;
+
+    nodes = NULL;
+    paths = NULL;
+    bin_filename = strdup(argv[1]);
+    if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
+    read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
+
+    char *end_ptr;
+    double distance;
+    distance = strtod(argv[3], &end_ptr);
+    if (distance <= 0) ExitError("the distance must be positive", 3);
+
+    // 2. Group the close junctions
+    printf("Clustering junctions...\n");
+
+    int *shiptypes;
+    unsigned long njunctions, nmerged, initial_nnodes, initial_nedges;
+    unsigned long *leader;
+
+    shiptypes = node_shiptypes(nodes, nnodes, paths, npaths, &njunctions);
+    leader = (unsigned long *) malloc((nnodes ? nnodes : 1) * sizeof(unsigned long));
+    if (leader == NULL) ExitError("when allocating memory for the leaders of the clusters", 4);
+    nmerged = cluster_junctions(nodes, nnodes, shiptypes, njunctions, distance, leader);
+    printf("Junctions merged: %lu out of %lu\n", nmerged, njunctions);
+
+    // 3. Merge the clusters
+    printf("Merging clusters...\n");
+
+    initial_nnodes = nnodes;
+    initial_nedges = nedges;
+    merge_clusters(&nodes, &nnodes, &nedges, paths, npaths, leader);
+    printf("Nodes: %lu -> %lu (%.2f %% removed)\n", initial_nnodes, nnodes,
+            initial_nnodes ? 100. * (double) (initial_nnodes - nnodes) / (double) initial_nnodes : 0.);
+    printf("Edges: %lu -> %lu (%.2f %% removed)\n", initial_nedges, nedges,
+            initial_nedges ? 100. * (double) (initial_nedges - nedges) / (double) initial_nedges : 0.);
+
+    // 4. Store the consolidated graph
+    printf("Storing graph...\n");
+
+    char *bin_new_filename;
+    bin_new_filename = strdup(argv[2]);
+    if (bin_new_filename == NULL) ExitError("when copying the binary new filename", 5);
+    store_nodes(nodes, paths, nnodes, nedges, npaths, bin_new_filename);
+
+    // 5. Free allocated memory
+    printf("Freeing memory...\n");
+
+    free(bin_filename);
+    free(bin_new_filename);
+    free(shiptypes);
+    free(leader);
+    free_paths(paths, npaths);
+    free_nodes(nodes, nnodes);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$    LANE_GRAPH.C VERSION 1.0    $$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Compilation:
+        >> gcc -o lane_exe -W -Wall -Werror lane_graph.c libs/graph_management.c libs/lanes.c -lm
+
+    - Usage:
+        >> ./lane_exe data_input.bin data_output.bin cell_size_in_km edge_cost
+
+    - Output:
+        >> The lanes graph in data_output.bin
+
+    - Comments:
+        >> This program snaps the paths to a grid of cells of cell_size km and builds a graph with a node per occupied cell.
+            It is an alternative to the intersections computation: the paths that cross the same cell are connected
+            through its node, so the cost does not grow quadratically with the number of paths.
+        >> All the traversals between two cells are aggregated in a single edge. Its cost is selected with edge_cost:
+            0 for the median time of the traversals and 1 for the minimum one.
+        >> It is meant to be executed on the stored (or filtered) graph. The output can be used directly by path_exe.
+
+    - Further development:
+
+    - Status:
+        >> Finished.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libs/graph_management.h"
+#include "libs/lanes.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 5) ExitError("Inputs missing to the program", 1);
+
+    // 1. Read the binary file
+    printf("Reading bin file...\n");
+
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, nedges, npaths;
+    char *bin_filename;
+
+    nodes = NULL;
+    paths = NULL;
+    bin_filename = strdup(argv[1]);
+    if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
+    read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
+
+    char *end_ptr;
+    double cell_km;
+    int edge_cost;
+    cell_km = strtod(argv[3], &end_ptr);
+    edge_cost = (int) strtol(argv[4], &end_ptr, 10);
+    if (cell_km <= 0) ExitError("the cell size must be positive", 3);
+    if (edge_cost != Median && edge_cost != Min) ExitError("the edge cost must be 0 (median) or 1 (minimum)", 4);
+
+    // 2. Build the lanes graph
+    printf("Building lanes graph...\n");
+
+    Node *lane_nodes;
+    Path *lane_paths;
+    unsigned long lane_nnodes, lane_nedges;
+    build_lane_graph(nodes, paths, nnodes, npaths, cell_km, edge_cost, &lane_nodes, &lane_paths, &lane_nnodes, &lane_nedges);
+
+    printf("Nodes: %lu -> %lu (%.2f %% removed)\n", nnodes, lane_nnodes,
+            nnodes ? 100. * (double) (nnodes - lane_nnodes) / (double) nnodes : 0.);
+    printf("Edges: %lu -> %lu (%.2f %% removed)\n", nedges, lane_nedges,
+            nedges ? 100. * (double) (nedges - lane_nedges) / (double) nedges : 0.);
+
+    // 3. Store the lanes graph
+    printf("Storing graph...\n");
+
+    char *bin_new_filename;
+    bin_new_filename = strdup(argv[2]);
+    if (bin_new_filename == NULL) ExitError("when copying the binary new filename", 5);
+    store_nodes(lane_nodes, lane_paths, lane_nnodes, lane_nedges, npaths, bin_new_filename);
+
+    // 4. Free allocated memory
+    printf("Freeing memory...\n");
+
+    free(bin_filename);
+    free(bin_new_filename);
+    free_paths(lane_paths, npaths);
+    free_nodes(lane_nodes, lane_nnodes);
+    free_paths(paths, npaths);
+    free_nodes(nodes, nnodes);
+    return 0;
+}
@@ -7,14 +7,31 @@
         >> Through the header file "algorithms.h"
 
     - Comments:
-        >> 
+        >> The Binary Heap is a plain array with the slot of every enqueued node indexed by its id, so requeue_bh only
+            heapifies up from that slot instead of searching the node.
+        >> A single AStar runs with every Priority Queue through enqueue_pq, dequeue_pq and requeue_pq, which call the
+            functions of the queue selected by pq_code. A new queue only needs its functions and an entry in them.
+        >> The Lazy Heap has no decrease-key: a requeued node is enqueued again and the outdated elements are skipped when
+            dequeued, so it can hold more elements than nodes. An element is outdated when its stamp is not the last one
+            of its node, since a NaN cost is never equal to itself.
+        >> The Bucket Queue only orders by cost the nodes of the current bucket, in a Binary Heap. The nodes of the later
+            buckets are kept in linked lists, so enqueuing and requeuing them is O(1). Since the split edges and the
+            heuristics have fractional times, quantising f alone would change the order of the nodes of a bucket.
+        >> The heuristics are infinite at the nodes with speed 0, so the costs that are not finite or that are beyond
+            BUCKET_LIMIT buckets go to an overflow list, which is only dequeued once every other bucket is empty.
+        >> The state of the searches is kept in a Search_context allocated once. Every query resets only the nodes touched
+            by the previous one and empties its Priority Queue, so its cost does not depend on the size of the graph.
+        >> run_queries shares the paths between threads that take the next one when they finish, each with its own search
+            context. The times of the metrics are taken from a monotonic clock, since clock() measures the whole process.
+        >> BiAStar alternates a forward search and a backward one over the Reverse_graph, with keys reduced by the average
+            potential (h(v, final) - h(initial, v)) / 2, so both of them see the same edge costs. It stops when the lowest
+            keys of both searches add up to the best path met, and the two halves are joined in the forward solution.
     
     - Further development:
         >> The nodes distance function should take into account Earth geometry.
 
     - Status:
         >> Unfinished. Missing Vintenty formula
-        >> In AStar_ll, I need to free all the linked list of the PQ when finished
         >> Possible little upgrades.
 
     $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
@@ -30,6 +47,8 @@
 #include <time.h>
 #include <float.h>
 #include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "graph_management.h"
 #include "algorithms.h"
@@ -199,367 +218,603 @@ void show_ll(Linked_Element_PQ *PQ, int n, AStarControlData *Queue_control)
 */
 
 bool enqueue_bh(unsigned long node_id, Binary_Heap_PQ *PQ, AStarControlData *Queue_control) {
-    if (PQ->l == 0) {
-        PQ->l++;
-        PQ->r++;
-        PQ->bh_tree[0] = node_id;
-        Queue_control[node_id].InPQ = 1;
-    } else {
-        // If the last level is full, create a new one
-        if (PQ->r == (unsigned long) (1 << (PQ->l - 1))) {
-            PQ->l++;
-            PQ->r = 1;
-        } else {
-            PQ->r++;
-        }
-        unsigned long d, p;
-        d = PQ->l-1;
-        p = PQ->r-1;
-        PQ->bh_tree[dp(d,p)] = node_id;
-        float cost_node = Queue_control[node_id].f;
-        Queue_control[node_id].InPQ = 1;
-        if (cost_node < Queue_control[PQ->bh_tree[parent(d,p)]].f) {
-            heapify_up_bh(PQ, d, p, Queue_control);
-        }
-    }
+    PQ->bh_tree[PQ->size] = node_id;
+    PQ->position[node_id] = PQ->size;
+    PQ->size++;
+    Queue_control[node_id].InPQ = 1;
+    heapify_up_bh(PQ, PQ->size - 1, Queue_control);
     return true;
 }
 
 unsigned long dequeue_bh(Binary_Heap_PQ *PQ, AStarControlData *Queue_control) {
     unsigned long root_node_id = PQ->bh_tree[0];
-    if (PQ->l == 1) {
-        PQ->l--;
-        PQ->r--;
-        return root_node_id;
-    } else {
-        unsigned long d = PQ->l-1;
-        unsigned long p = PQ->r-1;
-        PQ->bh_tree[0] = PQ->bh_tree[dp(d, p)];
-        PQ->r--;
-        if (PQ->r == 0) {
-            PQ->l--;
-            PQ->r = (1 << (PQ->l - 1));
-        }
+    PQ->size--;
+    if (PQ->size > 0) {
+        PQ->bh_tree[0] = PQ->bh_tree[PQ->size];
+        PQ->position[PQ->bh_tree[0]] = 0;
+        heapify_down_bh(PQ, 0, Queue_control);
     }
-    heapify_down_bh(PQ, 0, 0, Queue_control);
     return root_node_id;
 }
 
 void requeue_bh(unsigned long node_id, Binary_Heap_PQ *PQ, AStarControlData *Queue_control) {
-    // We search the position d,p of the node
-    unsigned d, p;
-    for (d = 0; d < PQ->l - 1; d++) {
-        for (p = 0; p <= (unsigned) (1 << (d)) - 1; p++) {
-            if (node_id == PQ->bh_tree[dp(d, p)]) {
-                heapify_up_bh(PQ, d, p, Queue_control);
-                return;
-            }
-        }
+    // The cost only decreases, so the node can only go up from its slot
+    heapify_up_bh(PQ, PQ->position[node_id], Queue_control);
+}
+
+void heapify_up_bh(Binary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control) {
+    // The node is moved up through a hole, and every parent moved down updates its slot
+    unsigned long node_id = PQ->bh_tree[i];
+    double cost = Queue_control[node_id].f;
+    while (i > 0 && cost < Queue_control[PQ->bh_tree[parent_bh(i)]].f) {
+        PQ->bh_tree[i] = PQ->bh_tree[parent_bh(i)];
+        PQ->position[PQ->bh_tree[i]] = i;
+        i = parent_bh(i);
     }
+    PQ->bh_tree[i] = node_id;
+    PQ->position[node_id] = i;
+}
 
-    d = PQ->l - 1;
-    for (p = 0; p <= PQ->r - 1; p++) {
-        if (node_id == PQ->bh_tree[dp(d, p)]) {
-            heapify_up_bh(PQ, d, p, Queue_control);
-            return;
+void heapify_down_bh(Binary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control) {
+    unsigned long node_id = PQ->bh_tree[i];
+    double cost = Queue_control[node_id].f;
+    unsigned long child;
+    while ((child = lchild_bh(i)) < PQ->size) {  // Exists a left child
+        // Take the right child if it exists and is smaller
+        if (child + 1 < PQ->size && Queue_control[PQ->bh_tree[child + 1]].f < Queue_control[PQ->bh_tree[child]].f) child++;
+        if (cost <= Queue_control[PQ->bh_tree[child]].f) break;
+
+        PQ->bh_tree[i] = PQ->bh_tree[child];
+        PQ->position[PQ->bh_tree[i]] = i;
+        i = child;
+    }
+    PQ->bh_tree[i] = node_id;
+    PQ->position[node_id] = i;
+}
+
+void show_bh(Binary_Heap_PQ *PQ, FILE *file, AStarControlData *Queue_control) {
+    // Shows only the first 4 levels
+    unsigned long level, first, i;
+    for (level = 0, first = 0; level < 4 && first < PQ->size; level++, first = 2 * first + 1) {
+        fprintf(file, "Level %lu:", level + 1);
+        for (i = first; i < 2 * first + 1 && i < PQ->size; i++) {
+            fprintf(file, "  %lu (%g)", PQ->bh_tree[i], Queue_control[PQ->bh_tree[i]].f);
         }
+        fprintf(file, "\n");
     }
+    return;
+}
+
+
+/*
+    D-ARY HEAP TREE MANAGEMENT
+*/
+
+bool enqueue_dh(unsigned long node_id, D_ary_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    PQ->tree[PQ->size] = node_id;
+    PQ->position[node_id] = PQ->size;
+    PQ->size++;
+    Queue_control[node_id].InPQ = 1;
+    heapify_up_dh(PQ, PQ->size - 1, Queue_control);
+    return true;
 }
 
-void heapify_up_bh(Binary_Heap_PQ *PQ, unsigned d, unsigned p, AStarControlData *Queue_control) {
-    unsigned aux_node;
-    while (d > 0 && Queue_control[PQ->bh_tree[dp(d, p)]].f < Queue_control[PQ->bh_tree[parent(d, p)]].f) {
-        aux_node = PQ->bh_tree[dp(d, p)];
-        PQ->bh_tree[dp(d, p)] = PQ->bh_tree[parent(d, p)];
-        PQ->bh_tree[parent(d, p)] = aux_node;
-        d = d - 1;
-        p = (int) p / 2;
+unsigned long dequeue_dh(D_ary_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    unsigned long root_node_id = PQ->tree[0];
+    PQ->size--;
+    if (PQ->size > 0) {
+        PQ->tree[0] = PQ->tree[PQ->size];
+        PQ->position[PQ->tree[0]] = 0;
+        heapify_down_dh(PQ, 0, Queue_control);
     }
+    return root_node_id;
 }
 
-void heapify_down_bh(Binary_Heap_PQ *PQ, unsigned d, unsigned p, AStarControlData *Queue_control) {
-    while (d < PQ->l - 1 && ((d == PQ->l - 2) ? (p <= (PQ->r - 1) / 2) : 1)) {  // Exists a left child
-        unsigned long smallest_child_id = PQ->bh_tree[lchild(d, p)];
-        double smallest_cost = Queue_control[PQ->bh_tree[lchild(d, p)]].f;
-        unsigned smallest_child = 1; // 1: left, 2: right
+void requeue_dh(unsigned long node_id, D_ary_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    heapify_up_dh(PQ, PQ->position[node_id], Queue_control);
+}
 
-        if ((d == PQ->l - 2) ? (2*p + 1 < PQ->r) : 1) {  // Exists a right child
-            if (Queue_control[PQ->bh_tree[lchild(d, p)]].f > Queue_control[PQ->bh_tree[rchild(d, p)]].f) {
-                smallest_child_id = PQ->bh_tree[rchild(d, p)];
-                smallest_cost = Queue_control[PQ->bh_tree[rchild(d, p)]].f;
-                smallest_child = 2;
-            }
+void heapify_up_dh(D_ary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control) {
+    unsigned long node_id = PQ->tree[i];
+    double cost = Queue_control[node_id].f;
+    unsigned long parent_slot;
+    while (i > 0 && cost < Queue_control[PQ->tree[parent_slot = (i - 1) / PQ->arity]].f) {
+        PQ->tree[i] = PQ->tree[parent_slot];
+        PQ->position[PQ->tree[i]] = i;
+        i = parent_slot;
+    }
+    PQ->tree[i] = node_id;
+    PQ->position[node_id] = i;
+}
 
+void heapify_down_dh(D_ary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control) {
+    unsigned long node_id = PQ->tree[i];
+    double cost = Queue_control[node_id].f;
+    unsigned long first_child, last_child, child, smallest_child;
+    while ((first_child = PQ->arity * i + 1) < PQ->size) {
+        // Find the smallest of the children
+        last_child = first_child + PQ->arity;
+        if (last_child > PQ->size) last_child = PQ->size;
+        smallest_child = first_child;
+        for (child = first_child + 1; child < last_child; child++) {
+            if (Queue_control[PQ->tree[child]].f < Queue_control[PQ->tree[smallest_child]].f) smallest_child = child;
         }
-        if (Queue_control[PQ->bh_tree[dp(d, p)]].f <= smallest_cost) {
-            return;
-        }
-        
-        unsigned long i_aux = PQ->bh_tree[dp(d, p)];
-        PQ->bh_tree[dp(d, p)] = smallest_child_id;
-        if (smallest_child == 1) {
-            PQ->bh_tree[lchild(d, p)] = i_aux;
-            
-            d = d + 1;
-            p = 2*p;
-        } else {
-            PQ->bh_tree[rchild(d, p)] = i_aux;
-            d = d + 1;
-            p = 2*p + 1;
-        }
+        if (cost <= Queue_control[PQ->tree[smallest_child]].f) break;
+
+        PQ->tree[i] = PQ->tree[smallest_child];
+        PQ->position[PQ->tree[i]] = i;
+        i = smallest_child;
     }
+    PQ->tree[i] = node_id;
+    PQ->position[node_id] = i;
 }
 
-void show_bh(Binary_Heap_PQ *PQ, FILE *file, AStarControlData *Queue_control) {
-    // Shows only the first 5 levels
-    if (PQ->l > 0) {
-        fprintf(file, "Level 1:                                            %lu (%g)\n",
-                            PQ->bh_tree[dp(0, 0)], Queue_control[PQ->bh_tree[dp(0, 0)]].f);
-    }
-    if (PQ->l > 1) {
-        if (PQ->l == 2 && PQ->r == 1) {
-                    fprintf(file, "Level 2:                       %lu (%g)\n",
-                                PQ->bh_tree[dp(1, 0)], Queue_control[PQ->bh_tree[dp(1, 0)]].f);
-        } else {
-                    fprintf(file, "Level 2:                       %lu (%g)                                            %lu (%g)\n",
-                        PQ->bh_tree[dp(1, 0)], Queue_control[PQ->bh_tree[dp(1, 0)]].f,
-                        PQ->bh_tree[dp(1, 1)], Queue_control[PQ->bh_tree[dp(1, 1)]].f);
-        }
+
+/*
+    PAIRING HEAP MANAGEMENT
+*/
+
+unsigned long link_ph(Pairing_Heap_PQ *PQ, unsigned long node_1, unsigned long node_2, AStarControlData *Queue_control) {
+    unsigned long aux_node;
+    if (Queue_control[node_2].f < Queue_control[node_1].f) {
+        aux_node = node_1;
+        node_1 = node_2;
+        node_2 = aux_node;
     }
-    if (PQ->l > 2) {
-        if (PQ->l == 3 && PQ->r == 1) {
-            fprintf(file, "Level 3:          %lu (%g)\n",
-                            PQ->bh_tree[dp(2, 0)], Queue_control[PQ->bh_tree[dp(2, 0)]].f);
-        } else if (PQ->l == 3 && PQ->r == 2) {
-            fprintf(file, "Level 3:          %lu (%g)                  %lu (%g)\n",
-                            PQ->bh_tree[dp(2, 0)], Queue_control[PQ->bh_tree[dp(2, 0)]].f,
-                            PQ->bh_tree[dp(2, 1)], Queue_control[PQ->bh_tree[dp(2, 1)]].f);
-
-        } else if (PQ->l == 3 && PQ->r == 3) {
-            fprintf(file, "Level 3:          %lu (%g)                  %lu (%g)      ----       %lu (%g)\n",
-                            PQ->bh_tree[dp(2, 0)], Queue_control[PQ->bh_tree[dp(2, 0)]].f,
-                            PQ->bh_tree[dp(2, 1)], Queue_control[PQ->bh_tree[dp(2, 1)]].f,
-                            PQ->bh_tree[dp(2, 2)], Queue_control[PQ->bh_tree[dp(2, 2)]].f);
+    PQ->sibling[node_2] = PQ->child[node_1];
+    if (PQ->child[node_1] != NO_NODE) PQ->prev[PQ->child[node_1]] = node_2;
+    PQ->prev[node_2] = node_1;
+    PQ->child[node_1] = node_2;
+    PQ->prev[node_1] = NO_NODE;
+    return node_1;
+}
 
+bool enqueue_ph(unsigned long node_id, Pairing_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    PQ->child[node_id] = NO_NODE;
+    PQ->sibling[node_id] = NO_NODE;
+    PQ->prev[node_id] = NO_NODE;
+    Queue_control[node_id].InPQ = 1;
+    if (PQ->root == NO_NODE) PQ->root = node_id;
+    else PQ->root = link_ph(PQ, PQ->root, node_id, Queue_control);
+    return true;
+}
+
+unsigned long dequeue_ph(Pairing_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    unsigned long root_node_id = PQ->root;
+    unsigned long node_1, node_2, next_node, merged, new_root;
+
+    // 1. Link the children in pairs from left to right, keeping the results in a list in reverse order
+    merged = NO_NODE;
+    node_1 = PQ->child[root_node_id];
+    while (node_1 != NO_NODE) {
+        node_2 = PQ->sibling[node_1];
+        if (node_2 == NO_NODE) {
+            next_node = NO_NODE;
+            new_root = node_1;
         } else {
-            fprintf(file, "Level 3:          %lu (%g)                  %lu (%g)      ----       %lu (%g)                   %lu (%g)\n",
-                            PQ->bh_tree[dp(2, 0)], Queue_control[PQ->bh_tree[dp(2, 0)]].f,
-                            PQ->bh_tree[dp(2, 1)], Queue_control[PQ->bh_tree[dp(2, 1)]].f,
-                            PQ->bh_tree[dp(2, 2)], Queue_control[PQ->bh_tree[dp(2, 2)]].f,
-                            PQ->bh_tree[dp(2, 3)], Queue_control[PQ->bh_tree[dp(2, 3)]].f);
+            next_node = PQ->sibling[node_2];
+            PQ->sibling[node_1] = NO_NODE;
+            PQ->sibling[node_2] = NO_NODE;
+            new_root = link_ph(PQ, node_1, node_2, Queue_control);
         }
-    
+        PQ->sibling[new_root] = merged;
+        merged = new_root;
+        node_1 = next_node;
     }
-    if (PQ->l > 3) {
-        if (PQ->l == 4 && PQ->r == 1) {
-            fprintf(file, "Level 4: %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f);
-        } else if (PQ->l == 4 && PQ->r == 2) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f);
-        } else if (PQ->l == 4 && PQ->r == 3) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f);
-        } else if (PQ->l == 4 && PQ->r == 4) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)      %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f,
-                            PQ->bh_tree[dp(3, 3)], Queue_control[PQ->bh_tree[dp(3, 3)]].f);
-        } else if (PQ->l == 4 && PQ->r == 5) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)             %lu (%g)  --  %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f,
-                            PQ->bh_tree[dp(3, 3)], Queue_control[PQ->bh_tree[dp(3, 3)]].f,
-                            PQ->bh_tree[dp(3, 4)], Queue_control[PQ->bh_tree[dp(3, 4)]].f);
-        } else if (PQ->l == 4 && PQ->r == 6) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)             %lu (%g)  --  %lu (%g)      %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f,
-                            PQ->bh_tree[dp(3, 3)], Queue_control[PQ->bh_tree[dp(3, 3)]].f,
-                            PQ->bh_tree[dp(3, 4)], Queue_control[PQ->bh_tree[dp(3, 4)]].f,
-                            PQ->bh_tree[dp(3, 5)], Queue_control[PQ->bh_tree[dp(3, 5)]].f);
-        } else if (PQ->l == 4 && PQ->r == 7) {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)             %lu (%g)  --  %lu (%g)      %lu (%g)  --  %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f,
-                            PQ->bh_tree[dp(3, 3)], Queue_control[PQ->bh_tree[dp(3, 3)]].f,
-                            PQ->bh_tree[dp(3, 4)], Queue_control[PQ->bh_tree[dp(3, 4)]].f,
-                            PQ->bh_tree[dp(3, 5)], Queue_control[PQ->bh_tree[dp(3, 5)]].f,
-                            PQ->bh_tree[dp(3, 6)], Queue_control[PQ->bh_tree[dp(3, 6)]].f);
 
-        } else {
-            fprintf(file, "Level 4: %lu (%g)      %lu (%g)  --  %lu (%g)      %lu (%g)  --  %lu (%g)      %lu (%g)  --  %lu (%g)      %lu (%g)\n",
-                            PQ->bh_tree[dp(3, 0)], Queue_control[PQ->bh_tree[dp(3, 0)]].f,
-                            PQ->bh_tree[dp(3, 1)], Queue_control[PQ->bh_tree[dp(3, 1)]].f,
-                            PQ->bh_tree[dp(3, 2)], Queue_control[PQ->bh_tree[dp(3, 2)]].f,
-                            PQ->bh_tree[dp(3, 3)], Queue_control[PQ->bh_tree[dp(3, 3)]].f,
-                            PQ->bh_tree[dp(3, 4)], Queue_control[PQ->bh_tree[dp(3, 4)]].f,
-                            PQ->bh_tree[dp(3, 5)], Queue_control[PQ->bh_tree[dp(3, 5)]].f,
-                            PQ->bh_tree[dp(3, 6)], Queue_control[PQ->bh_tree[dp(3, 6)]].f,
-                            PQ->bh_tree[dp(3, 7)], Queue_control[PQ->bh_tree[dp(3, 7)]].f);
+    // 2. Link the pairs from right to left into the new root
+    new_root = merged;
+    if (new_root != NO_NODE) {
+        node_1 = PQ->sibling[new_root];
+        PQ->sibling[new_root] = NO_NODE;
+        while (node_1 != NO_NODE) {
+            next_node = PQ->sibling[node_1];
+            PQ->sibling[node_1] = NO_NODE;
+            new_root = link_ph(PQ, new_root, node_1, Queue_control);
+            node_1 = next_node;
         }
-
-        
+        PQ->prev[new_root] = NO_NODE;
     }
-    return;
+    PQ->root = new_root;
+    return root_node_id;
+}
+
+void requeue_ph(unsigned long node_id, Pairing_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    if (node_id == PQ->root) return;
+
+    // 1. Cut the subtree of the node from its parent or previous sibling
+    unsigned long prev_node = PQ->prev[node_id];
+    if (PQ->child[prev_node] == node_id) PQ->child[prev_node] = PQ->sibling[node_id];
+    else PQ->sibling[prev_node] = PQ->sibling[node_id];
+    if (PQ->sibling[node_id] != NO_NODE) PQ->prev[PQ->sibling[node_id]] = prev_node;
+    PQ->sibling[node_id] = NO_NODE;
+    PQ->prev[node_id] = NO_NODE;
+
+    // 2. Link it with the root
+    PQ->root = link_ph(PQ, PQ->root, node_id, Queue_control);
 }
 
 
 /*
-    A* ALGORITHM
+    LAZY HEAP MANAGEMENT
 */
 
-int AStar_ll(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code) {
+bool enqueue_lh(unsigned long node_id, Lazy_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    if (PQ->size == PQ->capacity) {
+        PQ->capacity *= 2;
+        PQ->tree = (Lazy_Element_PQ *) realloc(PQ->tree, PQ->capacity * sizeof(Lazy_Element_PQ));
+        if (PQ->tree == NULL) ExitError("when reallocating memory for the Lazy Heap", 1);
+    }
 
-    // 1. Initialize Linked List
-    Linked_Element_PQ *PQ;
-    PQ = NULL;
+    // The element is moved up through a hole from the last slot
+    double cost = Queue_control[node_id].f;
+    unsigned long i = PQ->size;
+    while (i > 0 && cost < PQ->tree[parent_bh(i)].f) {
+        PQ->tree[i] = PQ->tree[parent_bh(i)];
+        i = parent_bh(i);
+    }
+    PQ->tree[i].f = cost;
+    PQ->tree[i].node_id = node_id;
+    PQ->tree[i].stamp = ++PQ->stamp[node_id];
+    PQ->size++;
+    Queue_control[node_id].InPQ = 1;
+    return true;
+}
 
-    // 2. Start the algorithm
-    // 2.1. Set the initial values
-    double initial_node_h;
+unsigned long dequeue_lh(Lazy_Heap_PQ *PQ, AStarControlData *Queue_control) {
+    Lazy_Element_PQ root, last;
+    unsigned long i, child;
+    while (PQ->size > 0) {
+        // 1. Take the root and move the last element down from it
+        root = PQ->tree[0];
+        PQ->size--;
+        last = PQ->tree[PQ->size];
+        i = 0;
+        while ((child = lchild_bh(i)) < PQ->size) {
+            if (child + 1 < PQ->size && PQ->tree[child + 1].f < PQ->tree[child].f) child++;
+            if (last.f <= PQ->tree[child].f) break;
+            PQ->tree[i] = PQ->tree[child];
+            i = child;
+        }
+        PQ->tree[i] = last;
 
-    Sol_path[initial_node].g = 0.0;
-    Sol_path[initial_node].parent = ULONG_MAX;
+        // 2. The element is outdated if the node was extended or enqueued again since it was enqueued
+        if (Queue_control[root.node_id].InPQ && root.stamp == PQ->stamp[root.node_id]) return root.node_id;
+    }
+    return NO_NODE;
+}
 
-    initial_node_h = heuristic(heuristic_code, nodes[initial_node].speed,
-                                nodes[initial_node].lat, nodes[initial_node].lon,
-                                nodes[final_node].lat, nodes[final_node].lon);
-    Queue_control[initial_node].f = initial_node_h;
 
-    if (!enqueue_ll(initial_node, &PQ, Queue_control)) return -1;
+/*
+    BUCKET QUEUE MANAGEMENT
+*/
 
-    // 2.2. Iterate until the solution is found or the are not more nodes left in the Queue
-    unsigned long curr_node, succ_node, index;
-    double succ_g, succ_h, f_aux;
-    while (PQ != NULL) {
-        // 2.2.1. Check whether the solution has been found or not
-        if ((curr_node = dequeue_ll(&PQ)) == final_node) {
-            free(PQ);
-            return 1;
+void push_bucket_bq(unsigned long node_id, unsigned long bucket, Bucket_Queue_PQ *PQ) {
+    unsigned long *head = &PQ->overflow;
+    if (bucket != BUCKET_OVERFLOW) {
+        unsigned long index = bucket - PQ->origin;
+        if (index >= PQ->nbuckets) {
+            // The buckets are below BUCKET_LIMIT, so they never grow past it
+            unsigned long old_nbuckets = PQ->nbuckets;
+            while (index >= PQ->nbuckets && PQ->nbuckets < BUCKET_LIMIT) PQ->nbuckets *= 2;
+            PQ->head = (unsigned long *) realloc(PQ->head, PQ->nbuckets * sizeof(unsigned long));
+            if (PQ->head == NULL) ExitError("when reallocating memory for the buckets of the Bucket Queue", 1);
+            for (unsigned long i = old_nbuckets; i < PQ->nbuckets; i++) PQ->head[i] = NO_NODE;
         }
+        if (index > PQ->last) PQ->last = index;
+        head = &PQ->head[index];
+    }
+    PQ->bucket[node_id] = bucket;
+    PQ->prev[node_id] = NO_NODE;
+    PQ->next[node_id] = *head;
+    if (*head != NO_NODE) PQ->prev[*head] = node_id;
+    *head = node_id;
+}
 
-        // 2.2.2. Iterate through all the connected nodes of the current node
-        if (nodes[curr_node].nedges) {
-            for (index = 0; index < nodes[curr_node].nedges; index++) {
-                succ_node = nodes[curr_node].to_nodes[index];
-                if (Queue_control[succ_node].extended) continue;
-
-                succ_g = nodes[curr_node].to_times[index];
-                succ_h = heuristic(heuristic_code, nodes[succ_node].speed,
-                                    nodes[succ_node].lat, nodes[succ_node].lon,
-                                    nodes[final_node].lat, nodes[final_node].lon);                                                    
-                
-                f_aux = Sol_path[curr_node].g + succ_g + succ_h;
-
-                if (!Queue_control[succ_node].InPQ)
-                {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                    if (!enqueue_ll(succ_node, &PQ, Queue_control)) return -1;
-                } else if (f_aux < Queue_control[succ_node].f)
-                {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                    requeue_ll(succ_node, &PQ, Queue_control);
-                }
-            }
+bool enqueue_bq(unsigned long node_id, Bucket_Queue_PQ *PQ, AStarControlData *Queue_control) {
+    unsigned long bucket = bucket_bq(PQ, Queue_control[node_id].f);
+    if (PQ->origin == NO_NODE) {
+        PQ->origin = (bucket == BUCKET_OVERFLOW) ? 0 : bucket;
+        PQ->current = PQ->origin;
+    }
+    PQ->nqueued++;
+    if (bucket <= PQ->current) {
+        PQ->bucket[node_id] = PQ->current;
+        return enqueue_bh(node_id, &PQ->bh, Queue_control);
+    }
+    push_bucket_bq(node_id, bucket, PQ);
+    Queue_control[node_id].InPQ = 1;
+    return true;
+}
+
+unsigned long dequeue_bq(Bucket_Queue_PQ *PQ, AStarControlData *Queue_control) {
+    if (PQ->nqueued == 0) return NO_NODE;
+
+    // 1. Move to the next bucket with nodes and build its heap, the overflow one once the others are empty
+    unsigned long node_id, list;
+    long slot;
+    while (PQ->bh.size == 0) {
+        if (PQ->current - PQ->origin >= PQ->last) {
+            PQ->current = BUCKET_OVERFLOW;
+            list = PQ->overflow;
+            PQ->overflow = NO_NODE;
+        } else {
+            PQ->current++;
+            list = PQ->head[PQ->current - PQ->origin];
+            PQ->head[PQ->current - PQ->origin] = NO_NODE;
+        }
+        for (node_id = list; node_id != NO_NODE; node_id = PQ->next[node_id]) {
+            PQ->bucket[node_id] = PQ->current;
+            PQ->bh.bh_tree[PQ->bh.size] = node_id;
+            PQ->bh.position[node_id] = PQ->bh.size;
+            PQ->bh.size++;
         }
+        for (slot = (long) PQ->bh.size / 2 - 1; slot >= 0; slot--) heapify_down_bh(&PQ->bh, slot, Queue_control);
+    }
 
-        // 2.2.3. Modify Queue control of the used node
-        Queue_control[curr_node].InPQ = 0;
-        Queue_control[curr_node].extended = 1;
+    // 2. Dequeue from the heap
+    PQ->nqueued--;
+    return dequeue_bh(&PQ->bh, Queue_control);
+}
+
+void requeue_bq(unsigned long node_id, Bucket_Queue_PQ *PQ, AStarControlData *Queue_control) {
+    if (PQ->bucket[node_id] <= PQ->current) {
+        requeue_bh(node_id, &PQ->bh, Queue_control);
+        return;
+    }
+    unsigned long bucket = bucket_bq(PQ, Queue_control[node_id].f);
+    if (bucket == PQ->bucket[node_id]) return;
+
+    // 1. Unlink the node from the list of its bucket
+    if (PQ->prev[node_id] != NO_NODE) PQ->next[PQ->prev[node_id]] = PQ->next[node_id];
+    else if (PQ->bucket[node_id] == BUCKET_OVERFLOW) PQ->overflow = PQ->next[node_id];
+    else PQ->head[PQ->bucket[node_id] - PQ->origin] = PQ->next[node_id];
+    if (PQ->next[node_id] != NO_NODE) PQ->prev[PQ->next[node_id]] = PQ->prev[node_id];
+
+    // 2. Add it to its new bucket, or to the heap if it is not after the current one
+    if (bucket <= PQ->current) {
+        PQ->bucket[node_id] = PQ->current;
+        enqueue_bh(node_id, &PQ->bh, Queue_control);
+    } else {
+        push_bucket_bq(node_id, bucket, PQ);
     }
-    return 0;
 }
 
-int AStar_bh(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control, unsigned long nnodes,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code) {
-    // 1. Initialize Binary Tree
-    Binary_Heap_PQ PQ;
-    PQ.l = 0;
-    PQ.r = 0;
-    PQ.bh_tree = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
-    if (PQ.bh_tree == NULL) ExitError("when allocating memory for the BH tree Data vector", 1);
 
-    // 2. Start the algorithm
-    // 2.1. Set the initial values
-    double initial_node_h;
+/*
+    PRIORITY QUEUE INTERFACE
+*/
 
-    Sol_path[initial_node].g = 0.0;
-    Sol_path[initial_node].parent = ULONG_MAX;
-    initial_node_h = heuristic(heuristic_code, nodes[initial_node].speed,
-                                nodes[initial_node].lat, nodes[initial_node].lon,
-                                nodes[final_node].lat, nodes[final_node].lon);
-    Queue_control[initial_node].f = initial_node_h;
-    if (!enqueue_bh(initial_node, &PQ, Queue_control)) return -1;
+void init_pq(Priority_Queue *PQ, int pq_code, unsigned long nnodes) {
+    PQ->pq_code = pq_code;
+    if (pq_code == Linked_list) {
+        PQ->ll = NULL;
+    } else if (pq_code == Binary_heap) {
+        PQ->bh.size = 0;
+        PQ->bh.bh_tree = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->bh.position = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        if (PQ->bh.bh_tree == NULL || PQ->bh.position == NULL) ExitError("when allocating memory for the Binary Heap", 1);
+    } else if (pq_code == Quaternary_heap || pq_code == Octonary_heap) {
+        PQ->dh.arity = (pq_code == Quaternary_heap) ? 4 : 8;
+        PQ->dh.size = 0;
+        PQ->dh.tree = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->dh.position = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        if (PQ->dh.tree == NULL || PQ->dh.position == NULL) ExitError("when allocating memory for the D-ary Heap", 1);
+    } else if (pq_code == Pairing_heap) {
+        PQ->ph.root = NO_NODE;
+        PQ->ph.child = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->ph.sibling = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->ph.prev = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        if (PQ->ph.child == NULL || PQ->ph.sibling == NULL || PQ->ph.prev == NULL) ExitError("when allocating memory for the Pairing Heap", 1);
+    } else if (pq_code == Lazy_heap) {
+        PQ->lh.size = 0;
+        PQ->lh.capacity = (nnodes > 0) ? nnodes : 1;
+        PQ->lh.tree = (Lazy_Element_PQ *) malloc(PQ->lh.capacity * sizeof(Lazy_Element_PQ));
+        PQ->lh.stamp = (unsigned long *) calloc(nnodes, sizeof(unsigned long));
+        if (PQ->lh.tree == NULL || PQ->lh.stamp == NULL) ExitError("when allocating memory for the Lazy Heap", 1);
+    } else if (pq_code == Bucket_queue) {
+        PQ->bq.width = BUCKET_SECONDS;
+        PQ->bq.origin = NO_NODE;
+        PQ->bq.current = 0;
+        PQ->bq.nbuckets = 1024;
+        PQ->bq.last = 0;
+        PQ->bq.nqueued = 0;
+        PQ->bq.overflow = NO_NODE;
+        PQ->bq.head = (unsigned long *) malloc(PQ->bq.nbuckets * sizeof(unsigned long));
+        PQ->bq.next = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->bq.prev = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->bq.bucket = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->bq.bh.size = 0;
+        PQ->bq.bh.bh_tree = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        PQ->bq.bh.position = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+        if (PQ->bq.head == NULL || PQ->bq.next == NULL || PQ->bq.prev == NULL || PQ->bq.bucket == NULL ||
+            PQ->bq.bh.bh_tree == NULL || PQ->bq.bh.position == NULL) ExitError("when allocating memory for the Bucket Queue", 1);
+        for (unsigned long i = 0; i < PQ->bq.nbuckets; i++) PQ->bq.head[i] = NO_NODE;
+    } else {
+        ExitError("wrong pq_code", 1);
+    }
+}
 
-    // 2.2. Iterate until the solution is found or the are not more nodes left in the Queue
-    unsigned long curr_node, succ_node, index;
-    double succ_g, succ_h, f_aux;
+void free_pq(Priority_Queue *PQ) {
+    if (PQ->pq_code == Linked_list) {
+        while (PQ->ll != NULL) dequeue_ll(&PQ->ll);
+    } else if (PQ->pq_code == Binary_heap) {
+        free(PQ->bh.bh_tree);
+        free(PQ->bh.position);
+    } else if (PQ->pq_code == Quaternary_heap || PQ->pq_code == Octonary_heap) {
+        free(PQ->dh.tree);
+        free(PQ->dh.position);
+    } else if (PQ->pq_code == Pairing_heap) {
+        free(PQ->ph.child);
+        free(PQ->ph.sibling);
+        free(PQ->ph.prev);
+    } else if (PQ->pq_code == Lazy_heap) {
+        free(PQ->lh.tree);
+        free(PQ->lh.stamp);
+    } else if (PQ->pq_code == Bucket_queue) {
+        free(PQ->bq.head);
+        free(PQ->bq.next);
+        free(PQ->bq.prev);
+        free(PQ->bq.bucket);
+        free(PQ->bq.bh.bh_tree);
+        free(PQ->bq.bh.position);
+    }
+}
 
-    while (PQ.l != 0) {
-        // 2.2.1. Check whether the solution has been found or not
-        if ((curr_node = dequeue_bh(&PQ, Queue_control)) == final_node) {
-            free(PQ.bh_tree);
-            return 1;
+void clear_pq(Priority_Queue *PQ) {
+    if (PQ->pq_code == Linked_list) {
+        while (PQ->ll != NULL) dequeue_ll(&PQ->ll);
+    } else if (PQ->pq_code == Binary_heap) {
+        PQ->bh.size = 0;
+    } else if (PQ->pq_code == Quaternary_heap || PQ->pq_code == Octonary_heap) {
+        PQ->dh.size = 0;
+    } else if (PQ->pq_code == Pairing_heap) {
+        PQ->ph.root = NO_NODE;
+    } else if (PQ->pq_code == Lazy_heap) {
+        PQ->lh.size = 0;
+    } else if (PQ->pq_code == Bucket_queue) {
+        // Only the buckets after the current one can still have a list, none once the overflow one is reached
+        if (PQ->bq.origin != NO_NODE && PQ->bq.current != BUCKET_OVERFLOW) {
+            for (unsigned long i = PQ->bq.current - PQ->bq.origin + 1; i <= PQ->bq.last; i++) PQ->bq.head[i] = NO_NODE;
         }
+        PQ->bq.origin = NO_NODE;
+        PQ->bq.current = 0;
+        PQ->bq.last = 0;
+        PQ->bq.nqueued = 0;
+        PQ->bq.overflow = NO_NODE;
+        PQ->bq.bh.size = 0;
+    }
+}
 
-        // 2.2.2. Iterate through all the connected nodes of the current node
-        if (nodes[curr_node].nedges) {
-            for (index = 0; index < nodes[curr_node].nedges; index++) {
-                succ_node = nodes[curr_node].to_nodes[index];
-                if (Queue_control[succ_node].extended) continue;
-
-                succ_g = nodes[curr_node].to_times[index];
-                succ_h = heuristic(heuristic_code, nodes[succ_node].speed,
-                                    nodes[succ_node].lat, nodes[succ_node].lon,
-                                    nodes[final_node].lat, nodes[final_node].lon);
-                
-                f_aux = Sol_path[curr_node].g + succ_g + succ_h;
-
-                if (f_aux < Queue_control[succ_node].f || !Queue_control[succ_node].InPQ) {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                }
-
-                if (!Queue_control[succ_node].InPQ) {
-                    if (!enqueue_bh(succ_node, &PQ, Queue_control)) return -1;
-                } else if (f_aux < Queue_control[succ_node].f) {
-                    requeue_bh(succ_node, &PQ, Queue_control);
-                }
-            }
-        }
+const char *pq_name(int pq_code) {
+    if (pq_code == Linked_list) return "LL";
+    if (pq_code == Binary_heap) return "BH";
+    if (pq_code == Quaternary_heap) return "4H";
+    if (pq_code == Octonary_heap) return "8H";
+    if (pq_code == Pairing_heap) return "PH";
+    if (pq_code == Lazy_heap) return "LH";
+    if (pq_code == Bucket_queue) return "BQ";
+    ExitError("wrong pq_code", 1);
+    return NULL;
+}
 
+bool enqueue_pq(unsigned long node_id, Priority_Queue *PQ, AStarControlData *Queue_control) {
+    switch (PQ->pq_code) {
+        case Linked_list: return enqueue_ll(node_id, &PQ->ll, Queue_control);
+        case Binary_heap: return enqueue_bh(node_id, &PQ->bh, Queue_control);
+        case Quaternary_heap:
+        case Octonary_heap: return enqueue_dh(node_id, &PQ->dh, Queue_control);
+        case Pairing_heap: return enqueue_ph(node_id, &PQ->ph, Queue_control);
+        case Lazy_heap: return enqueue_lh(node_id, &PQ->lh, Queue_control);
+        default: return enqueue_bq(node_id, &PQ->bq, Queue_control);
+    }
+}
 
-        // 2.2.3. Modify Queue control of the used node
-        Queue_control[curr_node].InPQ = false;
-        Queue_control[curr_node].extended = true;
+unsigned long dequeue_pq(Priority_Queue *PQ, AStarControlData *Queue_control) {
+    switch (PQ->pq_code) {
+        case Linked_list: return (PQ->ll == NULL) ? NO_NODE : dequeue_ll(&PQ->ll);
+        case Binary_heap: return (PQ->bh.size == 0) ? NO_NODE : dequeue_bh(&PQ->bh, Queue_control);
+        case Quaternary_heap:
+        case Octonary_heap: return (PQ->dh.size == 0) ? NO_NODE : dequeue_dh(&PQ->dh, Queue_control);
+        case Pairing_heap: return (PQ->ph.root == NO_NODE) ? NO_NODE : dequeue_ph(&PQ->ph, Queue_control);
+        case Lazy_heap: return dequeue_lh(&PQ->lh, Queue_control);
+        default: return dequeue_bq(&PQ->bq, Queue_control);
     }
-    return 0;
 }
 
-int AStar_ll_metrics(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code,
-            Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics) {
+void requeue_pq(unsigned long node_id, Priority_Queue *PQ, AStarControlData *Queue_control) {
+    switch (PQ->pq_code) {
+        case Linked_list: requeue_ll(node_id, &PQ->ll, Queue_control); break;
+        case Binary_heap: requeue_bh(node_id, &PQ->bh, Queue_control); break;
+        case Quaternary_heap:
+        case Octonary_heap: requeue_dh(node_id, &PQ->dh, Queue_control); break;
+        case Pairing_heap: requeue_ph(node_id, &PQ->ph, Queue_control); break;
+        case Lazy_heap: enqueue_lh(node_id, &PQ->lh, Queue_control); break;
+        default: requeue_bq(node_id, &PQ->bq, Queue_control); break;
+    }
+}
+
+
+/*
+    SEARCH CONTEXT MANAGEMENT
+*/
+
+void init_search_context(Search_context *context, unsigned long nnodes) {
+    context->nnodes = nnodes;
+    context->Sol_path = (AStarPath *) malloc(nnodes * sizeof(AStarPath));
+    if (context->Sol_path == NULL) ExitError("when allocating memory for the AStarPath", 1);
+    context->Queue_control = (AStarControlData *) malloc(nnodes * sizeof(AStarControlData));
+    if (context->Queue_control == NULL) ExitError("when allocating memory for the AStar Control Data vector", 1);
+    context->touched = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+    if (context->touched == NULL) ExitError("when allocating memory for the touched nodes", 1);
+    context->ntouched = 0;
+
+    unsigned long index;
+    for (index = 0; index < nnodes; index++) {
+        context->Sol_path[index].g = DBL_MAX;
+        context->Queue_control[index].InPQ = false;
+        context->Queue_control[index].extended = false;
+    }
+    int pq_code;
+    for (pq_code = 0; pq_code < NPQ_CODES; pq_code++) context->queues[pq_code] = NULL;
+}
 
-    // 1. Initialize Linked List and set up timers
-    Linked_Element_PQ *PQ;
-    PQ = NULL;
+void reset_search_context(Search_context *context) {
+    unsigned long index, node_id;
+    for (index = 0; index < context->ntouched; index++) {
+        node_id = context->touched[index];
+        context->Sol_path[node_id].g = DBL_MAX;
+        context->Queue_control[node_id].InPQ = false;
+        context->Queue_control[node_id].extended = false;
+    }
+    context->ntouched = 0;
+}
 
-    clock_t start_total_time, start_time;
-    start_total_time = clock();
+Priority_Queue *context_pq(Search_context *context, int pq_code) {
+    if (context->queues[pq_code] == NULL) {
+        context->queues[pq_code] = (Priority_Queue *) malloc(sizeof(Priority_Queue));
+        if (context->queues[pq_code] == NULL) ExitError("when allocating memory for the Priority Queue", 1);
+        init_pq(context->queues[pq_code], pq_code, context->nnodes);
+    } else {
+        clear_pq(context->queues[pq_code]);
+    }
+    return context->queues[pq_code];
+}
+
+void free_search_context(Search_context *context) {
+    int pq_code;
+    for (pq_code = 0; pq_code < NPQ_CODES; pq_code++) {
+        if (context->queues[pq_code] == NULL) continue;
+        free_pq(context->queues[pq_code]);
+        free(context->queues[pq_code]);
+    }
+    free(context->Sol_path);
+    free(context->Queue_control);
+    free(context->touched);
+}
+
+
+/*
+    A* ALGORITHM
+*/
+
+double search_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+int AStar(Node *nodes, Search_context *context, unsigned long initial_node, unsigned long final_node, int heuristic_code,
+            int pq_code, Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics) {
+    // 1. Reset the context of the last query, take its Priority Queue and set up the timers
+    reset_search_context(context);
+    Priority_Queue *PQ = context_pq(context, pq_code);
+    AStarPath *Sol_path = context->Sol_path;
+    AStarControlData *Queue_control = context->Queue_control;
+
+    double start_total_time, start_time;
+    start_total_time = search_clock();
+    start_time = start_total_time;
 
     // 2. Start the algorithm
     // 2.1. Set the initial values
@@ -567,163 +822,401 @@ int AStar_ll_metrics(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_c
 
     Sol_path[initial_node].g = 0.0;
     Sol_path[initial_node].parent = ULONG_MAX;
-
-    start_time = clock();
+    if (heuristic_metrics != NULL) start_time = search_clock();
     initial_node_h = heuristic(heuristic_code, nodes[initial_node].speed,
                                 nodes[initial_node].lat, nodes[initial_node].lon,
                                 nodes[final_node].lat, nodes[final_node].lon);
-    heuristic_metrics->calculus_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
+    if (heuristic_metrics != NULL) heuristic_metrics->calculus_time += search_clock() - start_time;
     Queue_control[initial_node].f = initial_node_h;
+    context->touched[context->ntouched++] = initial_node;
 
-    start_time = clock();
-    if (!enqueue_ll(initial_node, &PQ, Queue_control)) return -1;
-    pq_metrics->enqueue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
+    if (pq_metrics != NULL) start_time = search_clock();
+    if (!enqueue_pq(initial_node, PQ, Queue_control)) return -1;
+    if (pq_metrics != NULL) pq_metrics->enqueue_time += search_clock() - start_time;
 
     // 2.2. Iterate until the solution is found or the are not more nodes left in the Queue
     unsigned long curr_node, succ_node, index;
     double succ_g, succ_h, f_aux;
-    while (PQ != NULL) {
+    int result = 0;
+
+    while (1) {
         // 2.2.1. Check whether the solution has been found or not
-        start_time = clock();
-        if ((curr_node = dequeue_ll(&PQ)) == final_node) {
-            pq_metrics->dequeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-            pq_metrics->total_time += (double) (clock() - start_total_time) / CLOCKS_PER_SEC;
-            free(PQ);
-            return 1;
+        if (pq_metrics != NULL) start_time = search_clock();
+        curr_node = dequeue_pq(PQ, Queue_control);
+        if (pq_metrics != NULL) pq_metrics->dequeue_time += search_clock() - start_time;
+        if (curr_node == NO_NODE) break;
+        if (curr_node == final_node) {
+            result = 1;
+            break;
         }
-        pq_metrics->dequeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
 
         // 2.2.2. Iterate through all the connected nodes of the current node
-        if (nodes[curr_node].nedges) {
-            for (index = 0; index < nodes[curr_node].nedges; index++) {
-                succ_node = nodes[curr_node].to_nodes[index];
-                if (Queue_control[succ_node].extended) continue;
-
-                succ_g = nodes[curr_node].to_times[index];
-                start_time = clock();
-                succ_h = heuristic(heuristic_code, nodes[succ_node].speed,
-                                    nodes[succ_node].lat, nodes[succ_node].lon,
-                                    nodes[final_node].lat, nodes[final_node].lon);
-                heuristic_metrics->calculus_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                                                    
-                
-                f_aux = Sol_path[curr_node].g + succ_g + succ_h;
-
-                if (!Queue_control[succ_node].InPQ)
-                {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                    start_time = clock();
-                    if (!enqueue_ll(succ_node, &PQ, Queue_control)) return -1;
-                    pq_metrics->enqueue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                } else if (f_aux < Queue_control[succ_node].f)
-                {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                    start_time = clock();
-                    requeue_ll(succ_node, &PQ, Queue_control);
-                    pq_metrics->requeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                }
+        for (index = 0; index < nodes[curr_node].nedges; index++) {
+            succ_node = nodes[curr_node].to_nodes[index];
+            if (Queue_control[succ_node].extended) continue;
+
+            succ_g = nodes[curr_node].to_times[index];
+            if (heuristic_metrics != NULL) start_time = search_clock();
+            succ_h = heuristic(heuristic_code, nodes[succ_node].speed,
+                                nodes[succ_node].lat, nodes[succ_node].lon,
+                                nodes[final_node].lat, nodes[final_node].lon);
+            if (heuristic_metrics != NULL) heuristic_metrics->calculus_time += search_clock() - start_time;
+
+            f_aux = Sol_path[curr_node].g + succ_g + succ_h;
+
+            if (!Queue_control[succ_node].InPQ) {
+                Sol_path[succ_node].parent = curr_node;
+                Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
+                Queue_control[succ_node].f = f_aux;
+                context->touched[context->ntouched++] = succ_node;
+                if (pq_metrics != NULL) start_time = search_clock();
+                if (!enqueue_pq(succ_node, PQ, Queue_control)) return -1;
+                if (pq_metrics != NULL) pq_metrics->enqueue_time += search_clock() - start_time;
+            } else if (f_aux < Queue_control[succ_node].f) {
+                Sol_path[succ_node].parent = curr_node;
+                Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
+                Queue_control[succ_node].f = f_aux;
+                if (pq_metrics != NULL) start_time = search_clock();
+                requeue_pq(succ_node, PQ, Queue_control);
+                if (pq_metrics != NULL) pq_metrics->requeue_time += search_clock() - start_time;
             }
         }
 
         // 2.2.3. Modify Queue control of the used node
-        Queue_control[curr_node].InPQ = 0;
-        Queue_control[curr_node].extended = 1;
-        heuristic_metrics->nexpanded += 1;
+        Queue_control[curr_node].InPQ = false;
+        Queue_control[curr_node].extended = true;
+        if (heuristic_metrics != NULL) heuristic_metrics->nexpanded += 1;
     }
-    pq_metrics->total_time += (double) (clock() - start_total_time) / CLOCKS_PER_SEC;
-    return 0;
+
+    if (pq_metrics != NULL) pq_metrics->total_time += search_clock() - start_total_time;
+    return result;
 }
 
-int AStar_bh_metrics(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control, unsigned long nnodes,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code,
-            Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics) {
-    // 1. Initialize Binary Tree and set up the timers
-    Binary_Heap_PQ PQ;
-    PQ.l = 0;
-    PQ.r = 0;
-    PQ.bh_tree = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
-    if (PQ.bh_tree == NULL) ExitError("when allocating memory for the BH tree Data vector", 1);
+/*
+    BIDIRECTIONAL A* ALGORITHM
+*/
 
-    clock_t start_total_time, start_time;
-    start_total_time = clock();
+double search_potential(Node *nodes, int heuristic_code, unsigned long node, unsigned long initial_node, unsigned long final_node) {
+    double to_final, from_initial;
+    to_final = heuristic(heuristic_code, nodes[node].speed, nodes[node].lat, nodes[node].lon,
+                        nodes[final_node].lat, nodes[final_node].lon);
+    from_initial = heuristic(heuristic_code, nodes[node].speed, nodes[initial_node].lat, nodes[initial_node].lon,
+                            nodes[node].lat, nodes[node].lon);
+    // The estimates are infinite at the nodes without speed, which have no potential
+    if (isinf(to_final) || isinf(from_initial)) return 0.;
+    return (to_final - from_initial) / 2.;
+}
 
-    // 2. Start the algorithm
-    // 2.1. Set the initial values
-    double initial_node_h;
+int compare_path_entries(const void *a, const void *b) {
+    const unsigned long *entry_a = (const unsigned long *) a;
+    const unsigned long *entry_b = (const unsigned long *) b;
+    if (entry_a[0] != entry_b[0]) return (entry_a[0] < entry_b[0]) ? -1 : 1;
+    if (entry_a[1] != entry_b[1]) return (entry_a[1] < entry_b[1]) ? -1 : 1;
+    return 0;
+}
 
-    Sol_path[initial_node].g = 0.0;
-    Sol_path[initial_node].parent = ULONG_MAX;
-    start_time = clock();
-    initial_node_h = heuristic(heuristic_code, nodes[initial_node].speed,
-                                nodes[initial_node].lat, nodes[initial_node].lon,
-                                nodes[final_node].lat, nodes[final_node].lon);
-    heuristic_metrics->calculus_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-    
-    Queue_control[initial_node].f = initial_node_h;
-    start_time = clock();
-    if (!enqueue_bh(initial_node, &PQ, Queue_control)) return -1;
-    pq_metrics->enqueue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
+void join_bidirectional_path(Search_context *forward, Search_context *backward, unsigned long initial_node,
+                            unsigned long final_node, unsigned long meeting_node, double cost) {
+    // 1. Count the nodes of the path and store them in order: from the initial node to the meeting one, and then to the final one
+    unsigned long nforward, nbackward, length, node, index;
+    nforward = 1;
+    for (node = meeting_node; node != initial_node; node = forward->Sol_path[node].parent) nforward++;
+    nbackward = 0;
+    for (node = meeting_node; node != final_node; node = backward->Sol_path[node].parent) nbackward++;
+    length = nforward + nbackward;
+
+    unsigned long *sequence, *entries;
+    double *times;
+    sequence = (unsigned long *) malloc(length * sizeof(unsigned long));
+    entries = (unsigned long *) malloc(2 * length * sizeof(unsigned long));
+    times = (double *) malloc(length * sizeof(double));
+    if (sequence == NULL || entries == NULL || times == NULL) ExitError("when allocating memory for the bidirectional path", 1);
+    for (node = meeting_node, index = nforward; index > 0; node = forward->Sol_path[node].parent) {
+        index--;
+        sequence[index] = node;
+        times[index] = forward->Sol_path[node].g;
+    }
+    for (node = backward->Sol_path[meeting_node].parent, index = nforward; index < length; node = backward->Sol_path[node].parent) {
+        sequence[index] = node;
+        times[index] = cost - backward->Sol_path[node].g;
+        index++;
+    }
 
-    // 2.2. Iterate until the solution is found or the are not more nodes left in the Queue
-    unsigned long curr_node, succ_node, index;
-    double succ_g, succ_h, f_aux;
+    // 2. Sort the nodes with their positions, to find the last one of every node
+    // A node is repeated if the two halves go around a cycle of zero time, which is skipped
+    for (index = 0; index < length; index++) {
+        entries[2 * index] = sequence[index];
+        entries[2 * index + 1] = index;
+    }
+    qsort(entries, length, 2 * sizeof(unsigned long), compare_path_entries);
 
-    while (PQ.l != 0) {
-        // 2.2.1. Check whether the solution has been found or not
-        start_time = clock();
-        if ((curr_node = dequeue_bh(&PQ, Queue_control)) == final_node) {
-            pq_metrics->dequeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-            pq_metrics->total_time += (double) (clock() - start_total_time) / CLOCKS_PER_SEC;
-            free(PQ.bh_tree);
-            return 1;
+    // 3. Link the nodes in the forward solution, jumping from every node to its last position
+    unsigned long prev_node, position, low, high, middle;
+    prev_node = initial_node;
+    index = 0;
+    while (index < length) {
+        node = sequence[index];
+        // Last entry of the node among the sorted ones
+        low = 0;
+        high = length;
+        while (high - low > 1) {
+            middle = (low + high) / 2;
+            if (entries[2 * middle] <= node) low = middle;
+            else high = middle;
         }
-        pq_metrics->dequeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
+        position = entries[2 * low + 1];
+        if (index > 0) {
+            if (forward->Sol_path[node].g == DBL_MAX) forward->touched[forward->ntouched++] = node;
+            forward->Sol_path[node].parent = prev_node;
+            forward->Sol_path[node].g = times[index];
+        }
+        prev_node = node;
+        index = position + 1;
+    }
+    free(sequence);
+    free(entries);
+    free(times);
+}
 
-        // 2.2.2. Iterate through all the connected nodes of the current node
-        if (nodes[curr_node].nedges) {
-            for (index = 0; index < nodes[curr_node].nedges; index++) {
+int BiAStar(Node *nodes, Reverse_graph *reverse, Search_context *forward, Search_context *backward,
+            unsigned long initial_node, unsigned long final_node, int heuristic_code, int pq_code,
+            Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics) {
+    // 1. Reset the contexts of the last query, take their Priority Queues and set up the timers
+    reset_search_context(forward);
+    reset_search_context(backward);
+    Search_context *contexts[2] = {forward, backward};
+    Priority_Queue *queues[2] = {context_pq(forward, pq_code), context_pq(backward, pq_code)};
+
+    double start_total_time, start_time;
+    start_total_time = search_clock();
+    start_time = start_total_time;
+
+    // 2. Start the algorithm
+    // 2.1. Set the initial values. The keys are the reduced distances with the potential of every node, which is positive
+    // in the forward search and negative in the backward one, and 0 at the initial and final nodes
+    double initial_potential, final_potential;
+    unsigned long roots[2] = {initial_node, final_node};
+    int side;
+
+    if (heuristic_metrics != NULL) start_time = search_clock();
+    initial_potential = search_potential(nodes, heuristic_code, initial_node, initial_node, final_node);
+    final_potential = search_potential(nodes, heuristic_code, final_node, initial_node, final_node);
+    if (heuristic_metrics != NULL) heuristic_metrics->calculus_time += search_clock() - start_time;
+
+    for (side = 0; side < 2; side++) {
+        contexts[side]->Sol_path[roots[side]].g = 0.0;
+        contexts[side]->Sol_path[roots[side]].parent = ULONG_MAX;
+        contexts[side]->Queue_control[roots[side]].f = 0.0;
+        contexts[side]->touched[contexts[side]->ntouched++] = roots[side];
+        if (pq_metrics != NULL) start_time = search_clock();
+        if (!enqueue_pq(roots[side], queues[side], contexts[side]->Queue_control)) return -1;
+        if (pq_metrics != NULL) pq_metrics->enqueue_time += search_clock() - start_time;
+    }
+
+    // 2.2. Expand the two searches alternately until the lowest keys of both of them reach the best path found
+    // The keys of a search never decrease, so the last one dequeued by the other search bounds its lowest key
+    unsigned long curr_node, succ_node, index, nsucc, meeting_node;
+    double succ_g, succ_key, cost, reduced_cost, last_keys[2] = {0., 0.};
+    AStarPath *Sol_path, *other_Sol_path;
+    AStarControlData *Queue_control;
+
+    meeting_node = (initial_node == final_node) ? initial_node : NO_NODE;
+    cost = (initial_node == final_node) ? 0. : DBL_MAX;
+    side = 1;
+    while (1) {
+        // 2.2.1. Check whether the best path can still be improved or not
+        side = 1 - side;
+        Sol_path = contexts[side]->Sol_path;
+        other_Sol_path = contexts[1 - side]->Sol_path;
+        Queue_control = contexts[side]->Queue_control;
+
+        if (pq_metrics != NULL) start_time = search_clock();
+        curr_node = dequeue_pq(queues[side], Queue_control);
+        if (pq_metrics != NULL) pq_metrics->dequeue_time += search_clock() - start_time;
+        if (curr_node == NO_NODE) break;
+        reduced_cost = (cost == DBL_MAX) ? DBL_MAX : cost - initial_potential + final_potential;
+        if (Queue_control[curr_node].f + last_keys[1 - side] >= reduced_cost) break;
+        last_keys[side] = Queue_control[curr_node].f;
+
+        // 2.2.2. Iterate through the outgoing edges in the forward search, or the incoming ones in the backward search
+        nsucc = (side == 0) ? nodes[curr_node].nedges : reverse->first[curr_node + 1] - reverse->first[curr_node];
+        for (index = 0; index < nsucc; index++) {
+            if (side == 0) {
                 succ_node = nodes[curr_node].to_nodes[index];
-                if (Queue_control[succ_node].extended) continue;
-
-                succ_g = nodes[curr_node].to_times[index];
-                start_time = clock();
-                succ_h = heuristic(heuristic_code, nodes[succ_node].speed,
-                                    nodes[succ_node].lat, nodes[succ_node].lon,
-                                    nodes[final_node].lat, nodes[final_node].lon);
-                heuristic_metrics->calculus_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                
-                f_aux = Sol_path[curr_node].g + succ_g + succ_h;
-
-                if (f_aux < Queue_control[succ_node].f || !Queue_control[succ_node].InPQ) {
-                    Sol_path[succ_node].parent = curr_node;
-                    Sol_path[succ_node].g = Sol_path[curr_node].g + succ_g;
-                    Queue_control[succ_node].f = f_aux;
-                }
-
-                if (!Queue_control[succ_node].InPQ) {
-                    start_time = clock();
-                    if (!enqueue_bh(succ_node, &PQ, Queue_control)) return -1;
-                    pq_metrics->enqueue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                } else if (f_aux < Queue_control[succ_node].f) {
-                    start_time = clock();
-                    requeue_bh(succ_node, &PQ, Queue_control);
-                    pq_metrics->requeue_time += (double) (clock() - start_time) / CLOCKS_PER_SEC;
-                }
+                succ_g = Sol_path[curr_node].g + nodes[curr_node].to_times[index];
+            } else {
+                succ_node = reverse->from_nodes[reverse->first[curr_node] + index];
+                succ_g = Sol_path[curr_node].g + reverse->from_times[reverse->first[curr_node] + index];
+            }
+            if (Queue_control[succ_node].extended) continue;
+
+            if (heuristic_metrics != NULL) start_time = search_clock();
+            succ_key = succ_g + ((side == 0) ? search_potential(nodes, heuristic_code, succ_node, initial_node, final_node) - initial_potential
+                                             : final_potential - search_potential(nodes, heuristic_code, succ_node, initial_node, final_node));
+            if (heuristic_metrics != NULL) heuristic_metrics->calculus_time += search_clock() - start_time;
+
+            if (!Queue_control[succ_node].InPQ) {
+                Sol_path[succ_node].parent = curr_node;
+                Sol_path[succ_node].g = succ_g;
+                Queue_control[succ_node].f = succ_key;
+                contexts[side]->touched[contexts[side]->ntouched++] = succ_node;
+                if (pq_metrics != NULL) start_time = search_clock();
+                if (!enqueue_pq(succ_node, queues[side], Queue_control)) return -1;
+                if (pq_metrics != NULL) pq_metrics->enqueue_time += search_clock() - start_time;
+            } else if (succ_key < Queue_control[succ_node].f) {
+                Sol_path[succ_node].parent = curr_node;
+                Sol_path[succ_node].g = succ_g;
+                Queue_control[succ_node].f = succ_key;
+                if (pq_metrics != NULL) start_time = search_clock();
+                requeue_pq(succ_node, queues[side], Queue_control);
+                if (pq_metrics != NULL) pq_metrics->requeue_time += search_clock() - start_time;
+            } else continue;
+
+            // 2.2.3. Update the best path if the node is also reached by the other search
+            if (other_Sol_path[succ_node].g != DBL_MAX && succ_g + other_Sol_path[succ_node].g < cost) {
+                cost = succ_g + other_Sol_path[succ_node].g;
+                meeting_node = succ_node;
             }
         }
 
-
-        // 2.2.3. Modify Queue control of the used node
+        // 2.2.4. Modify Queue control of the used node
         Queue_control[curr_node].InPQ = false;
         Queue_control[curr_node].extended = true;
-        heuristic_metrics->nexpanded += 1;
+        if (heuristic_metrics != NULL) heuristic_metrics->nexpanded += 1;
     }
-    pq_metrics->total_time += (double) (clock() - start_total_time) / CLOCKS_PER_SEC;
-    return 0;
+
+    // 3. Join the two halves of the path in the solution of the forward search
+    if (pq_metrics != NULL) pq_metrics->total_time += search_clock() - start_total_time;
+    if (meeting_node == NO_NODE) return 0;
+    join_bidirectional_path(forward, backward, initial_node, final_node, meeting_node, cost);
+    return 1;
+}
+
+
+int read_search_code(char *code, bool *bidirectional) {
+    *bidirectional = (code[0] == 'b');
+    if (*bidirectional) code++;
+    char *end_ptr;
+    long pq_code = strtol(code, &end_ptr, 10);
+    if (end_ptr == code || *end_ptr != '\0' || pq_code < Linked_list || pq_code > Bucket_queue)
+        ExitError("wrong pq_code. Must be between 0 and 6, preceded by b for the bidirectional search", 1);
+    return (int) pq_code;
+}
+
+
+/*
+    BATCH QUERIES
+*/
+
+void path_queries(Query_work *work, Search_context *context, Search_context *backward, unsigned long path_index) {
+    // 1. Choose initial node and final node
+    unsigned long initial_node, final_node;
+    initial_node = work->paths[path_index].start_node.node_id;
+    final_node = work->paths[path_index].final_node->node_id;
+
+    // Distance computed with haversine formula
+    double sep_km = distance_km(work->nodes[initial_node].lon, work->nodes[initial_node].lat,
+                                work->nodes[final_node].lon, work->nodes[final_node].lat);
+
+    int queue;
+    for (queue = 0; queue < work->nqueues; queue++) {
+        Heuristic_Metrics *heuristic_metrics = &work->heuristic_metrics[queue][path_index];
+        PQ_Metrics *pq_metrics = &work->pq_metrics[queue][path_index];
+
+        // 2. Initialize metrics
+        heuristic_metrics->path_id = work->paths[path_index].id;
+        heuristic_metrics->sep_km = sep_km;
+        heuristic_metrics->nsolution = 0;
+        heuristic_metrics->nexpanded = 0;
+        heuristic_metrics->calculus_time = 0.;
+
+        pq_metrics->path_id = work->paths[path_index].id;
+        pq_metrics->total_time = 0.;
+        pq_metrics->enqueue_time = 0.;
+        pq_metrics->dequeue_time = 0.;
+        pq_metrics->requeue_time = 0.;
+        pq_metrics->sep_km = sep_km;
+
+        // 3. Run AStar with the Priority Queue
+        int result;
+        unsigned long curr_node;
+        if (work->bidirectional[queue]) {
+            result = BiAStar(work->nodes, work->reverse, context, backward, initial_node, final_node, work->heuristic_code,
+                            work->pq_codes[queue], heuristic_metrics, pq_metrics);
+        } else {
+            result = AStar(work->nodes, context, initial_node, final_node, work->heuristic_code, work->pq_codes[queue],
+                            heuristic_metrics, pq_metrics);
+        }
+        if (result == -1) ExitError("in allocating memory for the PQ list in AStar", 1);
+        else if (result == 0) ExitError("no solution found in AStar", 2);
+        heuristic_metrics->solution_cost = context->Sol_path[final_node].g;
+        curr_node = final_node;
+        while (curr_node != initial_node) {
+            heuristic_metrics->nsolution += 1;
+            curr_node = context->Sol_path[curr_node].parent;
+        }
+        heuristic_metrics->nsolution += 1;
+        pq_metrics->nsolution = heuristic_metrics->nsolution;
+    }
+}
+
+void *query_thread(void *arg) {
+    Query_work *work = (Query_work *) arg;
+    Search_context context, backward;
+    unsigned long path_index;
+
+    // The backward context is only needed by the bidirectional search
+    init_search_context(&context, work->nnodes);
+    if (work->reverse != NULL) init_search_context(&backward, work->nnodes);
+    while (1) {
+        // The progress is printed by the thread that takes the next path, so only one at a time
+        pthread_mutex_lock(&work->lock);
+        path_index = work->next_path++;
+        if (path_index < work->npaths) printf("\rFinding solution for path %lu out of %lu", path_index + 1, work->npaths);
+        pthread_mutex_unlock(&work->lock);
+        if (path_index >= work->npaths) break;
+        path_queries(work, &context, &backward, path_index);
+    }
+    free_search_context(&context);
+    if (work->reverse != NULL) free_search_context(&backward);
+    return NULL;
+}
+
+void run_queries(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, Reverse_graph *reverse, int heuristic_code,
+                int *pq_codes, bool *bidirectional, int nqueues, int nthreads, Heuristic_Metrics **heuristic_metrics,
+                PQ_Metrics **pq_metrics) {
+    // 1. Share the work between the threads
+    Query_work work;
+    pthread_t *threads;
+    int i_thread;
+
+    if (nthreads <= 0) nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0) nthreads = 1;
+    if ((unsigned long) nthreads > npaths) nthreads = (npaths > 0) ? (int) npaths : 1;
+
+    work.nodes = nodes;
+    work.paths = paths;
+    work.nnodes = nnodes;
+    work.npaths = npaths;
+    work.heuristic_code = heuristic_code;
+    work.pq_codes = pq_codes;
+    work.bidirectional = bidirectional;
+    work.nqueues = nqueues;
+    work.reverse = reverse;
+    work.heuristic_metrics = heuristic_metrics;
+    work.pq_metrics = pq_metrics;
+    work.next_path = 0;
+    threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    if (threads == NULL) ExitError("when allocating memory for the threads", 3);
+    if (pthread_mutex_init(&work.lock, NULL) != 0) ExitError("when initializing the queries lock", 4);
+
+    // 2. Run the queries
+    printf("Running the queries with %d threads...\n", nthreads);
+    for (i_thread = 0; i_thread < nthreads; i_thread++)
+        if (pthread_create(&threads[i_thread], NULL, query_thread, &work) != 0) ExitError("when creating a query thread", 5);
+    for (i_thread = 0; i_thread < nthreads; i_thread++) pthread_join(threads[i_thread], NULL);
+    pthread_mutex_destroy(&work.lock);
+    free(threads);
 }
 
 /*
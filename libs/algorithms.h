@@ -2,6 +2,8 @@
 #define ALGORITHMS_H
 
 #include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
 #include "metrics.h"
 
 /*
@@ -10,6 +12,9 @@
 // This enumeration the heuristic codes
 enum Heuristic {Dij, Hav, SLC, EqApp, Vinc};
 
+// This enumeration the priority queue codes
+enum Priority_queue {Linked_list, Binary_heap, Quaternary_heap, Octonary_heap, Pairing_heap, Lazy_heap, Bucket_queue};
+
 // This enumeration the possible final states of a node
 enum Final_state {NotVis, InPQ, Ext, InSol};
 
@@ -39,27 +44,146 @@ typedef struct Linked_Element_PQ {
 } Linked_Element_PQ;
 
 
-// This structure stores the information about the current state of the Binary Heap.
+/*
+ * This structure stores the information about the current state of the Binary Heap.
+ * The heap is a plain array: the children of the slot i are in 2i+1 and 2i+2. The slot of every enqueued node is kept
+ * in position, indexed by the node id, so a node can be requeued without searching it.
+*/
 typedef struct {
-    unsigned l, r;
-    unsigned long  *bh_tree;
+    unsigned long size;
+    unsigned long *bh_tree;
+    unsigned long *position;
 } Binary_Heap_PQ;
 
+// This structure stores the information about the current state of a D-ary Heap, laid out as the Binary Heap with arity children per slot.
+typedef struct {
+    unsigned arity;
+    unsigned long size;
+    unsigned long *tree;
+    unsigned long *position;
+} D_ary_Heap_PQ;
 
 /*
-    MACROS FOR THE BINARY HEAP TREE
+ * This structure stores the information about the current state of the Pairing Heap. Every enqueued node has its first
+ * child, its next sibling and its previous one (its parent if it is the first child), indexed by the node id.
+*/
+typedef struct {
+    unsigned long root;
+    unsigned long *child;
+    unsigned long *sibling;
+    unsigned long *prev;
+} Pairing_Heap_PQ;
+
+// This structure stores an element of the Lazy Heap with the cost and the stamp the node had when it was enqueued.
+typedef struct {
+    double f;
+    unsigned long node_id;
+    unsigned long stamp;
+} Lazy_Element_PQ;
+
+/*
+ * This structure stores the information about the current state of the Lazy Heap, a Binary Heap without decrease-key.
+ * A requeued node is enqueued again, and the elements whose cost is outdated are discarded when they are dequeued.
+ * Stores in stamp the number of times every node was enqueued, so only its last element has its current stamp. The
+ * stamps are compared instead of the costs, which can be NaN when the heuristic is 0 / 0 at a node with speed 0.
+*/
+typedef struct {
+    unsigned long size, capacity;
+    Lazy_Element_PQ *tree;
+    unsigned long *stamp;
+} Lazy_Heap_PQ;
+
+/*
+ * This structure stores the information about the current state of the Bucket Queue. The nodes are kept in buckets of
+ * width seconds of cost, numbered from origin, the bucket of the first node enqueued. The buckets after the current one are
+ * linked lists, with the next and previous node of every node indexed by its id. The current bucket is a Binary Heap, so
+ * its nodes are dequeued in the exact order of their cost, and the nodes whose bucket is not after it are added to the heap.
+ * Stores in bucket the bucket of every node in a list, or the current one if it is in the heap, and in last the highest
+ * bucket with a list since origin. The nodes whose cost is not finite or beyond BUCKET_LIMIT buckets are kept in the
+ * overflow list, which is only moved to the heap when every other bucket is empty.
 */
-// Returns the id of the node stored in position d,p in the Binary Heap.
-#define dp(d, p)     ((unsigned long)((1UL<< (d)) - 1UL) + p)
+typedef struct {
+    double width;
+    unsigned long origin, current, nbuckets, last, nqueued, overflow;
+    unsigned long *head;
+    unsigned long *next;
+    unsigned long *prev;
+    unsigned long *bucket;
+    Binary_Heap_PQ bh;
+} Bucket_Queue_PQ;
 
-// Returns the id of the parent of the node stored in position d,p in the Binary Heap.
-#define parent(d, p) ((unsigned long)((1UL<< (d-1)) - 1UL) + (int) p/2)
+// Width in seconds of the buckets of the Bucket Queue, the travelling times are whole seconds before the intersections
+#define BUCKET_SECONDS 1.0
 
-// Returns the id of the left child of the node stored in position d,p in the Binary Heap.
-#define lchild(d, p) ((unsigned long)((1UL<< (d+1)) - 1UL) + 2*p)
+// Number of buckets of the Bucket Queue, a power of two, the costs after them go to the overflow bucket
+#define BUCKET_LIMIT (1UL << 22)
 
-// Returns the id of the right child of the node stored in position d,p in the Binary Heap.
-#define rchild(d, p) ((unsigned long)((1UL<< (d+1)) - 1UL) + 2*p+1)
+// Bucket of the nodes in the overflow list of the Bucket Queue, after any other
+#define BUCKET_OVERFLOW ULONG_MAX
+
+// This structure stores the Priority Queue selected by pq_code, only the one of this code is used.
+typedef struct {
+    int pq_code;
+    Linked_Element_PQ *ll;
+    Binary_Heap_PQ bh;
+    D_ary_Heap_PQ dh;
+    Pairing_Heap_PQ ph;
+    Lazy_Heap_PQ lh;
+    Bucket_Queue_PQ bq;
+} Priority_Queue;
+
+// Number of Priority Queue codes
+#define NPQ_CODES (Bucket_queue + 1)
+
+/*
+ * This structure stores the state of the searches, allocated once and reused by every query on the same graph.
+ * The nodes whose state is changed by a query are stored in touched, so the next query only resets them instead of
+ * the nnodes. The Priority Queue of every pq_code is allocated the first time it is used, NULL before.
+*/
+typedef struct {
+    unsigned long nnodes;
+    AStarPath *Sol_path;
+    AStarControlData *Queue_control;
+    unsigned long *touched;
+    unsigned long ntouched;
+    Priority_Queue *queues[NPQ_CODES];
+} Search_context;
+
+/*
+ * Stores the queries of the mode 2 of path_finder shared by the threads. Every thread takes the next path until there are
+ * no more, and stores its metrics for every Priority Queue of pq_codes at the position of the path, so they are in order.
+ * The queues marked in bidirectional are run with the bidirectional search, which uses the incoming edges of reverse.
+*/
+typedef struct {
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, npaths;
+    int heuristic_code;
+    int *pq_codes;
+    bool *bidirectional;
+    int nqueues;
+    Reverse_graph *reverse;
+    Heuristic_Metrics **heuristic_metrics;
+    PQ_Metrics **pq_metrics;
+    unsigned long next_path;
+    pthread_mutex_t lock;
+} Query_work;
+
+// Marks an empty link of the Pairing Heap and an empty Priority Queue when dequeuing
+#define NO_NODE ULONG_MAX
+
+
+/*
+    MACROS FOR THE BINARY HEAP TREE
+*/
+// Returns the slot of the parent of the slot i in the Binary Heap.
+#define parent_bh(i) (((i) - 1UL) / 2UL)
+
+// Returns the slot of the left child of the slot i in the Binary Heap.
+#define lchild_bh(i) (2UL * (i) + 1UL)
+
+// Returns the slot of the right child of the slot i in the Binary Heap.
+#define rchild_bh(i) (2UL * (i) + 2UL)
 
 /*
     DISTANCES CALCULATIONS
@@ -110,42 +234,185 @@ bool enqueue_bh(unsigned long i_node, Binary_Heap_PQ *PQ, AStarControlData *Queu
 // Dequeues the id of the first node in the Binary Heap Priority Queue and returns this id.
 unsigned long dequeue_bh(Binary_Heap_PQ *PQ, AStarControlData *Queue_control);
 
-// Moves an already enqueued node in the Binary Heap Priority Queue to its new position after changing its cost.
+// Moves an already enqueued node in the Binary Heap Priority Queue to its new position after decreasing its cost.
 void requeue_bh(unsigned long i_node, Binary_Heap_PQ *PQ, AStarControlData *Queue_control);
 
-// Hapifies up the node in position d,p in the Binary Heap Priority Queue.
-void heapify_up_bh(Binary_Heap_PQ *PQ, unsigned d, unsigned p, AStarControlData *Queue_control);
+// Hapifies up the node in the slot i in the Binary Heap Priority Queue.
+void heapify_up_bh(Binary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control);
 
-// Hapifies down the node in position d,p in the Binary Heap Priority Queue.
-void heapify_down_bh(Binary_Heap_PQ *PQ, unsigned d, unsigned p, AStarControlData *Queue_control);
+// Hapifies down the node in the slot i in the Binary Heap Priority Queue.
+void heapify_down_bh(Binary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control);
 
-// Function to show the binary heap structure and connections
+// Function to show the first 4 levels of the binary heap structure
 void show_bh(Binary_Heap_PQ *PQ, FILE *file, AStarControlData *Queue_control);
+/*
+    D-ARY HEAP TREE MANAGEMENT
+*/
+// Enqueues the id of the new node in the D-ary Heap Priority Queue.
+bool enqueue_dh(unsigned long node_id, D_ary_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Dequeues the id of the first node in the D-ary Heap Priority Queue and returns this id.
+unsigned long dequeue_dh(D_ary_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Moves an already enqueued node in the D-ary Heap Priority Queue to its new position after decreasing its cost.
+void requeue_dh(unsigned long node_id, D_ary_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Hapifies up the node in the slot i in the D-ary Heap Priority Queue.
+void heapify_up_dh(D_ary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control);
+
+// Hapifies down the node in the slot i in the D-ary Heap Priority Queue.
+void heapify_down_dh(D_ary_Heap_PQ *PQ, unsigned long i, AStarControlData *Queue_control);
+
+/*
+    PAIRING HEAP MANAGEMENT
+*/
+// Enqueues the id of the new node in the Pairing Heap Priority Queue.
+bool enqueue_ph(unsigned long node_id, Pairing_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Dequeues the id of the first node in the Pairing Heap Priority Queue and returns this id.
+unsigned long dequeue_ph(Pairing_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Moves an already enqueued node in the Pairing Heap Priority Queue to its new position after decreasing its cost.
+void requeue_ph(unsigned long node_id, Pairing_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Links two roots of the Pairing Heap without siblings, the one with the highest cost becomes the first child of the other, which is returned.
+unsigned long link_ph(Pairing_Heap_PQ *PQ, unsigned long node_1, unsigned long node_2, AStarControlData *Queue_control);
+
+/*
+    LAZY HEAP MANAGEMENT
+*/
+// Enqueues the id of the node with its current cost in the Lazy Heap Priority Queue.
+bool enqueue_lh(unsigned long node_id, Lazy_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+// Dequeues the first node in the Lazy Heap Priority Queue whose cost is not outdated and returns its id, or NO_NODE if there is none.
+unsigned long dequeue_lh(Lazy_Heap_PQ *PQ, AStarControlData *Queue_control);
+
+/*
+    BUCKET QUEUE MANAGEMENT
+*/
+// Returns the bucket of the cost f in the Bucket Queue, or the overflow bucket if f is not finite or too high (NaN fails both tests)
+#define bucket_bq(PQ, f) (((f) >= 0 && (f) < (PQ)->width * BUCKET_LIMIT) ? (unsigned long) floor((f) / (PQ)->width) : \
+                          (((f) < 0) ? 0UL : BUCKET_OVERFLOW))
+
+// Enqueues the id of the new node in its bucket of the Bucket Queue Priority Queue.
+bool enqueue_bq(unsigned long node_id, Bucket_Queue_PQ *PQ, AStarControlData *Queue_control);
+
+// Dequeues the id of the first node in the Bucket Queue Priority Queue and returns this id, or NO_NODE if it is empty.
+unsigned long dequeue_bq(Bucket_Queue_PQ *PQ, AStarControlData *Queue_control);
+
+// Moves an already enqueued node in the Bucket Queue Priority Queue to its new bucket after decreasing its cost.
+void requeue_bq(unsigned long node_id, Bucket_Queue_PQ *PQ, AStarControlData *Queue_control);
+
+// Adds the node to the list of a bucket after the current one, or to the overflow list, growing the buckets if needed.
+void push_bucket_bq(unsigned long node_id, unsigned long bucket, Bucket_Queue_PQ *PQ);
+
+/*
+    PRIORITY QUEUE INTERFACE
+*/
+// Allocates the Priority Queue of pq_code for a graph of nnodes
+void init_pq(Priority_Queue *PQ, int pq_code, unsigned long nnodes);
+
+// Frees the Priority Queue
+void free_pq(Priority_Queue *PQ);
+
+// Empties the Priority Queue to be used by a new query, in time proportional to the nodes it used
+void clear_pq(Priority_Queue *PQ);
+
+// Returns the short name of the Priority Queue of pq_code, used in the metrics files
+const char *pq_name(int pq_code);
+
+// Enqueues the id of the new node in the Priority Queue.
+bool enqueue_pq(unsigned long node_id, Priority_Queue *PQ, AStarControlData *Queue_control);
+
+// Dequeues the id of the first node in the Priority Queue and returns this id, or NO_NODE if it is empty.
+unsigned long dequeue_pq(Priority_Queue *PQ, AStarControlData *Queue_control);
+
+// Moves an already enqueued node in the Priority Queue to its new position after decreasing its cost.
+void requeue_pq(unsigned long node_id, Priority_Queue *PQ, AStarControlData *Queue_control);
+
+/*
+    SEARCH CONTEXT MANAGEMENT
+*/
+// Allocates the search context for a graph of nnodes and initializes the state of all of them
+void init_search_context(Search_context *context, unsigned long nnodes);
+
+// Resets the state of the nodes touched by the last query and empties its touched list
+void reset_search_context(Search_context *context);
+
+// Returns the Priority Queue of pq_code of the context, allocating it the first time, empty
+Priority_Queue *context_pq(Search_context *context, int pq_code);
+
+// Frees the search context and its Priority Queues
+void free_search_context(Search_context *context);
+
 /*
     A* ALGORITHM
 */
 
-// Runs the AStar algorithm to find the shortest path between the initial and final node.
-// It stores the resulting solution in Sol_path. Uses a Linked list as a Priority Queue
-int AStar_ll(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code);
+// Returns the seconds of a monotonic clock, used to time the searches, which is cheap and measures every thread on its own
+double search_clock(void);
+
+/*
+ * Runs the AStar algorithm to find the shortest path between the initial and final node with the Priority Queue of pq_code.
+ * It resets the context of the previous query and stores the resulting solution in context->Sol_path, which is valid until
+ * the next query, and the metrics in heuristic_metrics and pq_metrics if they are not NULL.
+ * Returns 1 if the solution is found and 0 otherwise.
+*/
+int AStar(Node *nodes, Search_context *context, unsigned long initial_node, unsigned long final_node, int heuristic_code,
+            int pq_code, Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics);
+
+/*
+    BIDIRECTIONAL A* ALGORITHM
+*/
+/*
+ * Returns the potential of the node for the bidirectional search: half the difference between the heuristic to the final node
+ * and the heuristic from the initial one. Both searches use it, with opposite signs, so they find the same reduced distances.
+*/
+double search_potential(Node *nodes, int heuristic_code, unsigned long node, unsigned long initial_node, unsigned long final_node);
 
-// Runs the AStar algorithm to find the shortest path between the initial and final node.
-// It stores the resulting solution in Sol_path. Uses a Binary Heap as a Priority Queue
-int AStar_bh(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control, unsigned long nnodes, 
-        unsigned long initial_node, unsigned long final_node, int heuristic_code);
+// Compares two pairs of unsigned long, a node and its position in a path, to sort them
+int compare_path_entries(const void *a, const void *b);
 
-// Runs the AStar algorithm to find the shortest path between the initial and final node.
-// It stores the resulting solution in Sol_path. Uses a Linked list as a Priority Queue and stores different metrics
-int AStar_ll_metrics(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control,
-            unsigned long initial_node, unsigned long final_node, int heuristic_code,
+/*
+ * Stores in the solution of the forward context the path of the given cost from the initial to the final node through the
+ * meeting node, with the part after it taken from the backward context. The nodes repeated in both parts are skipped.
+*/
+void join_bidirectional_path(Search_context *forward, Search_context *backward, unsigned long initial_node,
+                            unsigned long final_node, unsigned long meeting_node, double cost);
+
+/*
+ * Runs the bidirectional AStar algorithm to find the shortest path between the initial and final node with the Priority Queue
+ * of pq_code: a forward search in the forward context and a backward search through the incoming edges of reverse in the
+ * backward one, expanded alternately. The keys are the distances reduced by search_potential, so the search stops when the
+ * lowest keys of both sides add up to the reduced cost of the best path found, which is optimal if the heuristic is consistent.
+ * It stores the resulting solution in forward->Sol_path, and the metrics of both searches in heuristic_metrics and pq_metrics
+ * if they are not NULL. Returns 1 if the solution is found and 0 otherwise.
+*/
+int BiAStar(Node *nodes, Reverse_graph *reverse, Search_context *forward, Search_context *backward,
+            unsigned long initial_node, unsigned long final_node, int heuristic_code, int pq_code,
             Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics);
 
-// Runs the AStar algorithm to find the shortest path between the initial and final node.
-// It stores the resulting solution in Sol_path. Uses a Binary Heap as a Priority Queue and stores different metrics
-int AStar_bh_metrics(Node *nodes, AStarPath *Sol_path, AStarControlData *Queue_control, unsigned long nnodes, 
-        unsigned long initial_node, unsigned long final_node, int heuristic_code,
-        Heuristic_Metrics *heuristic_metrics, PQ_Metrics *pq_metrics);
+// Returns the pq_code of a code argument of path_finder, and stores in bidirectional whether it starts with b
+int read_search_code(char *code, bool *bidirectional);
+
+/*
+    BATCH QUERIES
+*/
+// Runs the queries of the path path_index with every Priority Queue of the work in the contexts and stores their metrics
+void path_queries(Query_work *work, Search_context *context, Search_context *backward, unsigned long path_index);
+
+// Thread that runs the queries of the next path of the work until there are no more, with its own search contexts
+void *query_thread(void *arg);
+
+/*
+ * Runs the queries from the start node to the final node of every path with every Priority Queue of pq_codes, bidirectional
+ * for the ones marked in bidirectional, in nthreads threads, and stores their metrics at the position of the path in
+ * heuristic_metrics and pq_metrics, one array per queue. Use 0 to use all the processors. reverse may be NULL if no queue is
+ * bidirectional.
+*/
+void run_queries(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, Reverse_graph *reverse, int heuristic_code,
+                int *pq_codes, bool *bidirectional, int nqueues, int nthreads, Heuristic_Metrics **heuristic_metrics,
+                PQ_Metrics **pq_metrics);
 
 /*
     SOLUTIONS MANAGEMENT
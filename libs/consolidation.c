@@ -0,0 +1,291 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$    CONSOLIDATION.C VERSION 1.0    $$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "consolidation.h"
+
+    - Comments:
+        >> The junctions are the nodes with more than one edge. In the graphs built by this repository only the intersections
+            create them, as every original node belongs to a single path.
+        >> The junctions are hashed in the cells of the grid of the lanes, as big as the maximum distance, so the junctions closer
+            than it to a node are in its cell or in the neighbour ones.
+        >> The clusters are built greedily around the first junction not grouped yet. Merging every pair of close junctions
+            transitively would chain the crossings of a whole lane into a single node.
+        >> Only the junctions of the same shiptype are merged, so the graphs of the different shiptypes are kept apart.
+        >> The edges are rebuilt from the paths, one per pair of consecutive nodes, so two paths that go through the same
+            clusters in the same order have parallel edges, as after the intersections.
+
+    - Further development:
+        >> Check the neighbour cells at a distance of two columns at high latitudes, where the width of the cells changes between rows.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "graph_management.h"
+#include "lanes.h"
+#include "consolidation.h"
+
+/*
+    JUNCTIONS
+*/
+
+int *node_shiptypes(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, unsigned long *njunctions) {
+    int *shiptypes;
+    unsigned char *visited;
+    unsigned long index;
+    Path_node *curr_path_node;
+
+    shiptypes = (int *) malloc((nnodes ? nnodes : 1) * sizeof(int));
+    visited = (unsigned char *) calloc(nnodes ? nnodes : 1, sizeof(unsigned char));
+    if (shiptypes == NULL || visited == NULL) ExitError("when allocating memory for the shiptypes of the nodes", 1);
+
+    for (index = 0; index < npaths; index++) {
+        for (curr_path_node = &paths[index].start_node; curr_path_node != NULL; curr_path_node = curr_path_node->next) {
+            if (visited[curr_path_node->node_id] == 0) shiptypes[curr_path_node->node_id] = paths[index].shiptype;
+            else if (shiptypes[curr_path_node->node_id] != paths[index].shiptype) shiptypes[curr_path_node->node_id] = MIXED_SHIPTYPE;
+            visited[curr_path_node->node_id] = 1;
+        }
+    }
+
+    *njunctions = 0;
+    for (index = 0; index < nnodes; index++) {
+        if (visited[index] == 0) shiptypes[index] = MIXED_SHIPTYPE;
+        if (nodes[index].nedges > 1) (*njunctions)++;
+    }
+    free(visited);
+    return shiptypes;
+}
+
+void create_junction_hash(Junction_hash *hash, Node *nodes, unsigned long nnodes, unsigned long njunctions, double cell_km) {
+    unsigned long index, cell, *position;
+    long row, col;
+
+    // 1. Count the junctions of every cell
+    hash->cell_km = cell_km;
+    create_cell_table(&hash->table, njunctions ? njunctions : 1);
+    hash->first = (unsigned long *) calloc(njunctions + 2, sizeof(unsigned long));
+    hash->entries = (unsigned long *) malloc((njunctions ? njunctions : 1) * sizeof(unsigned long));
+    position = (unsigned long *) malloc((njunctions + 1) * sizeof(unsigned long));
+    if (hash->first == NULL || hash->entries == NULL || position == NULL) ExitError("when allocating memory for the junctions hash", 1);
+
+    for (index = 0; index < nnodes; index++) if (nodes[index].nedges > 1) {
+        cell_of(nodes[index].lat, nodes[index].lon, cell_km, &row, &col);
+        hash->first[cell_lane_id(&hash->table, row, col) + 1]++;
+    }
+    for (cell = 0; cell < hash->table.ncells; cell++) {
+        hash->first[cell + 1] += hash->first[cell];
+        position[cell] = hash->first[cell];
+    }
+
+    // 2. Store the junctions of every cell consecutively, in order of id
+    for (index = 0; index < nnodes; index++) if (nodes[index].nedges > 1) {
+        cell_of(nodes[index].lat, nodes[index].lon, cell_km, &row, &col);
+        cell = find_cell_lane_id(&hash->table, row, col);
+        hash->entries[position[cell]++] = index;
+    }
+    free(position);
+}
+
+void free_junction_hash(Junction_hash *hash) {
+    free_cell_table(&hash->table);
+    free(hash->first);
+    free(hash->entries);
+}
+
+unsigned long cluster_junctions(Node *nodes, unsigned long nnodes, int *shiptypes, unsigned long njunctions, double max_distance,
+                                unsigned long *leader) {
+    // 1. Hash the junctions
+    Junction_hash hash;
+    unsigned char *grouped;
+
+    create_junction_hash(&hash, nodes, nnodes, njunctions, max_distance);
+    grouped = (unsigned char *) calloc(nnodes ? nnodes : 1, sizeof(unsigned char));
+    if (grouped == NULL) ExitError("when allocating memory for the grouped junctions", 1);
+
+    // 2. Every junction not grouped yet leads a cluster with the close junctions not grouped yet
+    unsigned long index, cell, entry, other, nmerged;
+    long row, col, i_row, i_col;
+
+    nmerged = 0;
+    for (index = 0; index < nnodes; index++) leader[index] = index;
+    for (index = 0; index < nnodes; index++) {
+        if (nodes[index].nedges < 2 || shiptypes[index] == MIXED_SHIPTYPE || grouped[index]) continue;
+        grouped[index] = 1;
+        cell_of(nodes[index].lat, nodes[index].lon, max_distance, &row, &col);
+        for (i_row = row - 1; i_row <= row + 1; i_row++) for (i_col = col - 1; i_col <= col + 1; i_col++) {
+            cell = find_cell_lane_id(&hash.table, i_row, i_col);
+            if (cell == ULONG_MAX) continue;
+            for (entry = hash.first[cell]; entry < hash.first[cell + 1]; entry++) {
+                other = hash.entries[entry];
+                if (grouped[other] || shiptypes[other] != shiptypes[index]) continue;
+                if (distance_km(nodes[index].lon, nodes[index].lat, nodes[other].lon, nodes[other].lat) > max_distance) continue;
+                leader[other] = index;
+                grouped[other] = 1;
+                nmerged++;
+            }
+        }
+    }
+
+    free(grouped);
+    free_junction_hash(&hash);
+    return nmerged;
+}
+
+/*
+    GRAPH CONSOLIDATION
+*/
+
+void merge_clusters(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, unsigned long npaths,
+                    unsigned long *leader) {
+    // 1. Number the new nodes in order. The leader of a cluster always goes before the rest of its nodes.
+    Node *nodes, *new_nodes;
+    unsigned long index, *new_id, *size, new_nnodes;
+
+    nodes = *nodes_ptr;
+    new_id = (unsigned long *) malloc((*nnodes ? *nnodes : 1) * sizeof(unsigned long));
+    if (new_id == NULL) ExitError("when allocating memory for the new ids", 1);
+    new_nnodes = 0;
+    for (index = 0; index < *nnodes; index++) {
+        if (leader[index] == index) new_id[index] = new_nnodes++;
+        else new_id[index] = new_id[leader[index]];
+    }
+
+    // 2. Place every new node at the centroid of its cluster, with the maximum speed
+    new_nodes = (Node *) malloc((new_nnodes ? new_nnodes : 1) * sizeof(Node));
+    size = (unsigned long *) calloc(new_nnodes ? new_nnodes : 1, sizeof(unsigned long));
+    if (new_nodes == NULL || size == NULL) ExitError("when allocating memory for the new nodes", 2);
+
+    for (index = 0; index < *nnodes; index++) {
+        if (leader[index] == index) {
+            new_nodes[new_id[index]].id = new_id[index];
+            new_nodes[new_id[index]].lat = 0.;
+            new_nodes[new_id[index]].lon = 0.;
+            new_nodes[new_id[index]].speed = nodes[index].speed;
+            new_nodes[new_id[index]].nedges = 0;
+            new_nodes[new_id[index]].max_edges = 0;
+            new_nodes[new_id[index]].to_nodes = NULL;
+            new_nodes[new_id[index]].to_times = NULL;
+        }
+        new_nodes[new_id[index]].lat += nodes[index].lat;
+        new_nodes[new_id[index]].lon += nodes[index].lon;
+        if (nodes[index].speed > new_nodes[new_id[index]].speed) new_nodes[new_id[index]].speed = nodes[index].speed;
+        size[new_id[index]]++;
+    }
+    for (index = 0; index < new_nnodes; index++) {
+        new_nodes[index].lat = new_nodes[index].lat / (double) size[index];
+        new_nodes[index].lon = new_nodes[index].lon / (double) size[index];
+    }
+
+    // 3. Translate the paths and collect their edges. Every edge of the old graph belongs to one path and is used once,
+    // so the parallel edges of two paths keep their own times.
+    unsigned long *first_edge, ntransitions, last_transition, prev_old_id;
+    unsigned char *used;
+    Lane_transition *transitions;
+    Path_node *prev_path_node, *curr_path_node;
+    unsigned i_edge;
+    double travel_time, pending_time;
+
+    first_edge = (unsigned long *) malloc((*nnodes + 1) * sizeof(unsigned long));
+    used = (unsigned char *) calloc(*nedges ? *nedges : 1, sizeof(unsigned char));
+    transitions = (Lane_transition *) malloc((*nedges ? *nedges : 1) * sizeof(Lane_transition));
+    if (first_edge == NULL || used == NULL) ExitError("when allocating memory for the used edges", 3);
+    if (transitions == NULL) ExitError("when allocating memory for the new edges", 4);
+    first_edge[0] = 0;
+    for (index = 0; index < *nnodes; index++) first_edge[index + 1] = first_edge[index] + nodes[index].nedges;
+
+    ntransitions = 0;
+    for (index = 0; index < npaths; index++) {
+        prev_path_node = &paths[index].start_node;
+        prev_old_id = prev_path_node->node_id;
+        prev_path_node->node_id = new_id[prev_old_id];
+        paths[index].min_lon = paths[index].max_lon = new_nodes[prev_path_node->node_id].lon;
+        paths[index].min_lat = paths[index].max_lat = new_nodes[prev_path_node->node_id].lat;
+        paths[index].len = 1;
+        last_transition = ULONG_MAX;
+        pending_time = 0.;
+
+        curr_path_node = prev_path_node->next;
+        while (curr_path_node != NULL) {
+            // 3.1. Find the first edge not used yet between both old nodes
+            for (i_edge = 0; i_edge < nodes[prev_old_id].nedges && (nodes[prev_old_id].to_nodes[i_edge] != curr_path_node->node_id ||
+                    used[first_edge[prev_old_id] + i_edge]); i_edge++);
+            if (i_edge == nodes[prev_old_id].nedges) ExitError("when looking for an edge that does not exist", 5);
+            used[first_edge[prev_old_id] + i_edge] = 1;
+            travel_time = nodes[prev_old_id].to_times[i_edge];
+            prev_old_id = curr_path_node->node_id;
+
+            // 3.2. An edge inside a cluster disappears, and its time is added to the next edge
+            if (new_id[prev_old_id] == prev_path_node->node_id) {
+                pending_time += travel_time;
+                prev_path_node->next = curr_path_node->next;
+                free(curr_path_node);
+                curr_path_node = prev_path_node->next;
+                continue;
+            }
+            transitions[ntransitions].from = prev_path_node->node_id;
+            transitions[ntransitions].to = new_id[prev_old_id];
+            transitions[ntransitions].time = travel_time + pending_time;
+            last_transition = ntransitions;
+            ntransitions++;
+            pending_time = 0.;
+
+            curr_path_node->node_id = new_id[prev_old_id];
+            update_path_coordinates(&paths[index], &new_nodes[curr_path_node->node_id]);
+            paths[index].len++;
+            prev_path_node = curr_path_node;
+            curr_path_node = curr_path_node->next;
+        }
+        // The time of the edges collapsed at the end of the path is added to its last edge
+        if (last_transition != ULONG_MAX) transitions[last_transition].time += pending_time;
+        paths[index].final_node = prev_path_node;
+    }
+
+    // 3.3. The edges of no path, which link the coincident nodes of different paths, are kept unless they are inside a cluster
+    for (index = 0; index < *nnodes; index++) for (i_edge = 0; i_edge < nodes[index].nedges; i_edge++) {
+        if (used[first_edge[index] + i_edge] || new_id[nodes[index].to_nodes[i_edge]] == new_id[index]) continue;
+        transitions[ntransitions].from = new_id[index];
+        transitions[ntransitions].to = new_id[nodes[index].to_nodes[i_edge]];
+        transitions[ntransitions].time = nodes[index].to_times[i_edge];
+        ntransitions++;
+    }
+
+    // 4. Create the edges of the new nodes, in order of the paths and then the links
+    for (index = 0; index < ntransitions; index++) new_nodes[transitions[index].from].max_edges++;
+    for (index = 0; index < new_nnodes; index++) if (new_nodes[index].max_edges) {
+        new_nodes[index].to_nodes = (unsigned long *) malloc(new_nodes[index].max_edges * sizeof(unsigned long));
+        new_nodes[index].to_times = (double *) malloc(new_nodes[index].max_edges * sizeof(double));
+        if (new_nodes[index].to_nodes == NULL) ExitError("when allocating memory for the connected nodes", 6);
+        if (new_nodes[index].to_times == NULL) ExitError("when allocating memory for the travelling times", 7);
+    }
+    for (index = 0; index < ntransitions; index++) {
+        Node *from_node = &new_nodes[transitions[index].from];
+        from_node->to_nodes[from_node->nedges] = transitions[index].to;
+        from_node->to_times[from_node->nedges] = transitions[index].time;
+        from_node->nedges++;
+    }
+
+    // 5. Replace the graph
+    free_nodes(nodes, *nnodes);
+    *nodes_ptr = new_nodes;
+    *nnodes = new_nnodes;
+    *nedges = ntransitions;
+
+    free(new_id);
+    free(size);
+    free(first_edge);
+    free(used);
+    free(transitions);
+}
@@ -0,0 +1,61 @@
+#ifndef CONSOLIDATION_H
+#define CONSOLIDATION_H
+
+/*
+    STRUCTURES TO MANAGE THE SPATIAL HASH
+*/
+
+/*
+ * Stores the junctions (nodes shared by several paths) hashed in cells of the grid of the lanes.
+ * The cells are numbered by the table, and the junctions of cell i are stored from first[i] to first[i + 1] in entries.
+*/
+typedef struct {
+    Cell_table table;
+    double cell_km;
+    unsigned long *first;
+    unsigned long *entries;
+} Junction_hash;
+
+// Marks a node shared by paths of different shiptypes, which is never merged
+#define MIXED_SHIPTYPE -1
+
+/*
+    JUNCTIONS
+*/
+
+/*
+ * Returns the shiptype of the paths of every node, or MIXED_SHIPTYPE if they have several.
+ * Stores in *njunctions the number of junctions: the nodes with more than one edge, which are created by the intersections.
+*/
+int *node_shiptypes(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, unsigned long *njunctions);
+
+// Creates the hash of the junctions in cells of cell_km
+void create_junction_hash(Junction_hash *hash, Node *nodes, unsigned long nnodes, unsigned long njunctions, double cell_km);
+
+// Frees the hash
+void free_junction_hash(Junction_hash *hash);
+
+/*
+ * Groups the junctions closer than max_distance km of the same shiptype. The junctions are taken in order, and every one that
+ * is not grouped yet leads a new cluster with all the junctions not grouped yet closer than max_distance to it, so a cluster
+ * can not grow along a lane. Stores in leader the first node of the cluster of every node, itself if it is not merged.
+ * Returns the number of nodes merged into another one.
+*/
+unsigned long cluster_junctions(Node *nodes, unsigned long nnodes, int *shiptypes, unsigned long njunctions, double max_distance,
+                                unsigned long *leader);
+
+/*
+    GRAPH CONSOLIDATION
+*/
+
+/*
+ * Replaces every cluster by a single node, placed at the centroid of its nodes and with their maximum speed, and renumbers
+ * the nodes. The paths are translated to the new nodes and their edges rebuilt: an edge between two nodes of the same cluster
+ * disappears and its travelling time is added to the next edge of the path, or to the last one at its end, so the time
+ * of every path is kept. The edges of no path, which link coincident nodes of different paths, are kept unless they are
+ * inside a cluster.
+*/
+void merge_clusters(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, unsigned long npaths,
+                    unsigned long *leader);
+
+#endif
@@ -59,7 +59,7 @@ unsigned long nnodes_in_csv(FILE *csv_file) {
 
 void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes,
                         unsigned long *nnodes, unsigned long *nedges, unsigned long *npaths,
-                        FILE *csv_file) {
+                        double max_time_gap, double max_jump_km, double max_speed, FILE *csv_file) {
     // 1. Initialize auxiliar arrays
     char **shipnames, **scrapping_times;
     int *shiptypes;
@@ -110,7 +110,43 @@ void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes
         }
     }
 
-    // 3. Initialize first path of the new data
+    // 3. Remove the outliers
+    unsigned long nkept, noutliers;
+    nkept = new_nnodes;
+    if (max_speed > 0) {
+        unsigned char *outlier;
+        outlier = (unsigned char *) malloc(new_nnodes*sizeof(unsigned char));
+        if (outlier == NULL) ExitError("when allocating memory for the outliers\n", 7);
+
+        printf("Removing outliers...\n");
+        noutliers = find_outliers(&nodes[*nnodes], shipnames, scrapping_times, new_nnodes, max_speed, outlier);
+        nkept = 0;
+        for (index = 0; index < new_nnodes; index++) {
+            if (outlier[index]) {
+                free(shipnames[index]);
+                free(scrapping_times[index]);
+                continue;
+            }
+            nodes[*nnodes+nkept] = nodes[*nnodes+index];
+            nodes[*nnodes+nkept].id = nkept;
+            shipnames[nkept] = shipnames[index];
+            scrapping_times[nkept] = scrapping_times[index];
+            shiptypes[nkept] = shiptypes[index];
+            nkept++;
+        }
+        free(outlier);
+        printf("Outliers removed: %lu\n", noutliers);
+    }
+
+    // 4. Initialize first path of the new data, if any node is left
+    if (nkept == 0) {
+        free(shipnames);
+        free(scrapping_times);
+        free(shiptypes);
+        printf("Added 0 nodes, 0 edges and 0 paths.\n");
+        return;
+    }
+
     unsigned long initial_nedges, initial_npaths;
     initial_nedges = *nedges;
     initial_npaths = *npaths;
@@ -131,13 +167,31 @@ void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes
 
     (*npaths)++;
 
-    // 4. Compute new edges and paths
+    // 5. Compute new edges and paths
     char *prev_shipname;
+    unsigned long nvoyages;
+    unsigned short same_voyage;
+    double travel_time, jump;
+
     prev_shipname = strdup(shipnames[0]);
     if (prev_shipname == NULL) ExitError("when copying the previ shipname", 4);
+    nvoyages = 0;
     printf("Computing edges and paths...\n");
-    for (index = 1; index < new_nnodes; index++) {
-        if (strcmp(shipnames[index], prev_shipname) == 0) {
+    for (index = 1; index < nkept; index++) {
+        same_voyage = strcmp(shipnames[index], prev_shipname) == 0;
+        if (same_voyage) {
+            // 5.1. Split the track of the ship if there is a gap in time or distance
+            travel_time = time_diff(scrapping_times[index-1], scrapping_times[index]);
+            if (max_time_gap > 0 && travel_time > max_time_gap) same_voyage = 0;
+            if (same_voyage && max_jump_km > 0) {
+                jump = distance_km(nodes[*nnodes+index-1].lon, nodes[*nnodes+index-1].lat,
+                                    nodes[*nnodes+index].lon, nodes[*nnodes+index].lat);
+                if (jump > max_jump_km) same_voyage = 0;
+            }
+            if (!same_voyage) nvoyages++;
+        }
+
+        if (same_voyage) {
             nodes[*nnodes+index-1].max_edges = 1;
             nodes[*nnodes+index-1].nedges = 1;
             nodes[*nnodes+index-1].to_nodes = (unsigned long *) malloc(sizeof(unsigned long));
@@ -147,7 +201,7 @@ void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes
             if (nodes[*nnodes+index-1].to_times == NULL) ExitError("when allocating memory for to_times", 6);
 
             nodes[*nnodes+index-1].to_nodes[0] = *nnodes + index;
-            nodes[*nnodes+index-1].to_times[0] = time_diff(scrapping_times[index-1], scrapping_times[index]);
+            nodes[*nnodes+index-1].to_times[0] = travel_time;
 
             update_path_coordinates(&paths[*npaths - 1], &nodes[*nnodes+index]);
             add_path_node(&paths[*npaths - 1], *nnodes + index);
@@ -175,17 +229,94 @@ void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes
         }
     }
 
-    // 5. Update and free allocated memory
-    *nnodes = *nnodes + new_nnodes;
+    // 6. Update and free allocated memory
+    *nnodes = *nnodes + nkept;
 
     free(shipnames);
     free(scrapping_times);
     free(shiptypes);
 
-    printf("Added %lu nodes, %lu edges and %lu paths.\n", new_nnodes, *nedges-initial_nedges, *npaths-initial_npaths);
+    printf("Added %lu nodes, %lu edges and %lu paths.\n", nkept, *nedges-initial_nedges, *npaths-initial_npaths);
+    printf("Tracks split in voyages: %lu\n", nvoyages);
     return;
 }
 
+unsigned long find_outliers(Node *nodes, char **shipnames, char **scrapping_times, unsigned long nnodes,
+                            double max_speed, unsigned char *outlier) {
+    // 1. Compute the times of the nodes with respect to the first one
+    double *times;
+    unsigned long index, noutliers;
+
+    times = (double *) malloc(nnodes * sizeof(double));
+    if (times == NULL) ExitError("when allocating memory for the times of the nodes", 1);
+    for (index = 0; index < nnodes; index++) times[index] = time_diff(scrapping_times[0], scrapping_times[index]);
+
+    // 2. Nodes with invalid coordinates
+    noutliers = 0;
+    for (index = 0; index < nnodes; index++) {
+        outlier[index] = (nodes[index].lat == 0 && nodes[index].lon == 0) ||
+                            fabs(nodes[index].lat) > 90 || fabs(nodes[index].lon) > 180;
+        if (outlier[index]) noutliers++;
+    }
+
+    // 3. Nodes with an implied speed too high, ship by ship
+    unsigned long first, last, prev, next, i, j;
+    unsigned checked;
+    unsigned short reachable, has_prev;
+
+    for (first = 0; first < nnodes; first = last) {
+        for (last = first + 1; last < nnodes && strcmp(shipnames[last], shipnames[first]) == 0; last++);
+
+        has_prev = 0;
+        prev = first;
+        for (i = first; i < last; i++) {
+            if (outlier[i]) continue;
+
+            // 3.1. The first valid node is an outlier if the next two valid nodes are consistent but it can not reach them
+            if (!has_prev) {
+                for (next = i + 1; next < last && outlier[next]; next++);
+                for (j = next + 1; j < last && outlier[j]; j++);
+                if (j < last &&
+                    implied_speed(nodes[i].lon, nodes[i].lat, nodes[next].lon, nodes[next].lat, times[next] - times[i]) > max_speed &&
+                    implied_speed(nodes[next].lon, nodes[next].lat, nodes[j].lon, nodes[j].lat, times[j] - times[next]) <= max_speed) {
+                    outlier[i] = 1;
+                    noutliers++;
+                    continue;
+                }
+                has_prev = 1;
+                prev = i;
+                continue;
+            }
+
+            if (implied_speed(nodes[prev].lon, nodes[prev].lat, nodes[i].lon, nodes[i].lat, times[i] - times[prev]) <= max_speed) {
+                prev = i;
+                continue;
+            }
+
+            // 3.2. The node is an outlier if the previous one can reach any of the following ones
+            reachable = 0;
+            checked = 0;
+            for (j = i + 1; j < last && checked < OUTLIER_LOOKAHEAD; j++) {
+                if (outlier[j]) continue;
+                checked++;
+                if (implied_speed(nodes[prev].lon, nodes[prev].lat, nodes[j].lon, nodes[j].lat, times[j] - times[prev]) <= max_speed) {
+                    reachable = 1;
+                    break;
+                }
+            }
+            if (reachable) {
+                outlier[i] = 1;
+                noutliers++;
+            } else {
+                prev = i;
+            }
+        }
+    }
+
+    free(times);
+    return noutliers;
+}
+
 void store_nodes(Node *nodes, Path *paths,
                 unsigned long nnodes, unsigned long nedges, unsigned long npaths, 
                         char *bin_filename) {
@@ -223,19 +354,13 @@ void store_nodes(Node *nodes, Path *paths,
     }
     
     // 6. Write paths
+    for (index = 0; index < npaths; index++) paths[index].max_paths = 0;
     if (fwrite(paths, sizeof(Path), npaths, bin_file) != npaths) {
         ExitError("when writing paths to the output binary data file", 6);
     }
 
     // 7. Write paths connections in blocks
-    for (index = 0; index < npaths; index++) {
-        paths[index].max_paths = paths[index].npaths;
-        if (paths[index].npaths) {
-            if (fwrite(paths[index].to_paths, sizeof(unsigned long), paths[index].npaths, bin_file) != paths[index].npaths) {
-                ExitError("when writing paths connected to the output binary file", 7);
-            }
-        }
-    }
+    // Only the watermark npaths is stored, as max_paths is written as 0 before the paths.
 
     // 8. Write paths' linked lists
     Path_node *curr_node;
@@ -527,14 +652,15 @@ void read_nodes(Node **nodes_ptr, Path **paths_ptr,
     }
 
     // 7. Read paths connections in blocks
+    // Only the files stored with the list of checked paths have them, with max_paths equal to npaths. They are skipped.
     for (index = 0; index < *npaths; index++) {
-        if (paths[index].npaths) {
-            paths[index].to_paths = (unsigned long *) malloc(paths[index].npaths*sizeof(unsigned long));
-            if (paths[index].to_paths == NULL) ExitError("when allocating memory for the paths connected", 11);
-            if (fread(paths[index].to_paths, sizeof(unsigned long), paths[index].npaths, bin_file) != paths[index].npaths) {
-                ExitError("when reading paths connected from the input binary data file", 12);
+        if (paths[index].max_paths && paths[index].npaths) {
+            if (fseek(bin_file, (long) (paths[index].npaths * sizeof(unsigned long)), SEEK_CUR) != 0) {
+                ExitError("when skipping paths connected from the input binary data file", 12);
             }
         }
+        paths[index].max_paths = 0;
+        paths[index].to_paths = NULL;
     }
 
     // 8. Read paths' linked lists
@@ -557,6 +683,52 @@ void read_nodes(Node **nodes_ptr, Path **paths_ptr,
     return;
 }
 
+void append_graph(Node **nodes_ptr, Path **paths_ptr,
+                unsigned long *nnodes, unsigned long *nedges, unsigned long *npaths,
+                char *bin_filename) {
+    // 1. Read the new graph
+    Node *new_nodes;
+    Path *new_paths;
+    unsigned long new_nnodes, new_nedges, new_npaths;
+
+    new_nodes = NULL;
+    new_paths = NULL;
+    read_nodes(&new_nodes, &new_paths, &new_nnodes, &new_nedges, &new_npaths, bin_filename);
+
+    // 2. Append the nodes, shifting their ids and the ids of their connected nodes
+    unsigned long index;
+    unsigned j;
+    *nodes_ptr = (Node *) realloc(*nodes_ptr, (*nnodes + new_nnodes) * sizeof(Node));
+    if (*nodes_ptr == NULL) ExitError("when reallocating memory for the appended nodes", 1);
+    for (index = 0; index < new_nnodes; index++) {
+        new_nodes[index].id += *nnodes;
+        for (j = 0; j < new_nodes[index].nedges; j++) new_nodes[index].to_nodes[j] += *nnodes;
+    }
+    memcpy(&(*nodes_ptr)[*nnodes], new_nodes, new_nnodes * sizeof(Node));
+
+    // 3. Append the paths, shifting their ids, the ids of their nodes and the last path they were checked with
+    Path_node *curr_node;
+    *paths_ptr = (Path *) realloc(*paths_ptr, (*npaths + new_npaths) * sizeof(Path));
+    if (*paths_ptr == NULL) ExitError("when reallocating memory for the appended paths", 2);
+    for (index = 0; index < new_npaths; index++) {
+        new_paths[index].id += *npaths;
+        if (new_paths[index].npaths) new_paths[index].npaths += *npaths;
+        for (curr_node = &new_paths[index].start_node; curr_node != NULL; curr_node = curr_node->next) curr_node->node_id += *nnodes;
+    }
+    memcpy(&(*paths_ptr)[*npaths], new_paths, new_npaths * sizeof(Path));
+
+    // 4. The paths of one node ended at their own start node, which has been moved
+    for (index = 0; index < *npaths + new_npaths; index++)
+        if ((*paths_ptr)[index].len <= 1) (*paths_ptr)[index].final_node = &(*paths_ptr)[index].start_node;
+
+    *nnodes += new_nnodes;
+    *nedges += new_nedges;
+    *npaths += new_npaths;
+    free(new_nodes);
+    free(new_paths);
+    return;
+}
+
 /*
     NODES MANAGEMENT AND TESTING
 */
@@ -595,6 +767,50 @@ void node_edge_verification(Node *nodes, unsigned long index) {
     }
     return;
 }
+
+double edge_time(Node *nodes, unsigned long from_id, unsigned long to_id) {
+    unsigned i;
+    for (i = 0; i < nodes[from_id].nedges; i++) {
+        if (nodes[from_id].to_nodes[i] == to_id) return nodes[from_id].to_times[i];
+    }
+    ExitError("when looking for an edge that does not exist", 1);
+    return 0.;
+}
+
+void build_reverse_graph(Node *nodes, unsigned long nnodes, Reverse_graph *reverse) {
+    // 1. Count the incoming edges of every node, shifted by one to accumulate them
+    unsigned long index, to_node, nedges;
+    unsigned i;
+    reverse->first = (unsigned long *) calloc(nnodes + 1, sizeof(unsigned long));
+    if (reverse->first == NULL) ExitError("when allocating memory for the incoming edges counter", 1);
+    for (index = 0; index < nnodes; index++) {
+        for (i = 0; i < nodes[index].nedges; i++) reverse->first[nodes[index].to_nodes[i] + 1]++;
+    }
+    for (index = 0; index < nnodes; index++) reverse->first[index + 1] += reverse->first[index];
+    nedges = reverse->first[nnodes];
+
+    // 2. Fill the rows, using first as the next free position of every one and shifting it back at the end
+    reverse->from_nodes = (unsigned long *) malloc((nedges ? nedges : 1) * sizeof(unsigned long));
+    reverse->from_times = (double *) malloc((nedges ? nedges : 1) * sizeof(double));
+    if (reverse->from_nodes == NULL || reverse->from_times == NULL) ExitError("when allocating memory for the incoming edges", 2);
+    for (index = 0; index < nnodes; index++) {
+        for (i = 0; i < nodes[index].nedges; i++) {
+            to_node = nodes[index].to_nodes[i];
+            reverse->from_nodes[reverse->first[to_node]] = index;
+            reverse->from_times[reverse->first[to_node]] = nodes[index].to_times[i];
+            reverse->first[to_node]++;
+        }
+    }
+    for (index = nnodes; index > 0; index--) reverse->first[index] = reverse->first[index - 1];
+    reverse->first[0] = 0;
+}
+
+void free_reverse_graph(Reverse_graph *reverse) {
+    free(reverse->first);
+    free(reverse->from_nodes);
+    free(reverse->from_times);
+}
+
 /*
     PATHS MANAGEMENT AND TESTING
 */
@@ -687,14 +903,12 @@ void free_paths(Path *paths, unsigned long npaths) {
             curr_path_node = curr_path_node->next;
             free(aux_path_node);
         }
-        if (paths[index].npaths) free(paths[index].to_paths);
     }
     free(paths);
     return;
 }
 
 void path_info(Path *paths, unsigned long index) {
-    unsigned i;
     if (paths[index].len == 0) {
         printf("Path %lu doesn't exist\n", index);
     } else {
@@ -702,11 +916,6 @@ void path_info(Path *paths, unsigned long index) {
                     paths[index].id, paths[index].start_node.node_id, paths[index].shiptype, 
                     paths[index].min_lon, paths[index].max_lon, paths[index].min_lat, paths[index].max_lat,
                     paths[index].npaths, paths[index].max_paths, paths[index].len);
-        if (paths[index].npaths) {
-            printf("     - Connected to:  ");
-            for (i = 0;  i < paths[index].npaths; i++) printf("%lu  ", paths[index].to_paths[i]);
-            printf("\n");
-        }
     }
     return;
 }
@@ -773,6 +982,12 @@ double distance_km(double lon_1, double lat_1, double lon_2, double lat_2) {
     return dist;
 }
 
+double implied_speed(double lon_1, double lat_1, double lon_2, double lat_2, double travel_time) {
+    double dist;
+    dist = distance_km(lon_1, lat_1, lon_2, lat_2);
+    if (travel_time < 1) travel_time = 1; // Reports with the same time
+    return dist / travel_time * 3600 / 1.852; // km/s to kn
+}
 
 /*
     AUXILIAR FUNCTIONS
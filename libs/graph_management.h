@@ -21,6 +21,8 @@ typedef struct path_node {
 } Path_node;
 
 // Stores all the relevant information about a path.
+// npaths is the last path whose intersections with this one are computed: all the paths until it are already checked.
+// to_paths and max_paths are not used anymore. They are kept so the binary files stored before can still be read.
 typedef struct path_start {
     Path_node start_node;
     Path_node *final_node;
@@ -34,6 +36,13 @@ typedef struct path_start {
     unsigned long len;
 } Path;
 
+// Stores the incoming edges of every node in compressed rows: the edges that reach the node i are from first[i] to first[i + 1]
+typedef struct {
+    unsigned long *first;
+    unsigned long *from_nodes;
+    double *from_times;
+} Reverse_graph;
+
 // Stores the shiptype and the number of paths of that shiptype
 typedef struct shiptype_counter {
     int shiptype;
@@ -41,6 +50,9 @@ typedef struct shiptype_counter {
     struct shiptype_counter *next;
 } ST_counter;
 
+// Number of following nodes of the same ship that are checked to decide whether a node is an outlier
+#define OUTLIER_LOOKAHEAD 3
+
 /*
     FILES MANAGEMENT FUNCTIONS
 */
@@ -49,12 +61,24 @@ unsigned long nnodes_in_csv(FILE *csv_file);
 
 /*
 Computes the new nodes from a csv file and appends from position nnodes the new_nnodes from the file.
+The nodes whose implied speed with respect to their neighbours is greater than max_speed knots are removed
+before computing the edges and paths, as well as the ones with invalid coordinates. Use 0 to disable it.
 Computes the new paths of nodes and adds them to paths.
+A ship track is split in different paths (voyages) when two adjacent nodes are separated more than
+max_time_gap seconds or max_jump_km kilometers. Use 0 to disable any of them.
 It updates the value of nnodes, npaths and nedges.
 */
 void add_nodes_from_csv(Node *nodes, Path *paths, unsigned long const new_nnodes,
                         unsigned long *nnodes, unsigned long *nedges, unsigned long *npaths,
-                        FILE *csv_file);
+                        double max_time_gap, double max_jump_km, double max_speed, FILE *csv_file);
+
+/*
+Marks in outlier the nodes that are placed at invalid coordinates, like (0, 0), or that imply a speed greater than max_speed
+knots with the previous valid node of the same ship, while one of the OUTLIER_LOOKAHEAD following nodes can be reached from it.
+Returns the number of outliers.
+*/
+unsigned long find_outliers(Node *nodes, char **shipnames, char **scrapping_times, unsigned long nnodes,
+                            double max_speed, unsigned char *outlier);
 
 // Stores all the nodes and paths in a binary file
 void store_nodes(Node *nodes, Path *paths,
@@ -73,6 +97,15 @@ void read_nodes(Node **nodes_ptr, Path **paths_ptr,
                 unsigned long *nnodes, unsigned long *nedges, unsigned long *npaths, 
                 char *bin_filename);
 
+/*
+ * Reads the stored graph in bin_filename and appends its nodes and paths after the ones of nodes and paths.
+ * The ids of the new nodes and paths are shifted, so they follow the existing ones. As every existing path keeps
+ * the last path it was checked with, only the pairs with a new path are computed when the intersections are computed again.
+*/
+void append_graph(Node **nodes_ptr, Path **paths_ptr,
+                unsigned long *nnodes, unsigned long *nedges, unsigned long *npaths,
+                char *bin_filename);
+
 /*
     NODES MANAGEMENT AND TESTING
 */
@@ -85,6 +118,15 @@ void node_info(Node *nodes, unsigned long index);
 // Prints all the info of the node in position index and its connected nodes
 void node_edge_verification(Node *nodes, unsigned long index);
 
+// Returns the travelling time of the edge that goes from the node from_id to the node to_id
+double edge_time(Node *nodes, unsigned long from_id, unsigned long to_id);
+
+// Builds the incoming edges of every node, with the same travelling times as the outgoing ones
+void build_reverse_graph(Node *nodes, unsigned long nnodes, Reverse_graph *reverse);
+
+// Frees the incoming edges
+void free_reverse_graph(Reverse_graph *reverse);
+
 /*
     PATHS MANAGEMENT
 */
@@ -116,6 +158,9 @@ double time_diff(char *initial_scraping_time, char *final_scraping_time);
 // Returns the distance, in km, between two coordinates, using the haversie formula
 double distance_km(double lon_1, double lat_1, double lon_2, double lat_2);
 
+// Returns the speed, in knots, needed to travel between two coordinates in travel_time seconds
+double implied_speed(double lon_1, double lat_1, double lon_2, double lat_2, double travel_time);
+
 
 /*
     AUXILIAR FUNCTIONS
@@ -7,21 +7,22 @@
         >> Through the header file "intersections.h"
 
     - Comments:
-        >> Only intersection type 1 is implemented.
+        >> Every intersection type is resolved: the crossings (type 1) get a new node, the edges that touch or overlap are split
+            at the existing nodes that lie inside the other edge and the coincident nodes are linked by edges of no travelling time.
         >> Intersection point computation: https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/1201356#1201356
         >> Two edges can intersect if and only if they belong to the same shiptype, different path and have not been joined before.
             Thus, it is possible to append new data and compute again the intersections without making redundant comprovations.
         >> The new edge takes the greatest speed.
-        >> The intersections type 1 are implemented once they are detected. 
+        >> Every engine finds the intersections of the original edges first, and they are spliced at once at the end.
+        >> The spatial grid stores the edges of the original graph. The pieces in which an edge is split are always inside
+            its bounding box, enlarged GRID_EPSILON to absorb the rounding of the new nodes, so they can be found through it.
     
     - Further development:
-        >> Implement more intersections types.
         >> Check if it is necessary to take into account any cosinus factor computing the orientation, as depending on the latitude, the longitude lines are closer. Euclidean space, not the plane.
         >> Check if the travel times need any modification due to the euclidean space, that is, checking that the proportions are the same as in a 2D plane.
 
     - Status:
-        >> Unfinished
-        >> It doesn't compute intersections type 0.
+        >> Finished
 
     $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
     $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
@@ -33,9 +34,13 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "graph_management.h"
+#include "sweep_line.h"
 #include "intersections.h"
+#include "segment_kernel.h"
 
 /*
     PATH MANAGEMENT
@@ -61,23 +66,27 @@ unsigned short need_compute_paths(Path *paths, unsigned long i_path_1, unsigned
 }
 
 void checked_paths(Path *paths, unsigned long i_path_1, unsigned long last_i_path_2) {
-    unsigned long index;
-    if (paths[i_path_1].npaths == 0) {
-        paths[i_path_1].max_paths = last_i_path_2;
-        paths[i_path_1].to_paths = (unsigned long *) malloc (paths[i_path_1].max_paths * sizeof(unsigned long));
-        if (paths[i_path_1].to_paths == NULL) ExitError("when allocating memory for the connected paths", 1);
-        
-        for (index = 0; index < i_path_1; index++) paths[i_path_1].to_paths[index] = index;
-        for (index = i_path_1 + 1; index <= last_i_path_2; index++) paths[i_path_1].to_paths[index-1] = index;
-        paths[i_path_1].npaths = last_i_path_2;
-    } else {
-        paths[i_path_1].max_paths = last_i_path_2;
-        paths[i_path_1].to_paths = (unsigned long *) realloc(paths[i_path_1].to_paths, paths[i_path_1].max_paths * sizeof(unsigned long));
-        if (paths[i_path_1].to_paths == NULL) ExitError("when reallocating memory for the connected paths", 2);
+    // All the paths until last Path 2 are checked in order, so the last one is enough to know which ones are left
+    if (last_i_path_2 > paths[i_path_1].npaths) paths[i_path_1].npaths = last_i_path_2;
+}
+
+unsigned char *pending_paths(Path *paths, unsigned long npaths) {
+    unsigned long i_path_1, i_path_2, initial_path_2;
+    unsigned char *pending;
 
-        for (index = paths[i_path_1].npaths + 1; index <= last_i_path_2; index++) paths[i_path_1].to_paths[index - 1] = index;
-        paths[i_path_1].npaths = last_i_path_2;
+    pending = (unsigned char *) calloc(npaths ? npaths : 1, sizeof(unsigned char));
+    if (pending == NULL) ExitError("when allocating memory for the pending paths", 1);
+    for (i_path_1 = 0; i_path_1 + 1 < npaths; i_path_1++) {
+        if (paths[i_path_1].npaths) initial_path_2 = paths[i_path_1].npaths + 1;
+        else initial_path_2 = i_path_1 + 1;
+        for (i_path_2 = initial_path_2; i_path_2 < npaths; i_path_2++) {
+            if (need_compute_paths(paths, i_path_1, i_path_2)) {
+                pending[i_path_1] |= PENDING_PATH_1;
+                pending[i_path_2] |= PENDING_PATH_2;
+            }
+        }
     }
+    return pending;
 }
 
 /*
@@ -104,6 +113,9 @@ unsigned short identify_intersection(Node *p1, Node *q1, Node *p2, Node *q2, dou
         *u = p1p2Xp1q1 / p1q1Xp2q2;
 
         if (*t >= 0 && *t <= 1 && *u >= 0 && *u <= 1) {
+            // Almost parallel edges give meaningless parameters: the point must be the same on both edges, within GRID_EPSILON
+            if (fabs(p1->lon + *t * (q1->lon - p1->lon) - p2->lon - *u * (q2->lon - p2->lon)) > GRID_EPSILON ||
+                fabs(p1->lat + *t * (q1->lat - p1->lat) - p2->lat - *u * (q2->lat - p2->lat)) > GRID_EPSILON) return 0;
             if (*t > 0 && *t < 1 && *u > 0 && *u < 1) return 1;
             else if (*t > 0 && *t < 1 && *u == 0) return 2;
             else if (*t > 0 && *t < 1 && *u == 1) return 3;
@@ -139,83 +151,1097 @@ unsigned short identify_intersection(Node *p1, Node *q1, Node *p2, Node *q2, dou
     }
 }
 
-void add_intersection(Node **nodes_ptr, unsigned long *nnodes, unsigned long *max_nnodes, unsigned long *nedges,
-                    unsigned long p1_id, unsigned long q1_id, unsigned long p2_id, unsigned long q2_id, 
-                    unsigned short intersection_type, double t, double u,
-                    Path *paths, unsigned long i_path_1, unsigned long i_path_2,
-                    Path_node *p1, Path_node *p2) {
-    if (intersection_type != 1) return;
-    else {
-        // 1. Select nodes and initialize the new one
-        Node *node_p1 = &(*nodes_ptr)[p1_id];
-        Node *node_q1 = &(*nodes_ptr)[q1_id];
-        Node *node_p2 = &(*nodes_ptr)[p2_id];
-        Node *node_q2 = &(*nodes_ptr)[q2_id];
-        Node *new_node;
-        new_node = (Node *) malloc(sizeof(Node));
-        if (new_node == NULL) ExitError("when allocating memory for the new node", 1);
-
-        // 2. Assign parameters to the new node
-        new_node->id = *nnodes;
+unsigned short append_node_edge(Node *node, unsigned long to_id, double time) {
+    if (node->nedges == 0) {
+        node->to_nodes = NULL;
+        node->to_times = NULL;
+    }
+    node->to_nodes = (unsigned long *) realloc(node->to_nodes, (node->nedges + 1) * sizeof(unsigned long));
+    node->to_times = (double *) realloc(node->to_times, (node->nedges + 1) * sizeof(double));
+    if (node->to_nodes == NULL || node->to_times == NULL) ExitError("when reallocating memory for the edges of a node", 1);
+    node->to_nodes[node->nedges] = to_id;
+    node->to_times[node->nedges] = time;
+    node->max_edges = node->nedges + 1;
+    return node->nedges++;
+}
+
+unsigned long touching_splits(Node *p1, Node *q1, Node *p2, Node *q2, Crossing *crossing, unsigned short intersection_type,
+                            double t, double u, Edge_split *splits) {
+    // 1. Find the endpoints that lie inside the other edge and their parameter along it
+    Node *inside[4];
+    double params[4];
+    unsigned short on_edge_2[4];
+    unsigned long ninside, index, nsplits;
+
+    ninside = 0;
+    if (intersection_type == 2 || intersection_type == 3) {
+        inside[ninside] = intersection_type == 2 ? p2 : q2;
+        params[ninside] = t;
+        on_edge_2[ninside++] = 0;
+    } else if (intersection_type == 4 || intersection_type == 5) {
+        inside[ninside] = intersection_type == 4 ? p1 : q1;
+        params[ninside] = u;
+        on_edge_2[ninside++] = 1;
+    } else if (intersection_type >= 10) {
+        // t and u are the parameters of p2 and q2 along edge 1, so p1 and q1 are at -t / (u - t) and (1 - t) / (u - t) along edge 2
+        inside[0] = p2;
+        params[0] = t;
+        inside[1] = q2;
+        params[1] = u;
+        inside[2] = p1;
+        params[2] = -t / (u - t);
+        inside[3] = q1;
+        params[3] = (1 - t) / (u - t);
+        for (index = 0; index < 4; index++) if (params[index] > 0 && params[index] < 1) {
+            inside[ninside] = inside[index];
+            params[ninside] = params[index];
+            on_edge_2[ninside++] = index >= 2;
+        }
+    }
+
+    // 2. Split the other edge at every one of them, unless it is already one of its ends
+    nsplits = 0;
+    for (index = 0; index < ninside; index++) {
+        if (on_edge_2[index]) {
+            if (inside[index]->id == p2->id || inside[index]->id == q2->id) continue;
+            splits[nsplits].path = crossing->path_2;
+            splits[nsplits].seg = crossing->seg_2;
+        } else {
+            if (inside[index]->id == p1->id || inside[index]->id == q1->id) continue;
+            splits[nsplits].path = crossing->path_1;
+            splits[nsplits].seg = crossing->seg_1;
+        }
+        splits[nsplits].param = params[index];
+        splits[nsplits].node_id = inside[index]->id;
+        splits[nsplits].edge = 0;
+        nsplits++;
+    }
+    return nsplits;
+}
+
+void splice_crossings(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, Segment_grid *grid,
+                    Crossing *crossings, unsigned long ncrossings, Intersections_counter *counter, Intersections_arena *arena) {
+    // 1. Allocate the new nodes at once
+    Node *nodes, *node_p1, *node_q1, *node_p2, *node_q2, *new_node;
+    Edge_split *splits;
+    Node_link *links;
+    unsigned long index, nsplits, nlinks, new_id;
+    unsigned short intersection_type;
+    double t, u;
+
+    *nodes_ptr = (Node *) realloc(*nodes_ptr, (*nnodes + ncrossings) * sizeof(Node));
+    splits = (Edge_split *) malloc(2 * ncrossings * sizeof(Edge_split));
+    links = (Node_link *) malloc(ncrossings * sizeof(Node_link));
+    if (*nodes_ptr == NULL) ExitError("when reallocating memory for the nodes array", 1);
+    if (splits == NULL) ExitError("when allocating memory for the edge splits", 2);
+    if (links == NULL) ExitError("when allocating memory for the node links", 3);
+    nodes = *nodes_ptr;
+
+    // 2. Create a node per crossing, numbered in order, and store where every edge is split
+    nsplits = 0;
+    nlinks = 0;
+    new_id = *nnodes;
+    for (index = 0; index < ncrossings; index++) {
+        node_p1 = &nodes[grid->seg_starts[crossings[index].path_1][crossings[index].seg_1]->node_id];
+        node_q1 = &nodes[grid->seg_starts[crossings[index].path_1][crossings[index].seg_1 + 1]->node_id];
+        node_p2 = &nodes[grid->seg_starts[crossings[index].path_2][crossings[index].seg_2]->node_id];
+        node_q2 = &nodes[grid->seg_starts[crossings[index].path_2][crossings[index].seg_2 + 1]->node_id];
+        intersection_type = identify_intersection(node_p1, node_q1, node_p2, node_q2, &t, &u);
+        if (intersection_type == 0) {
+            counter->ignored++;
+            continue;
+        }
+
+        // 2.1. The edges that touch or overlap are split at the existing nodes, and the coincident nodes are linked
+        if (intersection_type != 1) {
+            counter->touching++;
+            if (intersection_type >= 6 && intersection_type <= 9) {
+                links[nlinks].from = intersection_type == 6 || intersection_type == 8 ? node_p1->id : node_q1->id;
+                links[nlinks].to = intersection_type == 6 || intersection_type == 7 ? node_p2->id : node_q2->id;
+                if (links[nlinks].from > links[nlinks].to) {
+                    links[nlinks].from = links[nlinks].to;
+                    links[nlinks].to = intersection_type == 6 || intersection_type == 8 ? node_p1->id : node_q1->id;
+                }
+                if (links[nlinks].from != links[nlinks].to) nlinks++;
+            } else nsplits += touching_splits(node_p1, node_q1, node_p2, node_q2, &crossings[index], intersection_type, t, u,
+                                            &splits[nsplits]);
+            continue;
+        }
+
+        new_node = &nodes[new_id];
+        new_node->id = new_id;
         new_node->lat = node_p1->lat + t * (node_q1->lat - node_p1->lat);
         new_node->lon = node_p1->lon + t * (node_q1->lon - node_p1->lon);
-        new_node->speed = node_p1->speed > node_p2->speed ? node_p1->speed : node_p2->speed; // Canviar a quedarte amb la maxima.
+        new_node->speed = node_p1->speed > node_p2->speed ? node_p1->speed : node_p2->speed;
         new_node->nedges = 2;
         new_node->max_edges = 2;
-        new_node->to_nodes = (unsigned long *) malloc(new_node->max_edges * sizeof(unsigned long));
-        new_node->to_times = (double *) malloc(new_node->max_edges * sizeof(double));
-        if (new_node->to_nodes == NULL) ExitError("when allocating memory for the new node connected nodes", 2);
-        if (new_node->to_times == NULL) ExitError("when allocating memory for the new node travelling times", 3);
-
-        new_node->to_nodes[0] = node_q1->id;
-        new_node->to_nodes[1] = node_q2->id;
-
-        int i, j;
-        i = 0;
-        while (node_p1->to_nodes[i] != q1_id) i++;
-        j = 0;
-        while (node_p2->to_nodes[j] != q2_id) j++;
-
-        double edge1 = node_p1->to_times[i];
-        double edge2 = node_p2->to_times[j];
-
-        new_node->to_times[0] = (1 - t) * node_p1->to_times[i];
-        new_node->to_times[1] = (1 - u) * node_p2->to_times[j];
-
-        node_p1->to_nodes[i] = new_node->id;
-        node_p2->to_nodes[j] = new_node->id;
-        node_p1->to_times[i] = t * node_p1->to_times[i];
-        node_p2->to_times[j] = u * node_p2->to_times[j];
-
-        // 3. Update paths 1 and 2
-        
-        paths[i_path_1].len++;
-        paths[i_path_2].len++;
-
-        Path_node *new_path_node_1, *new_path_node_2;
-        new_path_node_1 = (Path_node *) malloc(sizeof(Path_node));
-        new_path_node_2 = (Path_node *) malloc(sizeof(Path_node));
-        if (new_path_node_1 == NULL) ExitError("when allocating memory for the new path node", 4);
-        if (new_path_node_2 == NULL) ExitError("when allocating memory for the new path node", 5);
-        
-        new_path_node_1->node_id = new_node->id;
-        new_path_node_1->next = p1->next;
-        p1->next = new_path_node_1;
-
-        new_path_node_2->node_id = new_node->id;
-        new_path_node_2->next = p2->next;
-        p2->next = new_path_node_2;
-
-        // 4. Update nnodes and nedges
-        *nedges = *nedges + 2;
-        (*nnodes)++;
-
-        // 5. Add the new node to nodes
-        if (*nnodes > *max_nnodes) {
-            *max_nnodes = *max_nnodes * 2;
-            (*nodes_ptr) = (Node *) realloc((*nodes_ptr), *max_nnodes * sizeof(Node));
-            if (*nodes_ptr == NULL) ExitError("when reallocating memory for the nodes array", 6);
-        }
-        (*nodes_ptr)[new_node->id] = *new_node;
+        new_node->to_nodes = (unsigned long *) arena_alloc(&arena->edges, new_node->max_edges * (sizeof(unsigned long) + sizeof(double)));
+        new_node->to_times = (double *) &new_node->to_nodes[new_node->max_edges];
+
+        splits[nsplits].path = crossings[index].path_1;
+        splits[nsplits].seg = crossings[index].seg_1;
+        splits[nsplits].param = t;
+        splits[nsplits].node_id = new_id;
+        splits[nsplits].edge = 0;
+        nsplits++;
+        splits[nsplits].path = crossings[index].path_2;
+        splits[nsplits].seg = crossings[index].seg_2;
+        splits[nsplits].param = u;
+        splits[nsplits].node_id = new_id;
+        splits[nsplits].edge = 1;
+        nsplits++;
+        new_id++;
+    }
+    *nedges = *nedges + 2 * (new_id - *nnodes);
+
+    // 3. Sort the splits along every edge, drop the repeated ones and add an edge to the existing nodes where an edge is split
+    unsigned long first, last, split, i_edge, nkept, repeated;
+
+    qsort(splits, nsplits, sizeof(Edge_split), compare_edge_splits);
+    nkept = 0;
+    for (split = 0; split < nsplits; split++) {
+        if (splits[split].node_id < *nnodes) {
+            for (repeated = nkept; repeated > 0 && splits[repeated - 1].path == splits[split].path &&
+                    splits[repeated - 1].seg == splits[split].seg && splits[repeated - 1].node_id != splits[split].node_id; repeated--);
+            if (repeated > 0 && splits[repeated - 1].path == splits[split].path && splits[repeated - 1].seg == splits[split].seg) continue;
+
+            // The edge points to the node itself until the split is done, so it is never taken for an edge of the path
+            splits[split].edge = append_node_edge(&nodes[splits[split].node_id], splits[split].node_id, 0.);
+            (*nedges)++;
+        }
+        splits[nkept++] = splits[split];
+    }
+    nsplits = nkept;
+    *nnodes = new_id;
+
+    // 4. Split every edge in its pieces, sorted along it, and insert the new nodes in the path
+    Node *prev_node;
+    unsigned i_prev_edge;
+    double edge_time, prev_param;
+    Path_node *prev_path_node, *new_path_node;
+
+    for (first = 0; first < nsplits; first = last) {
+        for (last = first + 1; last < nsplits && splits[last].path == splits[first].path && splits[last].seg == splits[first].seg; last++);
+
+        prev_path_node = grid->seg_starts[splits[first].path][splits[first].seg];
+        prev_node = &nodes[prev_path_node->node_id];
+        i_prev_edge = 0;
+        while (i_prev_edge < prev_node->nedges &&
+                prev_node->to_nodes[i_prev_edge] != grid->seg_starts[splits[first].path][splits[first].seg + 1]->node_id) i_prev_edge++;
+        if (i_prev_edge == prev_node->nedges) ExitError("when splitting an edge that does not exist", 5);
+        edge_time = prev_node->to_times[i_prev_edge];
+        prev_param = 0.;
+
+        for (split = first; split < last; split++) {
+            i_edge = prev_node->to_nodes[i_prev_edge];
+            prev_node->to_nodes[i_prev_edge] = splits[split].node_id;
+            prev_node->to_times[i_prev_edge] = (splits[split].param - prev_param) * edge_time;
+
+            // The path nodes of the existing nodes are not released with the arena, so they are freed with the paths
+            if (splits[split].node_id < arena->first_node) {
+                new_path_node = (Path_node *) malloc(sizeof(Path_node));
+                if (new_path_node == NULL) ExitError("when allocating memory for a path node", 6);
+            } else new_path_node = (Path_node *) arena_alloc(&arena->path_nodes, sizeof(Path_node));
+            new_path_node->node_id = splits[split].node_id;
+            new_path_node->next = prev_path_node->next;
+            prev_path_node->next = new_path_node;
+
+            prev_node = &nodes[splits[split].node_id];
+            i_prev_edge = splits[split].edge;
+            prev_node->to_nodes[i_prev_edge] = i_edge;
+            prev_node->to_times[i_prev_edge] = (1 - splits[split].param) * edge_time;
+            prev_param = splits[split].param;
+            prev_path_node = new_path_node;
+        }
+        paths[splits[first].path].len += last - first;
+    }
+
+    // 5. Link the coincident nodes of different paths both ways with edges of no travelling time
+    qsort(links, nlinks, sizeof(Node_link), compare_node_links);
+    for (index = 0; index < nlinks; index++) {
+        if (index && links[index].from == links[index - 1].from && links[index].to == links[index - 1].to) continue;
+        for (i_edge = 0; i_edge < nodes[links[index].from].nedges && nodes[links[index].from].to_nodes[i_edge] != links[index].to; i_edge++);
+        if (i_edge == nodes[links[index].from].nedges) {
+            append_node_edge(&nodes[links[index].from], links[index].to, 0.);
+            (*nedges)++;
+        }
+        for (i_edge = 0; i_edge < nodes[links[index].to].nedges && nodes[links[index].to].to_nodes[i_edge] != links[index].from; i_edge++);
+        if (i_edge == nodes[links[index].to].nedges) {
+            append_node_edge(&nodes[links[index].to], links[index].from, 0.);
+            (*nedges)++;
+        }
+    }
+    free(splits);
+    free(links);
+}
+
+int compare_edge_splits(const void *a, const void *b) {
+    const Edge_split *split_a = (const Edge_split *) a;
+    const Edge_split *split_b = (const Edge_split *) b;
+    if (split_a->path != split_b->path) return split_a->path < split_b->path ? -1 : 1;
+    if (split_a->seg != split_b->seg) return split_a->seg < split_b->seg ? -1 : 1;
+    if (split_a->param != split_b->param) return split_a->param < split_b->param ? -1 : 1;
+    if (split_a->node_id != split_b->node_id) return split_a->node_id < split_b->node_id ? -1 : 1;
+    return 0;
+}
+
+int compare_node_links(const void *a, const void *b) {
+    const Node_link *link_a = (const Node_link *) a;
+    const Node_link *link_b = (const Node_link *) b;
+    if (link_a->from != link_b->from) return link_a->from < link_b->from ? -1 : 1;
+    if (link_a->to != link_b->to) return link_a->to < link_b->to ? -1 : 1;
+    return 0;
+}
+
+void push_crossing(Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings,
+                    unsigned long path_1, unsigned long seg_1, unsigned long path_2, unsigned long seg_2, unsigned short type) {
+    if (*ncrossings == *max_crossings) {
+        *max_crossings = *max_crossings ? 2 * *max_crossings : 64;
+        *crossings_ptr = (Crossing *) realloc(*crossings_ptr, *max_crossings * sizeof(Crossing));
+        if (*crossings_ptr == NULL) ExitError("when reallocating memory for the crossings", 1);
+    }
+    (*crossings_ptr)[*ncrossings].path_1 = path_1;
+    (*crossings_ptr)[*ncrossings].seg_1 = seg_1;
+    (*crossings_ptr)[*ncrossings].path_2 = path_2;
+    (*crossings_ptr)[*ncrossings].seg_2 = seg_2;
+    (*crossings_ptr)[*ncrossings].type = type;
+    (*ncrossings)++;
+}
+
+unsigned long pair_crossings_all(Node *nodes, Segment_grid *grid, unsigned long i_path_1, unsigned long i_path_2,
+                                Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings) {
+    unsigned long seg_1, seg_2, computed;
+    unsigned short intersection_type;
+    double t, u;
+
+    computed = 0;
+    for (seg_1 = 0; seg_1 < grid->nsegs[i_path_1]; seg_1++) {
+        for (seg_2 = 0; seg_2 < grid->nsegs[i_path_2]; seg_2++) {
+            intersection_type = identify_intersection(&nodes[grid->seg_starts[i_path_1][seg_1]->node_id],
+                                                    &nodes[grid->seg_starts[i_path_1][seg_1 + 1]->node_id],
+                                                    &nodes[grid->seg_starts[i_path_2][seg_2]->node_id],
+                                                    &nodes[grid->seg_starts[i_path_2][seg_2 + 1]->node_id], &t, &u);
+            if (intersection_type == 0) continue;
+            if (intersection_type == 1) computed++;
+            push_crossing(crossings_ptr, ncrossings, max_crossings, i_path_1, seg_1, i_path_2, seg_2, intersection_type);
+        }
+    }
+    return computed;
+}
+
+void compute_intersections(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, unsigned long npaths,
+                            int engine, double cell_size, int nthreads, unsigned long *int_per_path, Intersections_counter *counter,
+                            Intersections_arena *arena, Intersections_checkpoint *checkpoint, Intersections_telemetry *telemetry) {
+    unsigned long i_path_1, i_path_2, initial_path_2, pair_intersections, initial_max_candidates, initial_max_crossings;
+    unsigned long first_new_node;
+    unsigned short compute_paths;
+    Segment_grid grid;
+    Grid_candidate *candidates;
+    Crossing *crossings;
+    unsigned char *pending;
+    unsigned long ncandidates, max_candidates, first_candidate, last_candidate;
+    unsigned long ncrossings, max_crossings, first_crossing, last_crossing, napplied, i_crossing;
+
+    // 1. Prepare the engine
+    if (checkpoint != NULL && engine > Uniform_grid) {
+        printf("Checkpoints are only stored by the nested loop and uniform grid engines\n");
+        checkpoint = NULL;
+    }
+    if (checkpoint == NULL || checkpoint->first_path == 0) {
+        counter->computed = 0;
+        counter->ignored = 0;
+        counter->touching = 0;
+        counter->pairs_checked = 0;
+        counter->pairs_computed = 0;
+        for (i_path_1 = 0; i_path_1 < npaths; i_path_1++) int_per_path[i_path_1] = 0;
+    }
+    if (checkpoint != NULL) {
+        checkpoint->last_time = time(NULL);
+        if (checkpoint->first_path == 0) checkpoint->nnodes = *nnodes;
+        else if (checkpoint->nnodes > *nnodes) ExitError("the checkpoint does not match the graph", 2);
+    }
+    // The grid always covers the original edges, even if the graph of a checkpoint had new nodes
+    first_new_node = checkpoint != NULL ? checkpoint->nnodes : *nnodes;
+    memset(&grid, 0, sizeof(Segment_grid));
+    candidates = NULL;
+    crossings = NULL;
+    ncandidates = 0;
+    max_candidates = 0;
+    ncrossings = 0;
+    max_crossings = 0;
+    first_crossing = 0;
+    napplied = 0;
+    init_intersections_arena(arena, *nnodes);
+    if (engine == Parallel_grid) {
+        if (nthreads <= 0) nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads <= 0) nthreads = 1;
+    } else nthreads = 1;
+    if (telemetry != NULL) {
+        init_telemetry(telemetry, paths, npaths, nthreads, arena);
+        if (checkpoint != NULL) for (i_path_1 = 0; i_path_1 < checkpoint->first_path; i_path_1++) finish_path_telemetry(telemetry, 0, i_path_1);
+    }
+    if (checkpoint != NULL && checkpoint->first_path > 0) {
+        // The crossings found before the checkpoint are kept, and the ones of the following paths appended to them
+        crossings = checkpoint->crossings;
+        napplied = checkpoint->ncrossings;
+        max_crossings = napplied;
+        checkpoint->crossings = NULL;
+    }
+
+    // Only the paths with a pair to compute are indexed, so appending paths costs in proportion to them.
+    // The edges of the paths of the crossings of a checkpoint are kept too, as they are spliced at the end.
+    pending = pending_paths(paths, npaths);
+    for (i_crossing = 0; i_crossing < napplied; i_crossing++) {
+        pending[crossings[i_crossing].path_1] |= PENDING_PATH_1;
+        pending[crossings[i_crossing].path_2] |= PENDING_PATH_1;
+    }
+    if (engine == Nested_loop) {
+        create_segment_starts(&grid, paths, npaths, first_new_node, pending);
+    } else if (engine == Uniform_grid) {
+        create_segment_grid(&grid, *nodes_ptr, paths, npaths, first_new_node, pending, cell_size);
+        printf("Grid cell size: %g degrees\n", grid.cell_size);
+    } else if (engine == Sweep_line) {
+        create_segment_starts(&grid, paths, npaths, first_new_node, pending);
+        ncrossings = sweep_crossings(*nodes_ptr, paths, npaths, pending, &crossings);
+        qsort(crossings, ncrossings, sizeof(Crossing), compare_crossings);
+        if (telemetry != NULL) {
+            telemetry->threads[0].crossings = ncrossings;
+            telemetry->threads[0].bytes_allocated = ncrossings * sizeof(Crossing);
+            telemetry->threads[0].work_done = telemetry->total_work;
+        }
+        printf("Crossings found by the sweep line: %lu\n", ncrossings);
+    } else if (engine == Parallel_grid) {
+        create_segment_grid(&grid, *nodes_ptr, paths, npaths, first_new_node, pending, cell_size);
+        printf("Grid cell size: %g degrees\n", grid.cell_size);
+        ncrossings = detect_crossings_parallel(*nodes_ptr, paths, npaths, &grid, nthreads, &crossings, telemetry);
+        printf("Crossings found by %d threads: %lu\n", nthreads, ncrossings);
+    } else if (engine == Vector_loop) {
+        create_segment_starts(&grid, paths, npaths, first_new_node, pending);
+        ncrossings = kernel_crossings(*nodes_ptr, paths, npaths, pending, &crossings, telemetry);
+        printf("Crossings found by the vectorised loop: %lu\n", ncrossings);
+    } else ExitError("when selecting the intersections engine", 1);
+
+    // 2. Compute every pair of paths
+    for (i_path_1 = checkpoint != NULL ? checkpoint->first_path : 0; i_path_1 + 1 < npaths; i_path_1++) {
+        if (paths[i_path_1].npaths) initial_path_2 = paths[i_path_1].npaths + 1;
+        else initial_path_2 = i_path_1 + 1;
+        if (initial_path_2 > npaths) break;
+
+        // 2.1. Select the pairs of edges that share a cell of the grid. A path 1 that is not pending has no pair to compute,
+        // so its pairs are only counted as checked.
+        initial_max_candidates = max_candidates;
+        initial_max_crossings = max_crossings;
+        if ((pending[i_path_1] & PENDING_PATH_1) == 0) {
+            counter->pairs_checked += npaths - initial_path_2;
+            if (telemetry != NULL) {
+                telemetry->threads[0].pairs_examined += npaths - initial_path_2;
+                telemetry->threads[0].pairs_pruned += npaths - initial_path_2;
+            }
+        } else if (engine == Uniform_grid) ncandidates = grid_candidates(&grid, *nodes_ptr, paths, npaths, i_path_1, initial_path_2,
+                                                                        &candidates, &max_candidates);
+        if (telemetry != NULL) telemetry->threads[0].bytes_allocated += (max_candidates - initial_max_candidates) * sizeof(Grid_candidate);
+        first_candidate = 0;
+        while (first_crossing < ncrossings && crossings[first_crossing].path_1 < i_path_1) first_crossing++;
+
+        for (i_path_2 = pending[i_path_1] & PENDING_PATH_1 ? initial_path_2 : npaths; i_path_2 < npaths; i_path_2++) {
+            // 2.2. Check whether it is necessary or not to compute these pair of paths
+            compute_paths = need_compute_paths(paths, i_path_1, i_path_2);
+            counter->pairs_checked++;
+            while (first_candidate < ncandidates && candidates[first_candidate].path_2 < i_path_2) first_candidate++;
+            for (last_candidate = first_candidate; last_candidate < ncandidates &&
+                    candidates[last_candidate].path_2 == i_path_2; last_candidate++);
+            while (first_crossing < ncrossings && crossings[first_crossing].path_1 == i_path_1 &&
+                    crossings[first_crossing].path_2 < i_path_2) first_crossing++;
+            for (last_crossing = first_crossing; last_crossing < ncrossings && crossings[last_crossing].path_1 == i_path_1 &&
+                    crossings[last_crossing].path_2 == i_path_2; last_crossing++);
+            if (telemetry != NULL) {
+                telemetry->threads[0].pairs_examined++;
+                if (compute_paths == 0) telemetry->threads[0].pairs_pruned++;
+                else if (engine == Uniform_grid) telemetry->threads[0].segment_tests += last_candidate - first_candidate;
+                else if (engine == Nested_loop) telemetry->threads[0].segment_tests += (paths[i_path_1].len - 1) * (paths[i_path_2].len - 1);
+            }
+            if (compute_paths == 0) continue;
+            counter->pairs_computed++;
+
+            // 2.3. Find the intersections. They are kept to be spliced at the end, in order of the pair of paths.
+            // Only the type 1 add a node.
+            if (engine == Uniform_grid) {
+                pair_intersections = pair_crossings(*nodes_ptr, &grid, i_path_1, i_path_2, &candidates[first_candidate],
+                                                    last_candidate - first_candidate, &crossings, &napplied, &max_crossings);
+            } else if (engine == Nested_loop) {
+                pair_intersections = pair_crossings_all(*nodes_ptr, &grid, i_path_1, i_path_2, &crossings, &napplied, &max_crossings);
+            } else {
+                memmove(&crossings[napplied], &crossings[first_crossing], (last_crossing - first_crossing) * sizeof(Crossing));
+                pair_intersections = 0;
+                for (i_crossing = napplied; i_crossing < napplied + last_crossing - first_crossing; i_crossing++)
+                    if (crossings[i_crossing].type == 1) pair_intersections++;
+                napplied += last_crossing - first_crossing;
+            }
+            counter->computed += pair_intersections;
+            if (telemetry != NULL && (engine == Nested_loop || engine == Uniform_grid)) telemetry->threads[0].crossings += pair_intersections;
+            int_per_path[i_path_1] += pair_intersections;
+            int_per_path[i_path_2] += pair_intersections;
+            checked_paths(paths, i_path_1, i_path_2);
+        }
+        // The pairs that are not computed are checked too, so the paths appended later start after the last one
+        checked_paths(paths, i_path_1, npaths - 1);
+        if (telemetry != NULL) {
+            if (engine == Nested_loop || engine == Uniform_grid) {
+                telemetry->threads[0].bytes_allocated += (max_crossings - initial_max_crossings) * sizeof(Crossing);
+                finish_path_telemetry(telemetry, 0, i_path_1);
+            }
+            tick_telemetry(telemetry);
+        }
+
+        // 2.4. Store the progress periodically
+        if (checkpoint != NULL && difftime(time(NULL), checkpoint->last_time) >= checkpoint->interval) {
+            printf("\rStoring checkpoint at path 1: %lu out of %lu\n", i_path_1 + 1, npaths);
+            store_checkpoint(checkpoint, *nodes_ptr, paths, *nnodes, *nedges, npaths, i_path_1 + 1, engine, int_per_path, counter,
+                            crossings, napplied);
+            checkpoint->last_time = time(NULL);
+        }
+    }
+
+    // 3. Split the crossed edges at once
+    if (napplied) splice_crossings(nodes_ptr, nnodes, nedges, paths, &grid, crossings, napplied, counter, arena);
+    if (telemetry != NULL) {
+        report_telemetry(telemetry);
+        printf("\n");
+        if (telemetry->filename != NULL) store_telemetry(telemetry, engine, counter);
+        free_telemetry(telemetry);
+    }
+
+    // 4. Free allocated memory
+    free(candidates);
+    free(crossings);
+    free(pending);
+    free_segment_grid(&grid, npaths);
+}
+
+
+/*
+    CHECKPOINTS
+*/
+
+void store_checkpoint(Intersections_checkpoint *checkpoint, Node *nodes, Path *paths, unsigned long nnodes, unsigned long nedges,
+                    unsigned long npaths, unsigned long next_path, int engine, unsigned long *int_per_path, Intersections_counter *counter,
+                    Crossing *crossings, unsigned long ncrossings) {
+    // 1. Store the graph in a temporary file
+    char *tmp_filename;
+    FILE *checkpoint_file;
+    unsigned long trailer[6];
+
+    tmp_filename = (char *) malloc(strlen(checkpoint->filename) + 5);
+    if (tmp_filename == NULL) ExitError("when allocating memory for the temporary checkpoint filename", 1);
+    sprintf(tmp_filename, "%s.tmp", checkpoint->filename);
+    store_nodes(nodes, paths, nnodes, nedges, npaths, tmp_filename);
+
+    // 2. Append the progress
+    checkpoint_file = fopen(tmp_filename, "ab");
+    if (checkpoint_file == NULL) ExitError("when opening the checkpoint file", 2);
+    trailer[0] = next_path;
+    trailer[1] = (unsigned long) engine;
+    trailer[2] = npaths;
+    trailer[3] = checkpoint->nnodes;
+    trailer[4] = ncrossings;
+    trailer[5] = CHECKPOINT_MAGIC;
+    if (fwrite(int_per_path, sizeof(unsigned long), npaths, checkpoint_file) != npaths ||
+        fwrite(counter, sizeof(Intersections_counter), 1, checkpoint_file) != 1 ||
+        fwrite(crossings, sizeof(Crossing), ncrossings, checkpoint_file) != ncrossings ||
+        fwrite(trailer, sizeof(unsigned long), 6, checkpoint_file) != 6) ExitError("when writing the checkpoint file", 3);
+    if (fclose(checkpoint_file) != 0) ExitError("when closing the checkpoint file", 4);
+
+    // 3. Replace the previous checkpoint
+    if (rename(tmp_filename, checkpoint->filename) != 0) ExitError("when renaming the checkpoint file", 5);
+    free(tmp_filename);
+}
+
+unsigned short read_checkpoint(Intersections_checkpoint *checkpoint, unsigned long npaths, int engine,
+                            unsigned long *int_per_path, Intersections_counter *counter) {
+    FILE *checkpoint_file;
+    unsigned long trailer[6];
+
+    checkpoint->first_path = 0;
+    checkpoint->crossings = NULL;
+    checkpoint->ncrossings = 0;
+    checkpoint_file = fopen(checkpoint->filename, "rb");
+    if (checkpoint_file == NULL) return 0;
+
+    // 1. Check the end of the file
+    if (fseek(checkpoint_file, -(long) (6 * sizeof(unsigned long)), SEEK_END) != 0 ||
+        fread(trailer, sizeof(unsigned long), 6, checkpoint_file) != 6) ExitError("when reading the end of the checkpoint file", 1);
+    if (trailer[5] != CHECKPOINT_MAGIC || trailer[2] != npaths) ExitError("the checkpoint file does not match the graph", 2);
+    if (trailer[1] != (unsigned long) engine) printf("The checkpoint was stored with the engine %lu\n", trailer[1]);
+
+    // 2. Read the progress
+    checkpoint->crossings = (Crossing *) malloc((trailer[4] ? trailer[4] : 1) * sizeof(Crossing));
+    if (checkpoint->crossings == NULL) ExitError("when allocating memory for the checkpoint crossings", 3);
+    if (fseek(checkpoint_file, -(long) ((npaths + 6) * sizeof(unsigned long) + sizeof(Intersections_counter) +
+                                        trailer[4] * sizeof(Crossing)), SEEK_END) != 0 ||
+        fread(int_per_path, sizeof(unsigned long), npaths, checkpoint_file) != npaths ||
+        fread(counter, sizeof(Intersections_counter), 1, checkpoint_file) != 1 ||
+        fread(checkpoint->crossings, sizeof(Crossing), trailer[4], checkpoint_file) != trailer[4])
+        ExitError("when reading the checkpoint file", 4);
+    fclose(checkpoint_file);
+    checkpoint->first_path = trailer[0];
+    checkpoint->nnodes = trailer[3];
+    checkpoint->ncrossings = trailer[4];
+    return 1;
+}
+
+
+/*
+    ARENAS
+*/
+
+void *arena_alloc(Arena *arena, size_t size) {
+    Arena_block *block;
+    size_t block_size;
+    void *ptr;
+
+    size = (size + 7) & ~((size_t) 7);
+    if (arena->head == NULL || arena->head->used + size > arena->head->size) {
+        block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = (Arena_block *) malloc(sizeof(Arena_block) + block_size);
+        if (block == NULL) ExitError("when allocating memory for a block of the arena", 1);
+        block->next = arena->head;
+        block->used = 0;
+        block->size = block_size;
+        arena->head = block;
+    }
+    ptr = (char *) (arena->head + 1) + arena->head->used;
+    arena->head->used += size;
+    return ptr;
+}
+
+void free_arena(Arena *arena) {
+    Arena_block *block;
+    while (arena->head != NULL) {
+        block = arena->head;
+        arena->head = block->next;
+        free(block);
+    }
+}
+
+void init_intersections_arena(Intersections_arena *arena, unsigned long nnodes) {
+    arena->edges.head = NULL;
+    arena->path_nodes.head = NULL;
+    arena->first_node = nnodes;
+}
+
+void release_intersections(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, Intersections_arena *arena) {
+    unsigned long index;
+    Path_node *curr_node;
+
+    // 1. Unlink the path nodes of the new nodes, which are the only ones that point to them
+    for (index = 0; index < npaths; index++) {
+        for (curr_node = &paths[index].start_node; curr_node->next != NULL; ) {
+            if (curr_node->next->node_id >= arena->first_node) curr_node->next = curr_node->next->next;
+            else curr_node = curr_node->next;
+        }
+    }
+
+    // 2. Detach the edges of the new nodes
+    for (index = arena->first_node; index < nnodes; index++) {
+        nodes[index].nedges = 0;
+        nodes[index].to_nodes = NULL;
+        nodes[index].to_times = NULL;
+    }
+
+    // 3. Free the arenas
+    free_arena(&arena->edges);
+    free_arena(&arena->path_nodes);
+}
+
+
+/*
+    TELEMETRY
+*/
+
+size_t arena_size(Arena *arena) {
+    Arena_block *block;
+    size_t size = 0;
+    for (block = arena->head; block != NULL; block = block->next) size += sizeof(Arena_block) + block->size;
+    return size;
+}
+
+void init_telemetry(Intersections_telemetry *telemetry, Path *paths, unsigned long npaths, int nthreads, Intersections_arena *arena) {
+    // 1. Clear the counters of every thread
+    telemetry->nthreads = nthreads;
+    telemetry->threads = (Thread_telemetry *) aligned_alloc(TELEMETRY_LINE_SIZE, nthreads * sizeof(Thread_telemetry));
+    telemetry->path_work = (unsigned long *) malloc((npaths ? npaths : 1) * sizeof(unsigned long));
+    if (telemetry->threads == NULL) ExitError("when allocating memory for the counters of the threads", 1);
+    if (telemetry->path_work == NULL) ExitError("when allocating memory for the work of the paths", 2);
+    memset(telemetry->threads, 0, nthreads * sizeof(Thread_telemetry));
+    telemetry->arena = arena;
+
+    // 2. The work of every path 1 is its number of edges times the ones of the paths after its watermark
+    unsigned long i_path, initial_path_2, *following;
+    following = (unsigned long *) malloc((npaths + 1) * sizeof(unsigned long));
+    if (following == NULL) ExitError("when allocating memory for the edges of the following paths", 3);
+    following[npaths] = 0;
+    for (i_path = npaths; i_path > 0; i_path--) following[i_path - 1] = following[i_path] + paths[i_path - 1].len - 1;
+
+    telemetry->total_work = 0;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        if (paths[i_path].npaths) initial_path_2 = paths[i_path].npaths + 1;
+        else initial_path_2 = i_path + 1;
+        telemetry->path_work[i_path] = initial_path_2 < npaths ? (paths[i_path].len - 1) * following[initial_path_2] : 0;
+        telemetry->total_work += telemetry->path_work[i_path];
+    }
+    free(following);
+
+    clock_gettime(CLOCK_MONOTONIC, &telemetry->start_time);
+    telemetry->last_time = telemetry->start_time;
+}
+
+void finish_path_telemetry(Intersections_telemetry *telemetry, int thread, unsigned long i_path_1) {
+    telemetry->threads[thread].work_done += telemetry->path_work[i_path_1];
+}
+
+void sum_telemetry(Intersections_telemetry *telemetry, Thread_telemetry *total) {
+    int i_thread;
+    memset(total, 0, sizeof(Thread_telemetry));
+    for (i_thread = 0; i_thread < telemetry->nthreads; i_thread++) {
+        total->pairs_examined += telemetry->threads[i_thread].pairs_examined;
+        total->pairs_pruned += telemetry->threads[i_thread].pairs_pruned;
+        total->segment_tests += telemetry->threads[i_thread].segment_tests;
+        total->crossings += telemetry->threads[i_thread].crossings;
+        total->bytes_allocated += telemetry->threads[i_thread].bytes_allocated;
+        total->work_done += telemetry->threads[i_thread].work_done;
+    }
+    total->bytes_allocated += arena_size(&telemetry->arena->edges) + arena_size(&telemetry->arena->path_nodes);
+}
+
+double elapsed_telemetry(Intersections_telemetry *telemetry, struct timespec *now) {
+    return (double) (now->tv_sec - telemetry->start_time.tv_sec) + 1e-9 * (double) (now->tv_nsec - telemetry->start_time.tv_nsec);
+}
+
+void report_telemetry(Intersections_telemetry *telemetry) {
+    Thread_telemetry total;
+    struct timespec now;
+    double elapsed_time, done;
+
+    sum_telemetry(telemetry, &total);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed_time = elapsed_telemetry(telemetry, &now);
+    done = telemetry->total_work ? (double) total.work_done / (double) telemetry->total_work : 1.;
+
+    printf("\r%.0f s: %.1f %% done", elapsed_time, 100. * done);
+    if (done > 0 && done < 1) printf(", %.0f s left", elapsed_time * (1 - done) / done);
+    printf(" | pairs of paths: %lu examined, %lu pruned | edges tested: %lu (%.3g per s) | intersections: %lu | memory: %.1f MB   ",
+            total.pairs_examined, total.pairs_pruned, total.segment_tests,
+            elapsed_time > 0 ? (double) total.segment_tests / elapsed_time : 0., total.crossings,
+            (double) total.bytes_allocated / (1024. * 1024.));
+    fflush(stdout);
+}
+
+void tick_telemetry(Intersections_telemetry *telemetry) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((double) (now.tv_sec - telemetry->last_time.tv_sec) + 1e-9 * (double) (now.tv_nsec - telemetry->last_time.tv_nsec) <
+        telemetry->interval) return;
+    telemetry->last_time = now;
+    report_telemetry(telemetry);
+}
+
+void store_telemetry(Intersections_telemetry *telemetry, int engine, Intersections_counter *counter) {
+    FILE *telemetry_file;
+    Thread_telemetry total;
+    struct timespec now;
+    int i_thread;
+
+    telemetry_file = fopen(telemetry->filename, "w");
+    if (telemetry_file == NULL) ExitError("when opening the telemetry file", 1);
+    sum_telemetry(telemetry, &total);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    fprintf(telemetry_file, "thread,engine,elapsed_time,pairs_examined,pairs_pruned,segment_tests,crossings,bytes_allocated,work_done,total_work,"
+            "computed,touching,ignored\n");
+    for (i_thread = 0; i_thread < telemetry->nthreads; i_thread++)
+        fprintf(telemetry_file, "%d,%d,%g,%lu,%lu,%lu,%lu,%lu,%lu,%lu,,,\n", i_thread, engine, elapsed_telemetry(telemetry, &now),
+                telemetry->threads[i_thread].pairs_examined, telemetry->threads[i_thread].pairs_pruned,
+                telemetry->threads[i_thread].segment_tests, telemetry->threads[i_thread].crossings,
+                telemetry->threads[i_thread].bytes_allocated, telemetry->threads[i_thread].work_done, telemetry->total_work);
+    fprintf(telemetry_file, "total,%d,%g,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", engine, elapsed_telemetry(telemetry, &now),
+            total.pairs_examined, total.pairs_pruned, total.segment_tests, total.crossings, total.bytes_allocated,
+            total.work_done, telemetry->total_work, counter->computed, counter->touching, counter->ignored);
+    fclose(telemetry_file);
+}
+
+void free_telemetry(Intersections_telemetry *telemetry) {
+    free(telemetry->threads);
+    free(telemetry->path_work);
+    telemetry->threads = NULL;
+    telemetry->path_work = NULL;
+}
+
+
+/*
+    SPATIAL GRID
+*/
+
+void segment_box(Segment_grid *grid, Node *nodes, unsigned long path, unsigned long seg, double *box) {
+    Node *p, *q;
+    p = &nodes[grid->seg_starts[path][seg]->node_id];
+    q = &nodes[grid->seg_starts[path][seg + 1]->node_id];
+    box[0] = (p->lon < q->lon ? p->lon : q->lon) - GRID_EPSILON;
+    box[1] = (p->lon > q->lon ? p->lon : q->lon) + GRID_EPSILON;
+    box[2] = (p->lat < q->lat ? p->lat : q->lat) - GRID_EPSILON;
+    box[3] = (p->lat > q->lat ? p->lat : q->lat) + GRID_EPSILON;
+}
+
+unsigned long grid_bucket(long cell_lon, long cell_lat, unsigned long nbuckets) {
+    unsigned long hash;
+    hash = (unsigned long) cell_lon * 0x9E3779B97F4A7C15UL ^ (unsigned long) cell_lat * 0xC2B2AE3D27D4EB4FUL;
+    return (hash ^ (hash >> 29)) & (nbuckets - 1);
+}
+
+void create_segment_starts(Segment_grid *grid, Path *paths, unsigned long npaths, unsigned long nnodes, unsigned char *pending) {
+    unsigned long i_path, seg;
+    Path_node *path_node;
+
+    grid->seg_starts = (Path_node ***) malloc(npaths * sizeof(Path_node **));
+    grid->nsegs = (unsigned long *) malloc(npaths * sizeof(unsigned long));
+    if (grid->seg_starts == NULL || grid->nsegs == NULL) ExitError("when allocating memory for the grid paths", 1);
+
+    for (i_path = 0; i_path < npaths; i_path++) {
+        if (pending != NULL && pending[i_path] == 0) {
+            grid->nsegs[i_path] = 0;
+            grid->seg_starts[i_path] = NULL;
+            continue;
+        }
+        grid->seg_starts[i_path] = (Path_node **) malloc(paths[i_path].len * sizeof(Path_node *));
+        if (grid->seg_starts[i_path] == NULL) ExitError("when allocating memory for the grid edges", 2);
+        seg = 0;
+        for (path_node = &paths[i_path].start_node; path_node != NULL; path_node = path_node->next) {
+            // The nodes added by the computation split an original edge, so they never start one
+            if (path_node->node_id >= nnodes) continue;
+            if (seg == paths[i_path].len) ExitError("when storing the edges of a path longer than its length", 3);
+            grid->seg_starts[i_path][seg++] = path_node;
+        }
+        grid->nsegs[i_path] = seg - 1;
+    }
+}
+
+void create_segment_grid(Segment_grid *grid, Node *nodes, Path *paths, unsigned long npaths, unsigned long nnodes,
+                        unsigned char *pending, double cell_size) {
+    // 1. Store the path nodes where every original edge starts. Only the edges of the paths pending as path 2 go to the cells.
+    unsigned long i_path, seg, nsegs_total, *ncell_segs;
+
+    create_segment_starts(grid, paths, npaths, nnodes, pending);
+    ncell_segs = (unsigned long *) malloc((npaths ? npaths : 1) * sizeof(unsigned long));
+    if (ncell_segs == NULL) ExitError("when allocating memory for the edges of the grid cells", 7);
+    nsegs_total = 0;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        ncell_segs[i_path] = pending == NULL || pending[i_path] & PENDING_PATH_2 ? grid->nsegs[i_path] : 0;
+        nsegs_total += ncell_segs[i_path];
+    }
+
+    // 2. Choose the cell size as the mean size of the edges
+    double box[4], sum_size;
+    if (cell_size <= 0) {
+        sum_size = 0.;
+        for (i_path = 0; i_path < npaths; i_path++) for (seg = 0; seg < ncell_segs[i_path]; seg++) {
+            segment_box(grid, nodes, i_path, seg, box);
+            sum_size += box[1] - box[0] > box[3] - box[2] ? box[1] - box[0] : box[3] - box[2];
+        }
+        cell_size = nsegs_total ? sum_size / (double) nsegs_total : 1.;
+    }
+    grid->cell_size = cell_size;
+
+    // 3. Count the entries of every bucket
+    unsigned long nentries, bucket;
+    long min_cell_lon, max_cell_lon, min_cell_lat, max_cell_lat, cell_lon, cell_lat;
+
+    nentries = 0;
+    grid->nlong = 0;
+    for (i_path = 0; i_path < npaths; i_path++) for (seg = 0; seg < ncell_segs[i_path]; seg++) {
+        segment_box(grid, nodes, i_path, seg, box);
+        min_cell_lon = (long) floor(box[0] / cell_size);
+        max_cell_lon = (long) floor(box[1] / cell_size);
+        min_cell_lat = (long) floor(box[2] / cell_size);
+        max_cell_lat = (long) floor(box[3] / cell_size);
+        if ((max_cell_lon - min_cell_lon + 1) * (max_cell_lat - min_cell_lat + 1) > GRID_MAX_CELLS) grid->nlong++;
+        else nentries += (max_cell_lon - min_cell_lon + 1) * (max_cell_lat - min_cell_lat + 1);
+    }
+
+    grid->nbuckets = 16;
+    while (grid->nbuckets < nentries) grid->nbuckets = grid->nbuckets * 2;
+    grid->first = (unsigned long *) calloc(grid->nbuckets + 1, sizeof(unsigned long));
+    grid->entries = (Grid_entry *) malloc((nentries ? nentries : 1) * sizeof(Grid_entry));
+    grid->long_entries = (Grid_entry *) malloc((grid->nlong ? grid->nlong : 1) * sizeof(Grid_entry));
+    if (grid->first == NULL) ExitError("when allocating memory for the grid buckets", 4);
+    if (grid->entries == NULL || grid->long_entries == NULL) ExitError("when allocating memory for the grid entries", 5);
+
+    for (i_path = 0; i_path < npaths; i_path++) for (seg = 0; seg < ncell_segs[i_path]; seg++) {
+        segment_box(grid, nodes, i_path, seg, box);
+        min_cell_lon = (long) floor(box[0] / cell_size);
+        max_cell_lon = (long) floor(box[1] / cell_size);
+        min_cell_lat = (long) floor(box[2] / cell_size);
+        max_cell_lat = (long) floor(box[3] / cell_size);
+        if ((max_cell_lon - min_cell_lon + 1) * (max_cell_lat - min_cell_lat + 1) > GRID_MAX_CELLS) continue;
+        for (cell_lon = min_cell_lon; cell_lon <= max_cell_lon; cell_lon++)
+            for (cell_lat = min_cell_lat; cell_lat <= max_cell_lat; cell_lat++)
+                grid->first[grid_bucket(cell_lon, cell_lat, grid->nbuckets) + 1]++;
+    }
+    for (bucket = 0; bucket < grid->nbuckets; bucket++) grid->first[bucket + 1] += grid->first[bucket];
+
+    // 4. Fill the buckets. The entries of every bucket are sorted by path and edge.
+    unsigned long *filled;
+    filled = (unsigned long *) calloc(grid->nbuckets, sizeof(unsigned long));
+    if (filled == NULL) ExitError("when allocating memory for the grid counters", 6);
+
+    grid->nlong = 0;
+    for (i_path = 0; i_path < npaths; i_path++) for (seg = 0; seg < ncell_segs[i_path]; seg++) {
+        segment_box(grid, nodes, i_path, seg, box);
+        min_cell_lon = (long) floor(box[0] / cell_size);
+        max_cell_lon = (long) floor(box[1] / cell_size);
+        min_cell_lat = (long) floor(box[2] / cell_size);
+        max_cell_lat = (long) floor(box[3] / cell_size);
+        if ((max_cell_lon - min_cell_lon + 1) * (max_cell_lat - min_cell_lat + 1) > GRID_MAX_CELLS) {
+            grid->long_entries[grid->nlong].path = i_path;
+            grid->long_entries[grid->nlong].seg = seg;
+            grid->nlong++;
+            continue;
+        }
+        for (cell_lon = min_cell_lon; cell_lon <= max_cell_lon; cell_lon++)
+            for (cell_lat = min_cell_lat; cell_lat <= max_cell_lat; cell_lat++) {
+                bucket = grid_bucket(cell_lon, cell_lat, grid->nbuckets);
+                grid->entries[grid->first[bucket] + filled[bucket]].path = i_path;
+                grid->entries[grid->first[bucket] + filled[bucket]].seg = seg;
+                filled[bucket]++;
+            }
+    }
+    free(filled);
+    free(ncell_segs);
+}
+
+void push_candidate(Grid_candidate **candidates_ptr, unsigned long *ncandidates, unsigned long *max_candidates,
+                    unsigned long path_2, unsigned long seg_1, unsigned long seg_2) {
+    if (*ncandidates == *max_candidates) {
+        *max_candidates = *max_candidates ? 2 * *max_candidates : 1024;
+        *candidates_ptr = (Grid_candidate *) realloc(*candidates_ptr, *max_candidates * sizeof(Grid_candidate));
+        if (*candidates_ptr == NULL) ExitError("when reallocating memory for the grid candidates", 1);
+    }
+    (*candidates_ptr)[*ncandidates].path_2 = path_2;
+    (*candidates_ptr)[*ncandidates].seg_1 = seg_1;
+    (*candidates_ptr)[*ncandidates].seg_2 = seg_2;
+    (*ncandidates)++;
+}
+
+unsigned long grid_candidates(Segment_grid *grid, Node *nodes, Path *paths, unsigned long npaths,
+                            unsigned long i_path_1, unsigned long initial_path_2,
+                            Grid_candidate **candidates_ptr, unsigned long *max_candidates) {
+    unsigned long ncandidates, seg_1, i_path_2, seg_2, index, bucket;
+    long min_cell_lon, max_cell_lon, min_cell_lat, max_cell_lat, cell_lon, cell_lat;
+    double box_1[4], box_2[4];
+    Grid_entry *entry;
+    int shiptype;
+
+    ncandidates = 0;
+    shiptype = paths[i_path_1].shiptype;
+    for (seg_1 = 0; seg_1 < grid->nsegs[i_path_1]; seg_1++) {
+        segment_box(grid, nodes, i_path_1, seg_1, box_1);
+        min_cell_lon = (long) floor(box_1[0] / grid->cell_size);
+        max_cell_lon = (long) floor(box_1[1] / grid->cell_size);
+        min_cell_lat = (long) floor(box_1[2] / grid->cell_size);
+        max_cell_lat = (long) floor(box_1[3] / grid->cell_size);
+
+        // 1. Long edges are compared with all the edges of the overlapping paths
+        if ((max_cell_lon - min_cell_lon + 1) * (max_cell_lat - min_cell_lat + 1) > GRID_MAX_CELLS) {
+            for (i_path_2 = initial_path_2; i_path_2 < npaths; i_path_2++) {
+                if (paths[i_path_2].shiptype != shiptype) continue;
+                if (paths[i_path_2].min_lon > box_1[1] || paths[i_path_2].max_lon < box_1[0] ||
+                    paths[i_path_2].min_lat > box_1[3] || paths[i_path_2].max_lat < box_1[2]) continue;
+                for (seg_2 = 0; seg_2 < grid->nsegs[i_path_2]; seg_2++) {
+                    segment_box(grid, nodes, i_path_2, seg_2, box_2);
+                    if (box_1[0] > box_2[1] || box_1[1] < box_2[0] || box_1[2] > box_2[3] || box_1[3] < box_2[2]) continue;
+                    push_candidate(candidates_ptr, &ncandidates, max_candidates, i_path_2, seg_1, seg_2);
+                }
+            }
+            continue;
+        }
+
+        // 2. The rest are compared with the long edges and the edges in the cells they cover
+        for (index = 0; index < grid->nlong; index++) {
+            entry = &grid->long_entries[index];
+            if (entry->path < initial_path_2 || paths[entry->path].shiptype != shiptype) continue;
+            segment_box(grid, nodes, entry->path, entry->seg, box_2);
+            if (box_1[0] > box_2[1] || box_1[1] < box_2[0] || box_1[2] > box_2[3] || box_1[3] < box_2[2]) continue;
+            push_candidate(candidates_ptr, &ncandidates, max_candidates, entry->path, seg_1, entry->seg);
+        }
+        for (cell_lon = min_cell_lon; cell_lon <= max_cell_lon; cell_lon++)
+            for (cell_lat = min_cell_lat; cell_lat <= max_cell_lat; cell_lat++) {
+                bucket = grid_bucket(cell_lon, cell_lat, grid->nbuckets);
+                for (index = grid->first[bucket]; index < grid->first[bucket + 1]; index++) {
+                    entry = &grid->entries[index];
+                    if (entry->path < initial_path_2 || paths[entry->path].shiptype != shiptype) continue;
+                    segment_box(grid, nodes, entry->path, entry->seg, box_2);
+                    if (box_1[0] > box_2[1] || box_1[1] < box_2[0] || box_1[2] > box_2[3] || box_1[3] < box_2[2]) continue;
+                    push_candidate(candidates_ptr, &ncandidates, max_candidates, entry->path, seg_1, entry->seg);
+                }
+            }
+    }
+
+    // 3. Sort the candidates and remove the repeated ones
+    unsigned long nunique;
+    if (ncandidates == 0) return 0;
+    qsort(*candidates_ptr, ncandidates, sizeof(Grid_candidate), compare_candidates);
+    nunique = 1;
+    for (index = 1; index < ncandidates; index++) {
+        if (compare_candidates(&(*candidates_ptr)[index], &(*candidates_ptr)[nunique - 1]) != 0)
+            (*candidates_ptr)[nunique++] = (*candidates_ptr)[index];
+    }
+    return nunique;
+}
+
+unsigned long pair_crossings(Node *nodes, Segment_grid *grid, unsigned long i_path_1, unsigned long i_path_2,
+                            Grid_candidate *candidates, unsigned long ncandidates,
+                            Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings) {
+    unsigned long index, computed;
+    unsigned short intersection_type;
+    double t, u;
+
+    computed = 0;
+    for (index = 0; index < ncandidates; index++) {
+        intersection_type = identify_intersection(&nodes[grid->seg_starts[i_path_1][candidates[index].seg_1]->node_id],
+                                                &nodes[grid->seg_starts[i_path_1][candidates[index].seg_1 + 1]->node_id],
+                                                &nodes[grid->seg_starts[i_path_2][candidates[index].seg_2]->node_id],
+                                                &nodes[grid->seg_starts[i_path_2][candidates[index].seg_2 + 1]->node_id], &t, &u);
+        if (intersection_type == 0) continue;
+        if (intersection_type == 1) computed++;
+        push_crossing(crossings_ptr, ncrossings, max_crossings, i_path_1, candidates[index].seg_1, i_path_2, candidates[index].seg_2,
+                    intersection_type);
+    }
+    return computed;
+}
+
+void detect_path_crossings(Node *nodes, Path *paths, unsigned long npaths, Segment_grid *grid, unsigned long i_path_1,
+                            Crossing_slot *slot, Grid_candidate **candidates_ptr, unsigned long *max_candidates) {
+    unsigned long initial_path_2, ncandidates, index;
+    Grid_candidate *candidate;
+    unsigned short intersection_type;
+    double t, u;
+
+    slot->crossings = NULL;
+    slot->ncrossings = 0;
+    slot->max_crossings = 0;
+    slot->ntested = 0;
+    if (paths[i_path_1].npaths) initial_path_2 = paths[i_path_1].npaths + 1;
+    else initial_path_2 = i_path_1 + 1;
+    if (initial_path_2 >= npaths) return;
+
+    // The candidates are sorted by path_2, seg_1 and seg_2, and so the crossings
+    ncandidates = grid_candidates(grid, nodes, paths, npaths, i_path_1, initial_path_2, candidates_ptr, max_candidates);
+    slot->ntested = ncandidates;
+    for (index = 0; index < ncandidates; index++) {
+        candidate = &(*candidates_ptr)[index];
+        intersection_type = identify_intersection(&nodes[grid->seg_starts[i_path_1][candidate->seg_1]->node_id],
+                                                &nodes[grid->seg_starts[i_path_1][candidate->seg_1 + 1]->node_id],
+                                                &nodes[grid->seg_starts[candidate->path_2][candidate->seg_2]->node_id],
+                                                &nodes[grid->seg_starts[candidate->path_2][candidate->seg_2 + 1]->node_id], &t, &u);
+        if (intersection_type == 0) continue;
+        push_crossing(&slot->crossings, &slot->ncrossings, &slot->max_crossings, i_path_1, candidate->seg_1, candidate->path_2,
+                    candidate->seg_2, intersection_type);
     }
 }
+
+void *detection_thread(void *arg) {
+    Detection_work *work = (Detection_work *) arg;
+    Grid_candidate *candidates;
+    Thread_telemetry *counters;
+    unsigned long max_candidates, initial_max_candidates, i_path_1;
+    int thread;
+
+    candidates = NULL;
+    max_candidates = 0;
+    pthread_mutex_lock(&work->lock);
+    thread = work->next_thread++;
+    pthread_mutex_unlock(&work->lock);
+    counters = work->telemetry != NULL ? &work->telemetry->threads[thread] : NULL;
+    while (1) {
+        // The progress is reported by the thread that takes the next path, so only one at a time
+        pthread_mutex_lock(&work->lock);
+        i_path_1 = work->next_path++;
+        if (work->telemetry != NULL) tick_telemetry(work->telemetry);
+        pthread_mutex_unlock(&work->lock);
+        if (i_path_1 >= work->npaths) break;
+        initial_max_candidates = max_candidates;
+        detect_path_crossings(work->nodes, work->paths, work->npaths, work->grid, i_path_1,
+                            &work->slots[i_path_1], &candidates, &max_candidates);
+        if (counters != NULL) {
+            counters->segment_tests += work->slots[i_path_1].ntested;
+            counters->crossings += work->slots[i_path_1].ncrossings;
+            counters->bytes_allocated += (max_candidates - initial_max_candidates) * sizeof(Grid_candidate) +
+                                        work->slots[i_path_1].max_crossings * sizeof(Crossing);
+            finish_path_telemetry(work->telemetry, thread, i_path_1);
+        }
+    }
+    free(candidates);
+    return NULL;
+}
+
+unsigned long detect_crossings_parallel(Node *nodes, Path *paths, unsigned long npaths, Segment_grid *grid, int nthreads,
+                                        Crossing **crossings_ptr, Intersections_telemetry *telemetry) {
+    // 1. Share the work between the threads
+    Detection_work work;
+    pthread_t *threads;
+    int i_thread;
+
+    work.nodes = nodes;
+    work.paths = paths;
+    work.npaths = npaths;
+    work.grid = grid;
+    work.next_path = 0;
+    work.next_thread = 0;
+    work.telemetry = telemetry;
+    work.slots = (Crossing_slot *) malloc((npaths ? npaths : 1) * sizeof(Crossing_slot));
+    threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    if (work.slots == NULL) ExitError("when allocating memory for the crossings slots", 1);
+    if (threads == NULL) ExitError("when allocating memory for the threads", 2);
+    if (pthread_mutex_init(&work.lock, NULL) != 0) ExitError("when initializing the detection lock", 3);
+
+    for (i_thread = 0; i_thread < nthreads; i_thread++)
+        if (pthread_create(&threads[i_thread], NULL, detection_thread, &work) != 0) ExitError("when creating a detection thread", 4);
+    for (i_thread = 0; i_thread < nthreads; i_thread++) pthread_join(threads[i_thread], NULL);
+    pthread_mutex_destroy(&work.lock);
+
+    // 2. Merge the slots in order of path 1
+    unsigned long i_path, ncrossings, index;
+    ncrossings = 0;
+    for (i_path = 0; i_path < npaths; i_path++) ncrossings += work.slots[i_path].ncrossings;
+    *crossings_ptr = (Crossing *) malloc((ncrossings ? ncrossings : 1) * sizeof(Crossing));
+    if (*crossings_ptr == NULL) ExitError("when allocating memory for the crossings", 5);
+
+    index = 0;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        if (work.slots[i_path].ncrossings)
+            memcpy(&(*crossings_ptr)[index], work.slots[i_path].crossings, work.slots[i_path].ncrossings * sizeof(Crossing));
+        index += work.slots[i_path].ncrossings;
+        free(work.slots[i_path].crossings);
+    }
+    free(work.slots);
+    free(threads);
+    return ncrossings;
+}
+
+int compare_candidates(const void *a, const void *b) {
+    const Grid_candidate *candidate_a = (const Grid_candidate *) a;
+    const Grid_candidate *candidate_b = (const Grid_candidate *) b;
+    if (candidate_a->path_2 != candidate_b->path_2) return candidate_a->path_2 < candidate_b->path_2 ? -1 : 1;
+    if (candidate_a->seg_1 != candidate_b->seg_1) return candidate_a->seg_1 < candidate_b->seg_1 ? -1 : 1;
+    if (candidate_a->seg_2 != candidate_b->seg_2) return candidate_a->seg_2 < candidate_b->seg_2 ? -1 : 1;
+    return 0;
+}
+
+void free_segment_grid(Segment_grid *grid, unsigned long npaths) {
+    unsigned long i_path;
+    for (i_path = 0; i_path < npaths; i_path++) free(grid->seg_starts[i_path]);
+    free(grid->seg_starts);
+    free(grid->nsegs);
+    free(grid->first);
+    free(grid->entries);
+    free(grid->long_entries);
+}
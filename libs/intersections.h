@@ -1,6 +1,194 @@
 #ifndef INTERSECTIONS_H
 #define INTERSECTIONS_H
 
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+    ENUMERATIONS
+*/
+// This enumeration the codes of the engines used to find the pairs of edges that intersect
+enum Intersections_engine {Nested_loop, Uniform_grid, Sweep_line, Parallel_grid, Vector_loop};
+
+/*
+    STRUCTURES TO STORE THE RESULTS
+*/
+// Stores the counters of the intersections computation. touching counts the pairs of edges that touch or overlap, resolved by the splice.
+typedef struct {
+    unsigned long computed;
+    unsigned long ignored;
+    unsigned long touching;
+    unsigned long pairs_checked;
+    unsigned long pairs_computed;
+} Intersections_counter;
+
+/*
+    STRUCTURES TO MANAGE THE ARENAS
+*/
+// Stores a block of memory of an arena, followed by its size bytes. The blocks are linked to be freed at once.
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t used, size;
+} Arena_block;
+
+// Stores a bump allocator: the memory is taken consecutively from the current block and only freed with the whole arena
+typedef struct {
+    Arena_block *head;
+} Arena;
+
+/*
+ * Stores the memory of the nodes added by the intersections: the arrays of edges of the new nodes, which have always
+ * two edges, and the path nodes that insert them in the paths. The new nodes are the ones from first_node onwards.
+*/
+typedef struct {
+    Arena edges;
+    Arena path_nodes;
+    unsigned long first_node;
+} Intersections_arena;
+
+/*
+    STRUCTURES TO MANAGE THE TELEMETRY
+*/
+// Size in bytes of a cache line. The counters of every thread fill whole lines, so two threads never write to the same one.
+#define TELEMETRY_LINE_SIZE 64
+
+/*
+ * Stores the counters of a thread, which only updates its own ones: the pairs of paths examined and pruned, the pairs of
+ * edges tested, the intersecting pairs of edges found, the bytes of the buffers it allocates and the work it has done.
+*/
+typedef struct {
+    unsigned long pairs_examined, pairs_pruned;
+    unsigned long segment_tests;
+    unsigned long crossings;
+    unsigned long bytes_allocated;
+    unsigned long work_done;
+    char padding[TELEMETRY_LINE_SIZE - 6 * sizeof(unsigned long)];
+} Thread_telemetry;
+
+/*
+ * Stores the telemetry of the intersections computation. The progress is reported every interval seconds, and the summary
+ * is stored in filename at the end, unless it is NULL. The rest is set by compute_intersections: the counters of every thread,
+ * the work of every path 1, which is the number of its original edges times the ones of the following paths to compute,
+ * the total work, to estimate the time left, and the arena, whose blocks are added to the bytes allocated.
+*/
+typedef struct {
+    char *filename;
+    double interval;
+    Thread_telemetry *threads;
+    int nthreads;
+    unsigned long *path_work;
+    unsigned long total_work;
+    Intersections_arena *arena;
+    struct timespec start_time, last_time;
+} Intersections_telemetry;
+
+/*
+    STRUCTURES TO MANAGE THE SPATIAL GRID
+*/
+// Stores the reference to an edge of the original graph: the path and the position of the edge in it
+typedef struct {
+    unsigned long path;
+    unsigned long seg;
+} Grid_entry;
+
+// Stores a pair of edges that share a cell of the grid. seg_1 belongs to the path being computed and seg_2 to path_2.
+typedef struct {
+    unsigned long path_2;
+    unsigned long seg_1;
+    unsigned long seg_2;
+} Grid_candidate;
+
+/*
+ * Stores a uniform grid of cells of cell_size degrees with the edges of the original graph.
+ * Cells are hashed into nbuckets buckets, whose entries are stored consecutively, from first[bucket] to first[bucket + 1].
+ * The edges whose bounding box covers more than GRID_MAX_CELLS cells are stored apart, in long_entries.
+ * seg_starts[path][seg] points to the path node where the original edge seg starts, so the pieces in which
+ * the edge is split by the intersections can be traversed until seg_starts[path][seg + 1].
+*/
+typedef struct {
+    double cell_size;
+    unsigned long nbuckets;
+    unsigned long *first;
+    Grid_entry *entries;
+    unsigned long nlong;
+    Grid_entry *long_entries;
+    Path_node ***seg_starts;
+    unsigned long *nsegs;
+} Segment_grid;
+
+// Stores the intersecting pairs of original edges of a path 1 and the following paths, and the pairs of edges tested
+typedef struct {
+    Crossing *crossings;
+    unsigned long ncrossings, max_crossings;
+    unsigned long ntested;
+} Crossing_slot;
+
+/*
+ * Stores the work shared by the detection threads. Every thread takes the next number of thread, to update its counters
+ * of the telemetry, and then the next path 1 to detect until there are no more.
+*/
+typedef struct {
+    Node *nodes;
+    Path *paths;
+    unsigned long npaths;
+    Segment_grid *grid;
+    Crossing_slot *slots;
+    unsigned long next_path;
+    int next_thread;
+    Intersections_telemetry *telemetry;
+    pthread_mutex_t lock;
+} Detection_work;
+
+// Stores a point where an original edge of a path is split: the parameter along the edge, the new node and which of its edges continues the path
+typedef struct {
+    unsigned long path, seg;
+    double param;
+    unsigned long node_id;
+    unsigned short edge;
+} Edge_split;
+
+// Stores a pair of coincident nodes of different paths, from < to, linked both ways by the splice
+typedef struct {
+    unsigned long from, to;
+} Node_link;
+
+/*
+    STRUCTURES TO MANAGE THE CHECKPOINTS
+*/
+
+/*
+ * Stores the configuration of the checkpoints: the file where they are stored and the seconds between them.
+ * first_path is the path 1 where the computation starts, greater than 0 when it is resumed from a checkpoint,
+ * nnodes the number of nodes of the graph before the computation and crossings the ncrossings pairs of edges
+ * found before first_path, not spliced yet.
+*/
+typedef struct {
+    char *filename;
+    double interval;
+    time_t last_time;
+    unsigned long first_path;
+    unsigned long nnodes;
+    Crossing *crossings;
+    unsigned long ncrossings;
+} Intersections_checkpoint;
+
+// Identifies the end of a checkpoint file
+#define CHECKPOINT_MAGIC 0x4b43505449444441UL
+
+// Minimum size in bytes of the blocks of the arenas
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// Maximum number of cells covered by an edge to be stored in the grid
+#define GRID_MAX_CELLS 64
+
+// Margin in degrees added to the bounding boxes, so the rounding of the new nodes does not move them outside
+#define GRID_EPSILON 1e-9
+
+// Flags of the pending paths: the ones with some pair to compute with a following path, and with a previous one
+#define PENDING_PATH_1 1
+#define PENDING_PATH_2 2
+
 /*
     PATH MANAGAMENT
 */
@@ -8,9 +196,13 @@
 // Check whether it is necessary or not to compute a pair of graphs intersections
 unsigned short need_compute_paths(Path *paths, unsigned long i_path_1, unsigned long i_path_2);
 
-// Add to the connecteds paths of Path 1 all the Paths until last Path 2
+// Mark as checked with Path 1 all the Paths until last Path 2, by moving its watermark npaths
 void checked_paths(Path *paths, unsigned long i_path_1, unsigned long last_i_path_2);
 
+// Returns an array with PENDING_PATH_1 for the paths that have some pair to compute with a following path,
+// PENDING_PATH_2 for the ones with a previous one, both if they have both and 0 otherwise
+unsigned char *pending_paths(Path *paths, unsigned long npaths);
+
 
 /*
     INTERSECTIONS MANAGEMENT
@@ -19,18 +211,220 @@ void checked_paths(Path *paths, unsigned long i_path_1, unsigned long last_i_pat
 /*
  * Return the intersection type between the edges p1-q1 and p2-q2.
  * It also stores the value of t and u where the pointers *t and *u indicate.
+ * Edges that are not parallel only intersect if the point given by t and u is the same on both, within GRID_EPSILON,
+ * so the almost parallel edges whose parameters are only rounding errors are not taken as touching.
 */
 unsigned short identify_intersection(Node *p1, Node *q1, Node *p2, Node *q2, double *t, double *u);
 
+
+/*
+ * Adds an edge from the node to to_id with the given travelling time and returns its position.
+ * The arrays of edges are reallocated, so the node can not be one of the new nodes of the arena.
+*/
+unsigned short append_node_edge(Node *node, unsigned long to_id, double time);
+
+/*
+ * Stores in splits where the edges p1-q1 and p2-q2, which touch or overlap with the intersection type given (2 to 5 and 10 to 17),
+ * are split at an existing node: every endpoint of an edge that lies strictly inside the other one. t and u are the ones
+ * given by identify_intersection. Returns the number of splits stored, at most 2.
+*/
+unsigned long touching_splits(Node *p1, Node *q1, Node *p2, Node *q2, Crossing *crossing, unsigned short intersection_type,
+                            double t, double u, Edge_split *splits);
+
+/*
+ * Adds all the intersections between original edges at once. A node is created for every crossing, numbered in order,
+ * and every crossed edge is split in its pieces sorted along it, so the nodes array is reallocated only once and
+ * an edge crossed many times costs linear time. The travelling time is shared proportionally between the pieces.
+ * The edges that touch at an endpoint or overlap are split at the existing endpoints that lie inside the other edge,
+ * which get a new edge, and the coincident nodes of both edges are linked both ways with edges of no travelling time,
+ * so no node is added for them. They are counted in touching, and the pairs that do not intersect any more in ignored.
+*/
+void splice_crossings(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, Segment_grid *grid,
+                    Crossing *crossings, unsigned long ncrossings, Intersections_counter *counter, Intersections_arena *arena);
+
+// Compares two edge splits by path, edge, parameter and node. Used to sort them with qsort.
+int compare_edge_splits(const void *a, const void *b);
+
+// Compares two node links by their nodes. Used to sort them with qsort.
+int compare_node_links(const void *a, const void *b);
+
+// Appends a pair of intersecting edges to the crossings, growing them if they are full
+void push_crossing(Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings,
+                    unsigned long path_1, unsigned long seg_1, unsigned long path_2, unsigned long seg_2, unsigned short type);
+
+/*
+ * Appends to the crossings the intersecting pairs of original edges of paths 1 and 2, with their type,
+ * comparing every edge of path 1 with every edge of path 2. Returns the number of crossings type 1.
+*/
+unsigned long pair_crossings_all(Node *nodes, Segment_grid *grid, unsigned long i_path_1, unsigned long i_path_2,
+                                Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings);
+
 /*
- * Computes the intersection and creates the corresponding nodes and edges according to the intersection_type.
- * It also sums 1 to the length of both paths 1 and 2.
+ * Computes the intersections of the graph with the selected engine and stores in int_per_path the number of
+ * intersections of every path. Use a cell_size of 0 to choose it automatically for the grid engines.
+ * nthreads is only used by the parallel grid engine. Use 0 to use all the processors.
+ * The memory of the new nodes is taken from the arena, which must be released with release_intersections before freeing the graph.
+ * Every engine finds the crossings of the original edges, touching and overlapping ones included, and splices them at the end.
+ * With a checkpoint, the nested loop and uniform grid engines store their progress periodically and start from its first_path,
+ * keeping the int_per_path, counter and crossings given. Use NULL to compute without checkpoints.
+ * With a telemetry, the progress is reported every interval seconds and the summary stored in its file at the end.
+ * The pairs of paths are counted by the loop over the pairs, and the rest of counters where the pairs of edges are tested.
+ * Use NULL to compute without telemetry.
 */
-void add_intersection(Node **nodes_ptr, unsigned long *nnodes, unsigned long *max_nnodes, unsigned long *nedges,
-                    unsigned long p1_id, unsigned long q1_id, unsigned long p2_id, unsigned long q2_id, 
-                    unsigned short intersection_type, double t, double u,
-                    Path *paths, unsigned long i_path_1, unsigned long i_path_2,
-                    Path_node *p1, Path_node *p2);
+void compute_intersections(Node **nodes_ptr, unsigned long *nnodes, unsigned long *nedges, Path *paths, unsigned long npaths,
+                            int engine, double cell_size, int nthreads, unsigned long *int_per_path, Intersections_counter *counter,
+                            Intersections_arena *arena, Intersections_checkpoint *checkpoint, Intersections_telemetry *telemetry);
+
+
+/*
+    CHECKPOINTS
+*/
+
+/*
+ * Stores the graph, not spliced yet, followed by int_per_path, the counter, the crossings found until next_path, next_path,
+ * the engine, npaths, the nodes of the graph before the computation, ncrossings and CHECKPOINT_MAGIC. The file is written apart and renamed, so a crash never leaves it
+ * half written. It is a valid binary file of the graph, as read_nodes ignores the data after the paths.
+*/
+void store_checkpoint(Intersections_checkpoint *checkpoint, Node *nodes, Path *paths, unsigned long nnodes, unsigned long nedges,
+                    unsigned long npaths, unsigned long next_path, int engine, unsigned long *int_per_path, Intersections_counter *counter,
+                    Crossing *crossings, unsigned long ncrossings);
+
+/*
+ * Reads the progress stored in the checkpoint of a graph with npaths paths: int_per_path, the counter, the crossings,
+ * the nodes of the graph before the computation and first_path. Returns 1 if it is read and 0 if the file does not exist. The graph must be read from the same file with read_nodes.
+*/
+unsigned short read_checkpoint(Intersections_checkpoint *checkpoint, unsigned long npaths, int engine,
+                            unsigned long *int_per_path, Intersections_counter *counter);
+
+
+/*
+    ARENAS
+*/
+
+// Returns size bytes of the arena, aligned to 8 bytes. A new block is allocated when the current one is full.
+void *arena_alloc(Arena *arena, size_t size);
+
+// Frees all the blocks of the arena at once
+void free_arena(Arena *arena);
+
+// Initializes the arena of the intersections of a graph with nnodes nodes
+void init_intersections_arena(Intersections_arena *arena, unsigned long nnodes);
+
+/*
+ * Frees the memory of the new nodes at once. Their edges and path nodes are detached from the graph first,
+ * so free_nodes and free_paths free only the rest. The graph can only be freed afterwards.
+*/
+void release_intersections(Node *nodes, unsigned long nnodes, Path *paths, unsigned long npaths, Intersections_arena *arena);
+
+
+/*
+    TELEMETRY
+*/
+
+// Returns the bytes of the blocks of the arena
+size_t arena_size(Arena *arena);
+
+/*
+ * Prepares the telemetry of the computation of the paths by nthreads threads: clears their counters, computes the work of
+ * every path 1 and starts the clock. The arena of the new nodes is added to the memory allocated.
+*/
+void init_telemetry(Intersections_telemetry *telemetry, Path *paths, unsigned long npaths, int nthreads, Intersections_arena *arena);
+
+// Adds the work of path 1 to the one done by the thread
+void finish_path_telemetry(Intersections_telemetry *telemetry, int thread, unsigned long i_path_1);
+
+// Stores in total the sum of the counters of all the threads and the blocks of the arena
+void sum_telemetry(Intersections_telemetry *telemetry, Thread_telemetry *total);
+
+// Returns the seconds elapsed from the start of the telemetry until now
+double elapsed_telemetry(Intersections_telemetry *telemetry, struct timespec *now);
+
+/*
+ * Prints the progress in a single line: the work done, the time left estimated from the work remaining at the mean rate,
+ * the sum of the counters of all the threads and the rate of the pairs of edges tested.
+ * The counters of the other threads are read while they are updated, so they can be slightly behind.
+*/
+void report_telemetry(Intersections_telemetry *telemetry);
+
+// Reports the progress if interval seconds have passed since the last report. Only one thread can call it at a time.
+void tick_telemetry(Intersections_telemetry *telemetry);
+
+// Stores the counters of every thread and their sum, with the engine, the elapsed time and the counter, in a csv file
+void store_telemetry(Intersections_telemetry *telemetry, int engine, Intersections_counter *counter);
+
+// Frees the counters and the work of the paths
+void free_telemetry(Intersections_telemetry *telemetry);
+
+
+/*
+    SPATIAL GRID
+*/
+
+// Stores in box the bounding box of the original edge seg of the path, enlarged GRID_EPSILON: min_lon, max_lon, min_lat, max_lat
+void segment_box(Segment_grid *grid, Node *nodes, unsigned long path, unsigned long seg, double *box);
+
+// Returns the bucket of the cell in column cell_lon and row cell_lat
+unsigned long grid_bucket(long cell_lon, long cell_lat, unsigned long nbuckets);
+
+// Stores in the grid the path nodes where every original edge starts, without creating the cells.
+// The path nodes of an id of nnodes or more, added by the computation, are skipped. Only the pending paths are stored, unless pending is NULL.
+void create_segment_starts(Segment_grid *grid, Path *paths, unsigned long npaths, unsigned long nnodes, unsigned char *pending);
+
+/*
+ * Creates the grid with all the original edges of the graph, the ones between its first nnodes nodes, of the pending paths,
+ * or of every path if pending is NULL. Only the edges of the paths pending as path 2 are stored in the cells, as the rest are
+ * never a candidate. Use a cell_size of 0 to choose it automatically as the mean size of the edges stored in the cells.
+*/
+void create_segment_grid(Segment_grid *grid, Node *nodes, Path *paths, unsigned long npaths, unsigned long nnodes,
+                        unsigned char *pending, double cell_size);
+
+// Appends a candidate to *candidates_ptr, enlarging it if needed
+void push_candidate(Grid_candidate **candidates_ptr, unsigned long *ncandidates, unsigned long *max_candidates,
+                    unsigned long path_2, unsigned long seg_1, unsigned long seg_2);
+
+/*
+ * Finds all the pairs of edges of path i_path_1 and the paths from initial_path_2 onwards of the same shiptype
+ * whose bounding boxes overlap. They are stored in *candidates_ptr sorted by path_2, seg_1 and seg_2, without repetitions.
+ * Returns the number of candidates.
+*/
+unsigned long grid_candidates(Segment_grid *grid, Node *nodes, Path *paths, unsigned long npaths,
+                            unsigned long i_path_1, unsigned long initial_path_2,
+                            Grid_candidate **candidates_ptr, unsigned long *max_candidates);
+
+/*
+ * Appends to the crossings the intersecting pairs of original edges of paths 1 and 2, with their type, checking only
+ * the candidate pairs of edges. They are checked in the same order as comparing every edge of path 1 with every edge
+ * of path 2, so the crossings are the same. Returns the number of crossings type 1.
+*/
+unsigned long pair_crossings(Node *nodes, Segment_grid *grid, unsigned long i_path_1, unsigned long i_path_2,
+                            Grid_candidate *candidates, unsigned long ncandidates,
+                            Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings);
+
+/*
+ * Stores in the slot the intersecting pairs of original edges of path i_path_1 and the following paths not computed yet,
+ * crossing, touching or overlapping, with their type, sorted by path_2, seg_1 and seg_2.
+ * The graph is only read, so several paths can be detected at the same time.
+*/
+void detect_path_crossings(Node *nodes, Path *paths, unsigned long npaths, Segment_grid *grid, unsigned long i_path_1,
+                            Crossing_slot *slot, Grid_candidate **candidates_ptr, unsigned long *max_candidates);
+
+// Detects the crossings of the paths taken from the shared work. It is the function executed by every thread.
+void *detection_thread(void *arg);
+
+/*
+ * Detects the crossings of all the paths with nthreads threads and merges them by path 1, so the result
+ * does not depend on the number of threads and is the same as the crossings of the uniform grid engine, in the same order.
+ * Returns the number of crossings.
+ * Every thread updates its own counters of the telemetry, which has nthreads of them. Use NULL to detect without telemetry.
+*/
+unsigned long detect_crossings_parallel(Node *nodes, Path *paths, unsigned long npaths, Segment_grid *grid, int nthreads,
+                                        Crossing **crossings_ptr, Intersections_telemetry *telemetry);
+
+// Compares two candidates by path_2, seg_1 and seg_2. Used to sort them with qsort.
+int compare_candidates(const void *a, const void *b);
+
+// Free all the memory allocated related to the grid
+void free_segment_grid(Segment_grid *grid, unsigned long npaths);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,275 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$    LANES.C VERSION 1.0    $$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "lanes.h"
+
+    - Comments:
+        >> The grid has rows of cell_km height. The width of the cells of every row is also cell_km at the latitude of
+            the center of the row, so all the cells have approximately the same area.
+        >> The cells are stored in a hash table with open addressing and linear probing, as only a small fraction of
+            the cells of the globe are occupied.
+        >> The lane node of a cell is placed at the centroid of the nodes snapped to it, and takes their maximum speed,
+            so the heuristics of the A star algorithm keep being optimistic.
+        >> The time of a traversal between two cells is the time from the first node in the origin cell to the first node
+            in the destination cell. An edge that jumps several cells creates a transition between non-adjacent cells.
+
+    - Further development:
+        >> Use a hexagonal grid, so all the neighbour cells are at the same distance.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "graph_management.h"
+#include "lanes.h"
+
+/*
+    GRID MANAGEMENT
+*/
+
+void cell_of(double lat, double lon, double cell_km, long *row, long *col) {
+    double cell_lat, cell_lon, cos_lat;
+    cell_lat = cell_km / (6371 * M_PI / 180); // degrees
+    *row = (long) floor(lat / cell_lat);
+    cos_lat = cos((*row + 0.5) * cell_lat * M_PI / 180);
+    if (cos_lat < 1e-6) cos_lat = 1e-6; // Poles
+    cell_lon = cell_lat / cos_lat;
+    *col = (long) floor(lon / cell_lon);
+    return;
+}
+
+void create_cell_table(Cell_table *table, unsigned long max_cells) {
+    unsigned long index;
+    table->size = 16;
+    while (table->size < 2 * max_cells) table->size = table->size * 2;
+    table->ncells = 0;
+    table->cells = (Lane_cell *) malloc(table->size * sizeof(Lane_cell));
+    if (table->cells == NULL) ExitError("when allocating memory for the cells table", 1);
+    for (index = 0; index < table->size; index++) table->cells[index].lane_id = ULONG_MAX;
+    return;
+}
+
+unsigned long cell_slot(Cell_table *table, long row, long col) {
+    unsigned long hash;
+    hash = (unsigned long) row * 0x9E3779B97F4A7C15UL ^ (unsigned long) col * 0xC2B2AE3D27D4EB4FUL;
+    hash = (hash ^ (hash >> 29)) & (table->size - 1);
+    while (table->cells[hash].lane_id != ULONG_MAX) {
+        if (table->cells[hash].row == row && table->cells[hash].col == col) return hash;
+        hash = (hash + 1) & (table->size - 1);
+    }
+    return hash;
+}
+
+unsigned long cell_lane_id(Cell_table *table, long row, long col) {
+    unsigned long slot;
+    slot = cell_slot(table, row, col);
+    if (table->cells[slot].lane_id != ULONG_MAX) return table->cells[slot].lane_id;
+    if (2 * (table->ncells + 1) > table->size) ExitError("the cells table is full", 1);
+    table->cells[slot].row = row;
+    table->cells[slot].col = col;
+    table->cells[slot].lane_id = table->ncells;
+    table->ncells++;
+    return table->cells[slot].lane_id;
+}
+
+unsigned long find_cell_lane_id(Cell_table *table, long row, long col) {
+    // The empty slots have ULONG_MAX as lane id
+    return table->cells[cell_slot(table, row, col)].lane_id;
+}
+
+void free_cell_table(Cell_table *table) {
+    free(table->cells);
+    table->cells = NULL;
+    table->size = 0;
+    table->ncells = 0;
+    return;
+}
+
+
+/*
+    LANES GRAPH
+*/
+
+void build_lane_graph(Node *nodes, Path *paths, unsigned long nnodes, unsigned long npaths,
+                        double cell_km, int edge_cost,
+                        Node **lane_nodes_ptr, Path **lane_paths_ptr,
+                        unsigned long *lane_nnodes, unsigned long *lane_nedges) {
+    // 1. Initialize auxiliar arrays. There can not be more cells, transitions or visits than nodes.
+    Cell_table table;
+    double *sum_lat, *sum_lon;
+    unsigned long *count;
+    int *max_speed;
+    Lane_transition *transitions;
+    unsigned long *visits, *first_visit;
+
+    create_cell_table(&table, nnodes);
+    sum_lat = (double *) malloc(nnodes * sizeof(double));
+    sum_lon = (double *) malloc(nnodes * sizeof(double));
+    count = (unsigned long *) calloc(nnodes, sizeof(unsigned long));
+    max_speed = (int *) malloc(nnodes * sizeof(int));
+    transitions = (Lane_transition *) malloc(nnodes * sizeof(Lane_transition));
+    visits = (unsigned long *) malloc(nnodes * sizeof(unsigned long));
+    first_visit = (unsigned long *) malloc((npaths + 1) * sizeof(unsigned long));
+    if (sum_lat == NULL || sum_lon == NULL) ExitError("when allocating memory for the cells coordinates", 1);
+    if (count == NULL || max_speed == NULL) ExitError("when allocating memory for the cells counters", 2);
+    if (transitions == NULL) ExitError("when allocating memory for the transitions", 3);
+    if (visits == NULL || first_visit == NULL) ExitError("when allocating memory for the visited cells", 4);
+
+    // 2. Snap the nodes of every path to the grid and store the transitions between cells
+    unsigned long index, nvisits, ntransitions, lane_id, prev_lane_id, prev_node_id;
+    double time_in_cell;
+    long row, col;
+    Path_node *curr_path_node;
+
+    nvisits = 0;
+    ntransitions = 0;
+    for (index = 0; index < npaths; index++) {
+        first_visit[index] = nvisits;
+        prev_lane_id = ULONG_MAX;
+        prev_node_id = 0;
+        time_in_cell = 0.;
+        for (curr_path_node = &paths[index].start_node; curr_path_node != NULL; curr_path_node = curr_path_node->next) {
+            if (curr_path_node != &paths[index].start_node) time_in_cell += edge_time(nodes, prev_node_id, curr_path_node->node_id);
+            prev_node_id = curr_path_node->node_id;
+
+            cell_of(nodes[curr_path_node->node_id].lat, nodes[curr_path_node->node_id].lon, cell_km, &row, &col);
+            lane_id = cell_lane_id(&table, row, col);
+            if (count[lane_id] == 0) {
+                sum_lat[lane_id] = 0.;
+                sum_lon[lane_id] = 0.;
+                max_speed[lane_id] = nodes[curr_path_node->node_id].speed;
+            }
+            sum_lat[lane_id] += nodes[curr_path_node->node_id].lat;
+            sum_lon[lane_id] += nodes[curr_path_node->node_id].lon;
+            count[lane_id]++;
+            if (nodes[curr_path_node->node_id].speed > max_speed[lane_id]) max_speed[lane_id] = nodes[curr_path_node->node_id].speed;
+
+            if (lane_id == prev_lane_id) continue;
+            if (prev_lane_id != ULONG_MAX) {
+                transitions[ntransitions].from = prev_lane_id;
+                transitions[ntransitions].to = lane_id;
+                transitions[ntransitions].time = time_in_cell;
+                ntransitions++;
+            }
+            visits[nvisits++] = lane_id;
+            prev_lane_id = lane_id;
+            time_in_cell = 0.;
+        }
+    }
+    first_visit[npaths] = nvisits;
+
+    // 3. Create the lane nodes
+    Node *lane_nodes;
+    lane_nodes = (Node *) malloc(table.ncells * sizeof(Node));
+    if (lane_nodes == NULL) ExitError("when allocating memory for the lane nodes", 5);
+
+    for (lane_id = 0; lane_id < table.ncells; lane_id++) {
+        lane_nodes[lane_id].id = lane_id;
+        lane_nodes[lane_id].lat = sum_lat[lane_id] / (double) count[lane_id];
+        lane_nodes[lane_id].lon = sum_lon[lane_id] / (double) count[lane_id];
+        lane_nodes[lane_id].speed = max_speed[lane_id];
+        lane_nodes[lane_id].nedges = 0;
+        lane_nodes[lane_id].max_edges = 0;
+        lane_nodes[lane_id].to_nodes = NULL;
+        lane_nodes[lane_id].to_times = NULL;
+    }
+
+    // 4. Aggregate all the traversals of every transition in a single edge
+    unsigned long first, last, middle;
+    qsort(transitions, ntransitions, sizeof(Lane_transition), compare_transitions);
+
+    for (first = 0; first < ntransitions; first = last) {
+        for (last = first + 1; last < ntransitions &&
+                transitions[last].from == transitions[first].from && transitions[last].to == transitions[first].to; last++);
+        lane_nodes[transitions[first].from].max_edges++;
+    }
+    for (lane_id = 0; lane_id < table.ncells; lane_id++) if (lane_nodes[lane_id].max_edges) {
+        lane_nodes[lane_id].to_nodes = (unsigned long *) malloc(lane_nodes[lane_id].max_edges * sizeof(unsigned long));
+        lane_nodes[lane_id].to_times = (double *) malloc(lane_nodes[lane_id].max_edges * sizeof(double));
+        if (lane_nodes[lane_id].to_nodes == NULL) ExitError("when allocating memory for the lane connected nodes", 6);
+        if (lane_nodes[lane_id].to_times == NULL) ExitError("when allocating memory for the lane travelling times", 7);
+    }
+
+    Node *lane_node;
+    *lane_nedges = 0;
+    for (first = 0; first < ntransitions; first = last) {
+        for (last = first + 1; last < ntransitions &&
+                transitions[last].from == transitions[first].from && transitions[last].to == transitions[first].to; last++);
+        lane_node = &lane_nodes[transitions[first].from];
+        lane_node->to_nodes[lane_node->nedges] = transitions[first].to;
+        if (edge_cost == Min) {
+            lane_node->to_times[lane_node->nedges] = transitions[first].time;
+        } else {
+            middle = first + (last - first) / 2;
+            if ((last - first) % 2) lane_node->to_times[lane_node->nedges] = transitions[middle].time;
+            else lane_node->to_times[lane_node->nedges] = (transitions[middle - 1].time + transitions[middle].time) / 2;
+        }
+        lane_node->nedges++;
+        (*lane_nedges)++;
+    }
+
+    // 5. Translate the paths to the sequences of visited cells
+    Path *lane_paths;
+    unsigned long visit;
+    lane_paths = (Path *) malloc(npaths * sizeof(Path));
+    if (lane_paths == NULL) ExitError("when allocating memory for the lane paths", 8);
+
+    for (index = 0; index < npaths; index++) {
+        lane_id = visits[first_visit[index]];
+        lane_paths[index].start_node.node_id = lane_id;
+        lane_paths[index].start_node.next = NULL;
+        lane_paths[index].final_node = &lane_paths[index].start_node;
+        lane_paths[index].shiptype = paths[index].shiptype;
+        lane_paths[index].id = paths[index].id;
+        lane_paths[index].min_lon = lane_nodes[lane_id].lon;
+        lane_paths[index].max_lon = lane_nodes[lane_id].lon;
+        lane_paths[index].min_lat = lane_nodes[lane_id].lat;
+        lane_paths[index].max_lat = lane_nodes[lane_id].lat;
+        lane_paths[index].npaths = 0;
+        lane_paths[index].max_paths = 0;
+        lane_paths[index].to_paths = NULL;
+        lane_paths[index].len = 1;
+        for (visit = first_visit[index] + 1; visit < first_visit[index + 1]; visit++) {
+            update_path_coordinates(&lane_paths[index], &lane_nodes[visits[visit]]);
+            add_path_node(&lane_paths[index], visits[visit]);
+            lane_paths[index].len++;
+        }
+    }
+
+    // 6. Free allocated memory
+    *lane_nnodes = table.ncells;
+    *lane_nodes_ptr = lane_nodes;
+    *lane_paths_ptr = lane_paths;
+
+    free_cell_table(&table);
+    free(sum_lat);
+    free(sum_lon);
+    free(count);
+    free(max_speed);
+    free(transitions);
+    free(visits);
+    free(first_visit);
+    return;
+}
+
+int compare_transitions(const void *a, const void *b) {
+    const Lane_transition *transition_a = (const Lane_transition *) a;
+    const Lane_transition *transition_b = (const Lane_transition *) b;
+    if (transition_a->from != transition_b->from) return transition_a->from < transition_b->from ? -1 : 1;
+    if (transition_a->to != transition_b->to) return transition_a->to < transition_b->to ? -1 : 1;
+    if (transition_a->time != transition_b->time) return transition_a->time < transition_b->time ? -1 : 1;
+    return 0;
+}
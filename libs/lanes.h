@@ -0,0 +1,69 @@
+#ifndef LANES_H
+#define LANES_H
+
+/*
+    ENUMERATIONS
+*/
+// This enumeration the codes of the cost given to the edges of the lanes
+enum Lane_cost {Median, Min};
+
+/*
+    STRUCTURES TO MANAGE THE GRID
+*/
+// Stores an occupied cell of the grid and the id of the lane node that represents it
+typedef struct {
+    long row, col;
+    unsigned long lane_id;
+} Lane_cell;
+
+// Stores a hash table with open addressing of the occupied cells
+typedef struct {
+    unsigned long size;
+    unsigned long ncells;
+    Lane_cell *cells;
+} Cell_table;
+
+// Stores one traversal between two cells and the time it took
+typedef struct {
+    unsigned long from, to;
+    double time;
+} Lane_transition;
+
+/*
+    GRID MANAGEMENT
+*/
+// Computes the row and column of the cell of size cell_km that contains the coordinates.
+void cell_of(double lat, double lon, double cell_km, long *row, long *col);
+
+// Creates an empty table able to store, at least, max_cells cells.
+void create_cell_table(Cell_table *table, unsigned long max_cells);
+
+// Returns the slot of the cell in the table, or the empty slot where it would be added if it is not in the table.
+unsigned long cell_slot(Cell_table *table, long row, long col);
+
+// Returns the lane id of the cell. If the cell is not in the table, it is added with the next lane id.
+unsigned long cell_lane_id(Cell_table *table, long row, long col);
+
+// Returns the lane id of the cell, or ULONG_MAX if the cell is not in the table.
+unsigned long find_cell_lane_id(Cell_table *table, long row, long col);
+
+// Free all the memory allocated related to the table
+void free_cell_table(Cell_table *table);
+
+/*
+    LANES GRAPH
+*/
+/*
+ * Snaps the paths to a grid of cells of size cell_km and creates a graph with a node per occupied cell.
+ * All the traversals between two cells are aggregated in a single edge whose cost is the median or minimum time.
+ * Every path is translated to the sequence of cells it visits.
+*/
+void build_lane_graph(Node *nodes, Path *paths, unsigned long nnodes, unsigned long npaths,
+                        double cell_km, int edge_cost,
+                        Node **lane_nodes_ptr, Path **lane_paths_ptr,
+                        unsigned long *lane_nnodes, unsigned long *lane_nedges);
+
+// Compares two transitions by origin, destination and time. Used to sort them with qsort.
+int compare_transitions(const void *a, const void *b);
+
+#endif
@@ -22,10 +22,10 @@ typedef struct {
     unsigned long nsolution;
 } PQ_Metrics;
 
-// Creates and stores a file with the heuristic metrics selected
-void store_heuristic_metrics(Heuristic_Metrics *metrics_ll, Heuristic_Metrics *metrics_bh, unsigned long npaths, char *filename);
+// Creates and stores a file with the heuristic metrics of nqueues Priority Queues, whose columns are named by names
+void store_heuristic_metrics(Heuristic_Metrics **metrics, const char **names, int nqueues, unsigned long npaths, char *filename);
 
-// Creates and stores a file with the Priority Queue metrics selected
-void store_pq_metrics(PQ_Metrics *metrics_ll, PQ_Metrics *metrics_bh, unsigned long npaths, char *filename);
+// Creates and stores a file with the Priority Queue metrics of nqueues Priority Queues, whose columns are named by names
+void store_pq_metrics(PQ_Metrics **metrics, const char **names, int nqueues, unsigned long npaths, char *filename);
 
 #endif
\ No newline at end of file
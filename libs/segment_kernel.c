@@ -0,0 +1,403 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$    SEGMENT_KERNEL.C VERSION 1.0    $$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "segment_kernel.h"
+
+    - Comments:
+        >> The original edges are copied once into contiguous arrays of coordinates, so testing an edge against all
+            the edges of another path reads memory sequentially instead of following the linked list and the nodes array.
+        >> The filter computes the same cross products and parameters t and u as identify_intersection, for 4 edges at once
+            with AVX (compiling with -mavx or -mavx2), 2 edges at once with SSE2 (any x86-64 processor) or one by one otherwise.
+            It does not branch on the intersection type: it only discards the pairs that can not intersect.
+        >> The few pairs that pass the filter are classified with identify_intersection, so the result is exactly the same
+            as comparing every pair of edges one by one.
+        >> Every path has a bounding volume hierarchy over runs of consecutive edges. Two paths are compared by descending
+            both hierarchies at once, so only the runs near the other path are filtered instead of all the pairs of edges.
+            The hierarchies are rebuilt in linear time on every run, as the edges change when the crossings are spliced.
+
+    - Further development:
+        >> Run the detection of every path 1 in parallel, as in the parallel grid engine.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "graph_management.h"
+#include "sweep_line.h"
+#include "intersections.h"
+#include "segment_kernel.h"
+
+/*
+    SEGMENT ARRAYS MANAGEMENT
+*/
+
+void create_segment_arrays(Segment_arrays *segments, Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending) {
+    unsigned long i_path, index;
+    Path_node *curr_node;
+
+    // 1. Count the edges of every path
+    segments->first = (unsigned long *) malloc((npaths + 1) * sizeof(unsigned long));
+    if (segments->first == NULL) ExitError("when allocating memory for the first edges of the segment arrays", 1);
+    segments->nsegments = 0;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        segments->first[i_path] = segments->nsegments;
+        if (pending != NULL && pending[i_path] == 0) continue;
+        if (paths[i_path].len > 1) segments->nsegments += paths[i_path].len - 1;
+    }
+    segments->first[npaths] = segments->nsegments;
+
+    // 2. Copy the coordinates and ids of the endpoints of every edge
+    index = segments->nsegments ? segments->nsegments : 1;
+    segments->p_lon = (double *) malloc(index * sizeof(double));
+    segments->p_lat = (double *) malloc(index * sizeof(double));
+    segments->q_lon = (double *) malloc(index * sizeof(double));
+    segments->q_lat = (double *) malloc(index * sizeof(double));
+    segments->p_id = (unsigned long *) malloc(index * sizeof(unsigned long));
+    segments->q_id = (unsigned long *) malloc(index * sizeof(unsigned long));
+    if (segments->p_lon == NULL || segments->p_lat == NULL || segments->q_lon == NULL || segments->q_lat == NULL ||
+        segments->p_id == NULL || segments->q_id == NULL) ExitError("when allocating memory for the segment arrays", 2);
+
+    for (i_path = 0; i_path < npaths; i_path++) {
+        if (pending != NULL && pending[i_path] == 0) continue;
+        index = segments->first[i_path];
+        for (curr_node = &paths[i_path].start_node; curr_node->next != NULL; curr_node = curr_node->next) {
+            segments->p_id[index] = curr_node->node_id;
+            segments->q_id[index] = curr_node->next->node_id;
+            segments->p_lon[index] = nodes[curr_node->node_id].lon;
+            segments->p_lat[index] = nodes[curr_node->node_id].lat;
+            segments->q_lon[index] = nodes[curr_node->next->node_id].lon;
+            segments->q_lat[index] = nodes[curr_node->next->node_id].lat;
+            index++;
+        }
+    }
+}
+
+void free_segment_arrays(Segment_arrays *segments) {
+    free(segments->first);
+    free(segments->p_lon);
+    free(segments->p_lat);
+    free(segments->q_lon);
+    free(segments->q_lat);
+    free(segments->p_id);
+    free(segments->q_id);
+}
+
+/*
+    FILTER KERNEL
+*/
+
+unsigned long filter_segments(Segment_arrays *segments, unsigned long first, unsigned long nsegs,
+                            double p1_lon, double p1_lat, double q1_lon, double q1_lat, unsigned long *hits) {
+    const double *p2_lon = &segments->p_lon[first], *p2_lat = &segments->p_lat[first];
+    const double *q2_lon = &segments->q_lon[first], *q2_lat = &segments->q_lat[first];
+    double r_lon, r_lat, s_lon, s_lat, w_lon, w_lat, den, t_num, u_num, t, u;
+    unsigned long index, nhits;
+
+    r_lon = q1_lon - p1_lon;
+    r_lat = q1_lat - p1_lat;
+    nhits = 0;
+    index = 0;
+
+#if defined(__AVX__)
+    // 1. Test 4 edges at once
+    __m256d v_p1_lon = _mm256_set1_pd(p1_lon), v_p1_lat = _mm256_set1_pd(p1_lat);
+    __m256d v_r_lon = _mm256_set1_pd(r_lon), v_r_lat = _mm256_set1_pd(r_lat);
+    __m256d v_zero = _mm256_setzero_pd(), v_low = _mm256_set1_pd(-KERNEL_EPSILON), v_high = _mm256_set1_pd(1. + KERNEL_EPSILON);
+    int mask;
+    __m256d v_s_lon, v_s_lat, v_w_lon, v_w_lat, v_den, v_t_num, v_u_num, v_t, v_u, v_hit, v_colinear;
+    for (; index + 4 <= nsegs; index += 4) {
+        v_w_lon = _mm256_sub_pd(_mm256_loadu_pd(&p2_lon[index]), v_p1_lon);
+        v_w_lat = _mm256_sub_pd(_mm256_loadu_pd(&p2_lat[index]), v_p1_lat);
+        v_s_lon = _mm256_sub_pd(_mm256_loadu_pd(&q2_lon[index]), _mm256_loadu_pd(&p2_lon[index]));
+        v_s_lat = _mm256_sub_pd(_mm256_loadu_pd(&q2_lat[index]), _mm256_loadu_pd(&p2_lat[index]));
+        v_den = _mm256_sub_pd(_mm256_mul_pd(v_r_lon, v_s_lat), _mm256_mul_pd(v_r_lat, v_s_lon));
+        v_t_num = _mm256_sub_pd(_mm256_mul_pd(v_w_lon, v_s_lat), _mm256_mul_pd(v_w_lat, v_s_lon));
+        v_u_num = _mm256_sub_pd(_mm256_mul_pd(v_w_lon, v_r_lat), _mm256_mul_pd(v_w_lat, v_r_lon));
+        v_t = _mm256_div_pd(v_t_num, v_den);
+        v_u = _mm256_div_pd(v_u_num, v_den);
+        // The comparisons with NaN are false, so the parallel edges only pass if they are colinear
+        v_hit = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(v_t, v_low, _CMP_GE_OQ), _mm256_cmp_pd(v_t, v_high, _CMP_LE_OQ)),
+                            _mm256_and_pd(_mm256_cmp_pd(v_u, v_low, _CMP_GE_OQ), _mm256_cmp_pd(v_u, v_high, _CMP_LE_OQ)));
+        v_colinear = _mm256_and_pd(_mm256_cmp_pd(v_den, v_zero, _CMP_EQ_OQ), _mm256_cmp_pd(v_t_num, v_zero, _CMP_EQ_OQ));
+        mask = _mm256_movemask_pd(_mm256_or_pd(v_hit, v_colinear));
+        while (mask) {
+            hits[nhits++] = index + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    // 1. Test 2 edges at once
+    __m128d v_p1_lon = _mm_set1_pd(p1_lon), v_p1_lat = _mm_set1_pd(p1_lat);
+    __m128d v_r_lon = _mm_set1_pd(r_lon), v_r_lat = _mm_set1_pd(r_lat);
+    __m128d v_zero = _mm_setzero_pd(), v_low = _mm_set1_pd(-KERNEL_EPSILON), v_high = _mm_set1_pd(1. + KERNEL_EPSILON);
+    int mask;
+    __m128d v_s_lon, v_s_lat, v_w_lon, v_w_lat, v_den, v_t_num, v_u_num, v_t, v_u, v_hit, v_colinear;
+    for (; index + 2 <= nsegs; index += 2) {
+        v_w_lon = _mm_sub_pd(_mm_loadu_pd(&p2_lon[index]), v_p1_lon);
+        v_w_lat = _mm_sub_pd(_mm_loadu_pd(&p2_lat[index]), v_p1_lat);
+        v_s_lon = _mm_sub_pd(_mm_loadu_pd(&q2_lon[index]), _mm_loadu_pd(&p2_lon[index]));
+        v_s_lat = _mm_sub_pd(_mm_loadu_pd(&q2_lat[index]), _mm_loadu_pd(&p2_lat[index]));
+        v_den = _mm_sub_pd(_mm_mul_pd(v_r_lon, v_s_lat), _mm_mul_pd(v_r_lat, v_s_lon));
+        v_t_num = _mm_sub_pd(_mm_mul_pd(v_w_lon, v_s_lat), _mm_mul_pd(v_w_lat, v_s_lon));
+        v_u_num = _mm_sub_pd(_mm_mul_pd(v_w_lon, v_r_lat), _mm_mul_pd(v_w_lat, v_r_lon));
+        v_t = _mm_div_pd(v_t_num, v_den);
+        v_u = _mm_div_pd(v_u_num, v_den);
+        // The comparisons with NaN are false, so the parallel edges only pass if they are colinear
+        v_hit = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(v_t, v_low), _mm_cmple_pd(v_t, v_high)),
+                        _mm_and_pd(_mm_cmpge_pd(v_u, v_low), _mm_cmple_pd(v_u, v_high)));
+        v_colinear = _mm_and_pd(_mm_cmpeq_pd(v_den, v_zero), _mm_cmpeq_pd(v_t_num, v_zero));
+        mask = _mm_movemask_pd(_mm_or_pd(v_hit, v_colinear));
+        if (mask & 1) hits[nhits++] = index;
+        if (mask & 2) hits[nhits++] = index + 1;
+    }
+#endif
+
+    // 2. Test the remaining edges one by one
+    for (; index < nsegs; index++) {
+        w_lon = p2_lon[index] - p1_lon;
+        w_lat = p2_lat[index] - p1_lat;
+        s_lon = q2_lon[index] - p2_lon[index];
+        s_lat = q2_lat[index] - p2_lat[index];
+        den = r_lon * s_lat - r_lat * s_lon;
+        t_num = w_lon * s_lat - w_lat * s_lon;
+        u_num = w_lon * r_lat - w_lat * r_lon;
+        if (den != 0) {
+            t = t_num / den;
+            u = u_num / den;
+            if (t >= -KERNEL_EPSILON && t <= 1. + KERNEL_EPSILON && u >= -KERNEL_EPSILON && u <= 1. + KERNEL_EPSILON) hits[nhits++] = index;
+        } else if (t_num == 0) hits[nhits++] = index;
+    }
+    return nhits;
+}
+
+/*
+    BOUNDING VOLUME HIERARCHY
+*/
+
+void create_segment_bvh(Segment_arrays *segments, unsigned long npaths) {
+    unsigned long i_path, nleaves, max_nodes;
+
+    // 1. Every path has a binary tree with 2 * nleaves - 1 nodes at most
+    max_nodes = 1;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        nleaves = (segments->first[i_path + 1] - segments->first[i_path] + BVH_LEAF_SIZE - 1) / BVH_LEAF_SIZE;
+        if (nleaves) max_nodes += 2 * nleaves - 1;
+    }
+    segments->bvh = (Bvh_node *) malloc(max_nodes * sizeof(Bvh_node));
+    segments->bvh_root = (unsigned long *) malloc((npaths ? npaths : 1) * sizeof(unsigned long));
+    if (segments->bvh == NULL || segments->bvh_root == NULL) ExitError("when allocating memory for the bounding volume hierarchy", 1);
+
+    // 2. Build the tree of every path. The paths without edges point to the empty node 0.
+    segments->bvh[0].begin = 0;
+    segments->bvh[0].end = 0;
+    segments->bvh[0].left = 0;
+    segments->bvh[0].right = 0;
+    segments->bvh[0].min_lon = segments->bvh[0].min_lat = 1.;
+    segments->bvh[0].max_lon = segments->bvh[0].max_lat = -1.;
+    segments->nbvh = 1;
+    for (i_path = 0; i_path < npaths; i_path++) {
+        if (segments->first[i_path + 1] == segments->first[i_path]) segments->bvh_root[i_path] = 0;
+        else segments->bvh_root[i_path] = build_bvh_node(segments, segments->first[i_path], segments->first[i_path + 1]);
+    }
+}
+
+unsigned long build_bvh_node(Segment_arrays *segments, unsigned long begin, unsigned long end) {
+    unsigned long node, index, nleaves;
+    Bvh_node *curr;
+
+    node = segments->nbvh++;
+    curr = &segments->bvh[node];
+    curr->begin = begin;
+    curr->end = end;
+    curr->left = 0;
+    curr->right = 0;
+    if (end - begin > BVH_LEAF_SIZE) {
+        // The left child takes the first half of the leaves, so all the leaves but the last one are full
+        nleaves = (end - begin + BVH_LEAF_SIZE - 1) / BVH_LEAF_SIZE;
+        index = begin + (nleaves / 2) * BVH_LEAF_SIZE;
+        curr->left = build_bvh_node(segments, begin, index);
+        curr->right = build_bvh_node(segments, index, end);
+        curr = &segments->bvh[node];
+        curr->min_lon = fmin(segments->bvh[curr->left].min_lon, segments->bvh[curr->right].min_lon);
+        curr->max_lon = fmax(segments->bvh[curr->left].max_lon, segments->bvh[curr->right].max_lon);
+        curr->min_lat = fmin(segments->bvh[curr->left].min_lat, segments->bvh[curr->right].min_lat);
+        curr->max_lat = fmax(segments->bvh[curr->left].max_lat, segments->bvh[curr->right].max_lat);
+    } else {
+        curr->min_lon = curr->max_lon = segments->p_lon[begin];
+        curr->min_lat = curr->max_lat = segments->p_lat[begin];
+        for (index = begin; index < end; index++) {
+            curr->min_lon = fmin(curr->min_lon, fmin(segments->p_lon[index], segments->q_lon[index]));
+            curr->max_lon = fmax(curr->max_lon, fmax(segments->p_lon[index], segments->q_lon[index]));
+            curr->min_lat = fmin(curr->min_lat, fmin(segments->p_lat[index], segments->q_lat[index]));
+            curr->max_lat = fmax(curr->max_lat, fmax(segments->p_lat[index], segments->q_lat[index]));
+        }
+    }
+    return node;
+}
+
+unsigned short bvh_overlap(Bvh_node *a, Bvh_node *b) {
+    return !(a->min_lon > b->max_lon + GRID_EPSILON || a->max_lon < b->min_lon - GRID_EPSILON ||
+            a->min_lat > b->max_lat + GRID_EPSILON || a->max_lat < b->min_lat - GRID_EPSILON);
+}
+
+void free_segment_bvh(Segment_arrays *segments) {
+    free(segments->bvh);
+    free(segments->bvh_root);
+}
+
+/*
+    CROSSINGS DETECTION
+*/
+
+void push_bvh_pair(Kernel_work *work, unsigned long *nstack, unsigned long node_1, unsigned long node_2) {
+    if (*nstack + 2 > work->max_stack) {
+        work->max_stack = work->max_stack ? 2 * work->max_stack : 256;
+        work->stack = (unsigned long *) realloc(work->stack, work->max_stack * sizeof(unsigned long));
+        if (work->stack == NULL) ExitError("when reallocating memory for the stack of the hierarchies", 1);
+    }
+    work->stack[(*nstack)++] = node_1;
+    work->stack[(*nstack)++] = node_2;
+}
+
+unsigned long kernel_pair_crossings(Node *nodes, Kernel_work *work, unsigned long i_path_1, unsigned long i_path_2,
+                                    Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings) {
+    Segment_arrays *segments = work->segments;
+    Bvh_node *node_1, *node_2, leaf_1;
+    unsigned long nstack, index, hit, nhits, initial_ncrossings;
+    unsigned short intersection_type;
+    double t, u;
+
+    // 1. Descend both hierarchies from the roots, keeping only the pairs of nodes that overlap
+    initial_ncrossings = *ncrossings;
+    nstack = 0;
+    push_bvh_pair(work, &nstack, segments->bvh_root[i_path_1], segments->bvh_root[i_path_2]);
+    while (nstack) {
+        node_2 = &segments->bvh[work->stack[--nstack]];
+        node_1 = &segments->bvh[work->stack[--nstack]];
+        if (!bvh_overlap(node_1, node_2)) continue;
+
+        // 1.1. Split the node with more edges, or the one that is not a leaf
+        if (node_1->left && (node_2->left == 0 || node_1->end - node_1->begin >= node_2->end - node_2->begin)) {
+            push_bvh_pair(work, &nstack, node_1->right, node_2 - segments->bvh);
+            push_bvh_pair(work, &nstack, node_1->left, node_2 - segments->bvh);
+            continue;
+        } else if (node_2->left) {
+            push_bvh_pair(work, &nstack, node_1 - segments->bvh, node_2->right);
+            push_bvh_pair(work, &nstack, node_1 - segments->bvh, node_2->left);
+            continue;
+        }
+
+        // 2. Both nodes are leaves: every edge of path 1 that overlaps the run of path 2 is filtered against all of it
+        work->pairs_tested += (node_1->end - node_1->begin) * (node_2->end - node_2->begin);
+        for (index = node_1->begin; index < node_1->end; index++) {
+            leaf_1.min_lon = fmin(segments->p_lon[index], segments->q_lon[index]);
+            leaf_1.max_lon = fmax(segments->p_lon[index], segments->q_lon[index]);
+            leaf_1.min_lat = fmin(segments->p_lat[index], segments->q_lat[index]);
+            leaf_1.max_lat = fmax(segments->p_lat[index], segments->q_lat[index]);
+            if (!bvh_overlap(&leaf_1, node_2)) continue;
+
+            nhits = filter_segments(segments, node_2->begin, node_2->end - node_2->begin, segments->p_lon[index], segments->p_lat[index],
+                                    segments->q_lon[index], segments->q_lat[index], work->hits);
+            for (hit = 0; hit < nhits; hit++) {
+                intersection_type = identify_intersection(&nodes[segments->p_id[index]], &nodes[segments->q_id[index]],
+                                                        &nodes[segments->p_id[node_2->begin + work->hits[hit]]],
+                                                        &nodes[segments->q_id[node_2->begin + work->hits[hit]]], &t, &u);
+                if (intersection_type == 0) continue;
+
+                if (*ncrossings == *max_crossings) {
+                    *max_crossings = *max_crossings ? 2 * (*max_crossings) : 64;
+                    *crossings_ptr = (Crossing *) realloc(*crossings_ptr, (*max_crossings) * sizeof(Crossing));
+                    if (*crossings_ptr == NULL) ExitError("when reallocating memory for the crossings", 2);
+                }
+                (*crossings_ptr)[*ncrossings].path_1 = i_path_1;
+                (*crossings_ptr)[*ncrossings].seg_1 = index - segments->first[i_path_1];
+                (*crossings_ptr)[*ncrossings].path_2 = i_path_2;
+                (*crossings_ptr)[*ncrossings].seg_2 = node_2->begin + work->hits[hit] - segments->first[i_path_2];
+                (*crossings_ptr)[*ncrossings].type = intersection_type;
+                (*ncrossings)++;
+            }
+        }
+    }
+
+    // 3. The leaves are visited out of order, so the crossings are sorted by seg 1 and seg 2
+    if (*ncrossings - initial_ncrossings > 1)
+        qsort(&(*crossings_ptr)[initial_ncrossings], *ncrossings - initial_ncrossings, sizeof(Crossing), compare_crossings);
+    return *ncrossings - initial_ncrossings;
+}
+
+unsigned long kernel_path_crossings(Node *nodes, Path *paths, unsigned long npaths, Kernel_work *work, unsigned long i_path_1,
+                                    Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings) {
+    unsigned long initial_path_2, i_path_2, initial_ncrossings;
+
+    initial_ncrossings = *ncrossings;
+    if (paths[i_path_1].npaths) initial_path_2 = paths[i_path_1].npaths + 1;
+    else initial_path_2 = i_path_1 + 1;
+
+    for (i_path_2 = initial_path_2; i_path_2 < npaths; i_path_2++) {
+        if (need_compute_paths(paths, i_path_1, i_path_2) == 0) continue;
+        work->pairs_total += (work->segments->first[i_path_1 + 1] - work->segments->first[i_path_1]) *
+                            (work->segments->first[i_path_2 + 1] - work->segments->first[i_path_2]);
+        kernel_pair_crossings(nodes, work, i_path_1, i_path_2, crossings_ptr, ncrossings, max_crossings);
+    }
+    return *ncrossings - initial_ncrossings;
+}
+
+unsigned long kernel_crossings(Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending,
+                            Crossing **crossings_ptr, Intersections_telemetry *telemetry) {
+    Segment_arrays segments;
+    Kernel_work work;
+    unsigned long i_path, ncrossings, max_crossings, initial_tested, initial_ncrossings, initial_max_crossings;
+
+    // 1. Copy the edges into the arrays and build the hierarchies of every path
+    create_segment_arrays(&segments, nodes, paths, npaths, pending);
+    create_segment_bvh(&segments, npaths);
+    work.segments = &segments;
+    work.hits = (unsigned long *) malloc(BVH_LEAF_SIZE * sizeof(unsigned long));
+    if (work.hits == NULL) ExitError("when allocating memory for the hits of the kernel", 1);
+    work.stack = NULL;
+    work.max_stack = 0;
+    work.pairs_tested = 0;
+    work.pairs_total = 0;
+
+    // 2. Detect the crossings of every path with the following ones, in order
+    *crossings_ptr = NULL;
+    ncrossings = 0;
+    max_crossings = 0;
+    for (i_path = 0; i_path + 1 < npaths; i_path++) if (pending == NULL || pending[i_path]) {
+        initial_tested = work.pairs_tested;
+        initial_ncrossings = ncrossings;
+        initial_max_crossings = max_crossings;
+        kernel_path_crossings(nodes, paths, npaths, &work, i_path, crossings_ptr, &ncrossings, &max_crossings);
+        if (telemetry != NULL) {
+            telemetry->threads[0].segment_tests += work.pairs_tested - initial_tested;
+            telemetry->threads[0].crossings += ncrossings - initial_ncrossings;
+            telemetry->threads[0].bytes_allocated += (max_crossings - initial_max_crossings) * sizeof(Crossing);
+            finish_path_telemetry(telemetry, 0, i_path);
+            tick_telemetry(telemetry);
+        }
+    }
+    printf("Pairs of edges filtered: %lu out of %lu (%.2f %% pruned by the hierarchies)\n", work.pairs_tested, work.pairs_total,
+            work.pairs_total ? 100. * (double) (work.pairs_total - work.pairs_tested) / (double) work.pairs_total : 0.);
+
+    free(work.hits);
+    free(work.stack);
+    free_segment_bvh(&segments);
+    free_segment_arrays(&segments);
+    return ncrossings;
+}
@@ -0,0 +1,120 @@
+#ifndef SEGMENT_KERNEL_H
+#define SEGMENT_KERNEL_H
+
+/*
+    STRUCTURES TO STORE THE SEGMENTS
+*/
+
+// Stores a node of the bounding volume hierarchy of a path: the bounding box of the edges from begin to end.
+// left and right are the positions of the children in the array of nodes, or 0 in the leaves.
+typedef struct {
+    double min_lon, max_lon, min_lat, max_lat;
+    unsigned long begin, end;
+    unsigned long left, right;
+} Bvh_node;
+
+/*
+ * Stores the original edges of every path as a structure of arrays, so the coordinates of consecutive edges are contiguous.
+ * The edges of path i are stored from first[i] to first[i + 1]. An edge goes from (p_lon, p_lat) to (q_lon, q_lat),
+ * being p_id and q_id the ids of its nodes.
+ * bvh stores the nodes of the bounding volume hierarchies of all the paths, being bvh_root[i] the root of path i.
+*/
+typedef struct {
+    unsigned long *first;
+    unsigned long nsegments;
+    double *p_lon, *p_lat, *q_lon, *q_lat;
+    unsigned long *p_id, *q_id;
+    Bvh_node *bvh;
+    unsigned long nbvh;
+    unsigned long *bvh_root;
+} Segment_arrays;
+
+// Stores the state of the detection: the arrays, the buffer of hits of the filter and the stack of pairs of nodes
+// of the hierarchies to visit. It also counts the pairs of edges filtered out of the ones of the paths computed.
+typedef struct {
+    Segment_arrays *segments;
+    unsigned long *hits;
+    unsigned long *stack;
+    unsigned long max_stack;
+    unsigned long pairs_tested, pairs_total;
+} Kernel_work;
+
+// Maximum number of consecutive edges of a path in a leaf of its hierarchy
+#define BVH_LEAF_SIZE 16
+
+// Relative margin of the parameters t and u in the filter, so it never rejects a pair accepted by identify_intersection
+#define KERNEL_EPSILON 1e-9
+
+/*
+    SEGMENT ARRAYS MANAGEMENT
+*/
+
+// Copies the original edges of the paths into the arrays. The paths that are not pending have no edges, unless pending is NULL.
+void create_segment_arrays(Segment_arrays *segments, Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending);
+
+// Frees the arrays
+void free_segment_arrays(Segment_arrays *segments);
+
+/*
+    FILTER KERNEL
+*/
+
+/*
+ * Tests the edge p1-q1 against the nsegs edges of the arrays starting at first, several at once with SIMD instructions if available.
+ * Stores in hits the positions, relative to first, of the edges that may intersect it, and returns how many they are.
+ * Every pair with an intersection type other than 0 is a hit, so they only need to be classified by identify_intersection.
+*/
+unsigned long filter_segments(Segment_arrays *segments, unsigned long first, unsigned long nsegs,
+                            double p1_lon, double p1_lat, double q1_lon, double q1_lat, unsigned long *hits);
+
+/*
+    BOUNDING VOLUME HIERARCHY
+*/
+
+/*
+ * Builds the hierarchy of every path over the arrays. The leaves are runs of BVH_LEAF_SIZE consecutive edges
+ * and every node covers the runs of its two children, so the tree is balanced and built in linear time.
+*/
+void create_segment_bvh(Segment_arrays *segments, unsigned long npaths);
+
+// Builds the node of the edges from begin to end and its descendants. Returns its position in the array of nodes.
+unsigned long build_bvh_node(Segment_arrays *segments, unsigned long begin, unsigned long end);
+
+// Returns 1 if the bounding boxes of the nodes overlap, enlarged GRID_EPSILON, and 0 otherwise
+unsigned short bvh_overlap(Bvh_node *a, Bvh_node *b);
+
+// Frees the hierarchies
+void free_segment_bvh(Segment_arrays *segments);
+
+/*
+    CROSSINGS DETECTION
+*/
+
+// Adds a pair of nodes of the hierarchies of path 1 and path 2 to the stack of the work
+void push_bvh_pair(Kernel_work *work, unsigned long *nstack, unsigned long node_1, unsigned long node_2);
+
+/*
+ * Finds the intersecting pairs of original edges of path 1 and path 2, crossing, touching or overlapping, with their type.
+ * Both hierarchies are descended at once and only the pairs of overlapping leaves are compared, every edge of one against
+ * the run of the other through the filter kernel. The pairs are appended to *crossings_ptr sorted by seg 1 and seg 2.
+ * Returns how many they are.
+*/
+unsigned long kernel_pair_crossings(Node *nodes, Kernel_work *work, unsigned long i_path_1, unsigned long i_path_2,
+                                    Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings);
+
+/*
+ * Finds the crossings between the original edges of path 1 and the following paths to compute.
+ * The crossings are appended to *crossings_ptr sorted by path 2, seg 1 and seg 2. Returns the number of crossings appended.
+*/
+unsigned long kernel_path_crossings(Node *nodes, Path *paths, unsigned long npaths, Kernel_work *work, unsigned long i_path_1,
+                                    Crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings);
+
+/*
+ * Finds the crossings between the original edges of every pair of paths to compute. Returns the number of crossings.
+ * Only the edges of the pending paths are stored, so updating a graph with a few new paths does not copy the old ones.
+ * The counters of the first thread of the telemetry are updated after every path 1. Use NULL to find them without telemetry.
+*/
+unsigned long kernel_crossings(Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending,
+                            Crossing **crossings_ptr, Intersections_telemetry *telemetry);
+
+#endif
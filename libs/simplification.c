@@ -0,0 +1,322 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$    SIMPLIFICATION.C VERSION 1.0    $$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "simplification.h"
+
+    - Comments:
+        >> The simplification is a Douglas-Peucker algorithm that uses the synchronized euclidean distance (SED):
+            the distance between a node and the position where the ship would be at the same time travelling
+            straight between the kept nodes. Thus, the changes of speed are also preserved, not only the shape.
+        >> The first and last nodes of every path are always kept.
+        >> A stationary episode is collapsed into its first node, unless it reaches the end of the path. In that case, it is
+            collapsed into the last one, so the dwell time is added to the incoming edge.
+        >> The recursion of Douglas-Peucker is done with an explicit stack, as the paths can be very long.
+        >> Only applicable for not crossed paths graphs, as every node must belong to a single path.
+
+    - Further development:
+        >> The interpolation is done directly over the coordinates, so it is not correct for paths crossing the antimeridian.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "graph_management.h"
+#include "simplification.h"
+
+/*
+    PATHS SIMPLIFICATION
+*/
+
+unsigned long simplify_path(Node *nodes, Path *path, double tolerance_km, double max_edge_time, unsigned char *keep) {
+    // 1. Copy the nodes of the path and their accumulated times in arrays
+    unsigned long len, index;
+    unsigned long *ids;
+    double *times;
+    Path_node *curr_path_node;
+
+    len = path->len;
+    // A path of a single node has nothing to simplify
+    if (len < 2) {
+        if (len == 1) keep[path->start_node.node_id] = 1;
+        return len;
+    }
+    ids = (unsigned long *) malloc(len * sizeof(unsigned long));
+    times = (double *) malloc(len * sizeof(double));
+    if (ids == NULL) ExitError("when allocating memory for the ids of the path to simplify", 1);
+    if (times == NULL) ExitError("when allocating memory for the times of the path to simplify", 2);
+
+    curr_path_node = &path->start_node;
+    for (index = 0; index < len; index++) {
+        ids[index] = curr_path_node->node_id;
+        if (index == 0) times[index] = 0.;
+        else times[index] = times[index - 1] + edge_time(nodes, ids[index - 1], ids[index]);
+        keep[ids[index]] = 0;
+        curr_path_node = curr_path_node->next;
+    }
+    keep[ids[0]] = 1;
+    keep[ids[len - 1]] = 1;
+
+    // 2. Douglas-Peucker with the synchronized euclidean distance
+    unsigned long *stack;
+    unsigned long nstack, a, b, i, split;
+    unsigned long nkept;
+    double ratio, lat, lon, sed, max_sed, midtime, time_gap, min_time_gap;
+
+    stack = (unsigned long *) malloc(2 * len * sizeof(unsigned long));
+    if (stack == NULL) ExitError("when allocating memory for the Douglas-Peucker stack", 3);
+
+    nkept = 2;
+    nstack = 0;
+    if (len > 2) {
+        stack[nstack++] = 0;
+        stack[nstack++] = len - 1;
+    }
+    while (nstack) {
+        b = stack[--nstack];
+        a = stack[--nstack];
+        if (b <= a + 1) continue;
+
+        // 2.1. Find the node that is further from its synchronized position
+        split = a + 1;
+        max_sed = -1.;
+        for (i = a + 1; i < b; i++) {
+            if (times[b] > times[a]) ratio = (times[i] - times[a]) / (times[b] - times[a]);
+            else ratio = (double) (i - a) / (double) (b - a);
+            lat = nodes[ids[a]].lat + ratio * (nodes[ids[b]].lat - nodes[ids[a]].lat);
+            lon = nodes[ids[a]].lon + ratio * (nodes[ids[b]].lon - nodes[ids[a]].lon);
+            sed = distance_km(nodes[ids[i]].lon, nodes[ids[i]].lat, lon, lat);
+            if (sed > max_sed) {
+                max_sed = sed;
+                split = i;
+            }
+        }
+
+        // 2.2. If the spatial tolerance is fulfilled, the edge can still be too long in time
+        if (max_sed <= tolerance_km) {
+            if (max_edge_time <= 0 || times[b] - times[a] <= max_edge_time) continue;
+            midtime = (times[a] + times[b]) / 2;
+            min_time_gap = -1.;
+            for (i = a + 1; i < b; i++) {
+                time_gap = fabs(times[i] - midtime);
+                if (min_time_gap < 0 || time_gap < min_time_gap) {
+                    min_time_gap = time_gap;
+                    split = i;
+                }
+            }
+        }
+
+        keep[ids[split]] = 1;
+        nkept++;
+        stack[nstack++] = a;
+        stack[nstack++] = split;
+        stack[nstack++] = split;
+        stack[nstack++] = b;
+    }
+
+    free(stack);
+    free(ids);
+    free(times);
+    return nkept;
+}
+
+unsigned long compress_stops(Node *nodes, Path *path, double radius_km, double min_dwell, unsigned char *keep) {
+    // 1. Copy the nodes of the path and their accumulated times in arrays
+    unsigned long len, index;
+    unsigned long *ids;
+    double *times;
+    Path_node *curr_path_node;
+
+    len = path->len;
+    ids = (unsigned long *) malloc(len * sizeof(unsigned long));
+    times = (double *) malloc(len * sizeof(double));
+    if (ids == NULL) ExitError("when allocating memory for the ids of the path to compress", 1);
+    if (times == NULL) ExitError("when allocating memory for the times of the path to compress", 2);
+
+    curr_path_node = &path->start_node;
+    for (index = 0; index < len; index++) {
+        ids[index] = curr_path_node->node_id;
+        if (index == 0) times[index] = 0.;
+        else times[index] = times[index - 1] + edge_time(nodes, ids[index - 1], ids[index]);
+        keep[ids[index]] = 1;
+        curr_path_node = curr_path_node->next;
+    }
+
+    // 2. Find the stationary episodes
+    unsigned long first, last, i, kept, nstops;
+    double lat, lon;
+
+    nstops = 0;
+    first = 0;
+    while (first < len - 1) {
+        // 2.1. Extend the episode while the nodes stay close to the first one
+        last = first;
+        while (last + 1 < len &&
+                distance_km(nodes[ids[first]].lon, nodes[ids[first]].lat, nodes[ids[last + 1]].lon, nodes[ids[last + 1]].lat) <= radius_km) {
+            last++;
+        }
+        if (last == first || times[last] - times[first] < min_dwell) {
+            first++;
+            continue;
+        }
+
+        // 2.2. Collapse the episode into a single node placed at its centroid
+        lat = 0.;
+        lon = 0.;
+        for (i = first; i <= last; i++) {
+            lat += nodes[ids[i]].lat;
+            lon += nodes[ids[i]].lon;
+            keep[ids[i]] = 0;
+        }
+        kept = (last == len - 1 && first != 0) ? last : first;
+        keep[ids[kept]] = 1;
+        keep[ids[len - 1]] = 1;
+        nodes[ids[kept]].lat = lat / (double) (last - first + 1);
+        nodes[ids[kept]].lon = lon / (double) (last - first + 1);
+
+        nstops++;
+        first = last + 1;
+    }
+
+    free(ids);
+    free(times);
+    return nstops;
+}
+
+double segment_pairs_work(Path *paths, unsigned long npaths) {
+    ST_counter *head_ST, *curr_ST;
+    unsigned long index;
+    double nsegments, sum, sum_squared, work;
+
+    if (npaths == 0) return 0.;
+    work = 0.;
+    head_ST = count_shiptypes(paths, npaths);
+    for (curr_ST = head_ST; curr_ST != NULL; curr_ST = curr_ST->next) {
+        sum = 0.;
+        sum_squared = 0.;
+        for (index = 0; index < npaths; index++) {
+            if (paths[index].shiptype != curr_ST->shiptype) continue;
+            nsegments = (double) (paths[index].len - 1);
+            sum += nsegments;
+            sum_squared += nsegments * nsegments;
+        }
+        work += (sum * sum - sum_squared) / 2;
+    }
+
+    while (head_ST != NULL) {
+        curr_ST = head_ST;
+        head_ST = head_ST->next;
+        free(curr_ST);
+    }
+    return work;
+}
+
+
+/*
+    GRAPH COMPACTION
+*/
+
+void compact_graph(Node *nodes, Path *paths, unsigned long npaths, unsigned char *keep,
+                    Node **new_nodes_ptr, Path **new_paths_ptr,
+                    unsigned long *new_nnodes, unsigned long *new_nedges) {
+    // 1. Count the nodes to keep
+    unsigned long index, nnodes2store;
+    Path_node *curr_path_node;
+
+    nnodes2store = 0;
+    for (index = 0; index < npaths; index++) {
+        for (curr_path_node = &paths[index].start_node; curr_path_node != NULL; curr_path_node = curr_path_node->next) {
+            if (keep[curr_path_node->node_id] || curr_path_node == &paths[index].start_node) nnodes2store++;
+        }
+    }
+
+    Node *new_nodes;
+    Path *new_paths;
+    new_nodes = (Node *) malloc(nnodes2store * sizeof(Node));
+    new_paths = (Path *) malloc(npaths * sizeof(Path));
+    if (new_nodes == NULL) ExitError("when allocating memory for the compacted nodes", 1);
+    if (new_paths == NULL) ExitError("when allocating memory for the compacted paths", 2);
+
+    // 2. Copy the kept nodes path by path, accumulating the times of the removed ones
+    unsigned long new_id, prev_id, prev_new_id;
+    double accumulated_time;
+    Node *new_node;
+    Path *new_path;
+
+    *new_nnodes = 0;
+    *new_nedges = 0;
+    for (index = 0; index < npaths; index++) {
+        new_path = &new_paths[index];
+        prev_id = 0;
+        prev_new_id = 0;
+        accumulated_time = 0.;
+        for (curr_path_node = &paths[index].start_node; curr_path_node != NULL; curr_path_node = curr_path_node->next) {
+            if (curr_path_node != &paths[index].start_node) {
+                accumulated_time += edge_time(nodes, prev_id, curr_path_node->node_id);
+            }
+            prev_id = curr_path_node->node_id;
+            if (!keep[curr_path_node->node_id] && curr_path_node != &paths[index].start_node) continue;
+
+            // 2.1. Create the new node
+            new_id = *new_nnodes;
+            new_node = &new_nodes[new_id];
+            new_node->id = new_id;
+            new_node->lat = nodes[curr_path_node->node_id].lat;
+            new_node->lon = nodes[curr_path_node->node_id].lon;
+            new_node->speed = nodes[curr_path_node->node_id].speed;
+            new_node->nedges = 0;
+            new_node->max_edges = 0;
+            new_node->to_nodes = NULL;
+            new_node->to_times = NULL;
+            (*new_nnodes)++;
+
+            // 2.2. Start the path or connect the previous kept node to the new one
+            if (curr_path_node == &paths[index].start_node) {
+                new_path->start_node.node_id = new_id;
+                new_path->start_node.next = NULL;
+                new_path->final_node = &new_path->start_node;
+                new_path->shiptype = paths[index].shiptype;
+                new_path->id = paths[index].id;
+                new_path->min_lon = new_node->lon;
+                new_path->max_lon = new_node->lon;
+                new_path->min_lat = new_node->lat;
+                new_path->max_lat = new_node->lat;
+                new_path->npaths = 0;
+                new_path->max_paths = 0;
+                new_path->to_paths = NULL;
+                new_path->len = 1;
+            } else {
+                new_nodes[prev_new_id].nedges = 1;
+                new_nodes[prev_new_id].max_edges = 1;
+                new_nodes[prev_new_id].to_nodes = (unsigned long *) malloc(sizeof(unsigned long));
+                new_nodes[prev_new_id].to_times = (double *) malloc(sizeof(double));
+                if (new_nodes[prev_new_id].to_nodes == NULL) ExitError("when allocating memory for to_nodes", 3);
+                if (new_nodes[prev_new_id].to_times == NULL) ExitError("when allocating memory for to_times", 4);
+                new_nodes[prev_new_id].to_nodes[0] = new_id;
+                new_nodes[prev_new_id].to_times[0] = accumulated_time;
+                (*new_nedges)++;
+
+                update_path_coordinates(new_path, new_node);
+                add_path_node(new_path, new_id);
+                new_path->len++;
+            }
+            prev_new_id = new_id;
+            accumulated_time = 0.;
+        }
+    }
+
+    *new_nodes_ptr = new_nodes;
+    *new_paths_ptr = new_paths;
+    return;
+}
@@ -0,0 +1,41 @@
+#ifndef SIMPLIFICATION_H
+#define SIMPLIFICATION_H
+
+/*
+    PATHS SIMPLIFICATION
+*/
+
+/*
+ * Marks in keep the nodes of the path that survive a time-aware Douglas-Peucker simplification.
+ * A node is removed if its distance to the position interpolated in time between the kept neighbours
+ * is lower than tolerance_km and the merged edge does not last more than max_edge_time seconds (0 to disable).
+ * Returns the number of nodes kept.
+*/
+unsigned long simplify_path(Node *nodes, Path *path, double tolerance_km, double max_edge_time, unsigned char *keep);
+
+/*
+ * Marks in keep the nodes of the path that survive the compression of its stationary episodes.
+ * An episode is a sequence of nodes that stay within radius_km of its first node during, at least, min_dwell seconds.
+ * Every episode is collapsed into a single node placed at its centroid, so the dwell time is added to its adjacent edge.
+ * Returns the number of episodes found.
+*/
+unsigned long compress_stops(Node *nodes, Path *path, double radius_km, double min_dwell, unsigned char *keep);
+
+// Returns an estimation of the number of edge pairs to test in the intersections stage, assuming all the paths of the same shiptype overlap.
+double segment_pairs_work(Path *paths, unsigned long npaths);
+
+
+/*
+    GRAPH COMPACTION
+*/
+
+/*
+ * Creates a new graph with only the nodes marked in keep. The removed nodes of every path are skipped and
+ * their travelling times are added to the new edge, so the cost of the paths is preserved.
+ * The new ids are assigned by order of appearance of the paths. Only applicable for not crossed paths graphs.
+*/
+void compact_graph(Node *nodes, Path *paths, unsigned long npaths, unsigned char *keep,
+                    Node **new_nodes_ptr, Path **new_paths_ptr,
+                    unsigned long *new_nnodes, unsigned long *new_nedges);
+
+#endif
@@ -0,0 +1,604 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$    SWEEP_LINE.C VERSION 1.0    $$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "sweep_line.h"
+
+    - Comments:
+        >> Bentley-Ottmann algorithm: a vertical line sweeps the plane from west to east, stopping at the endpoints
+            of the edges and at their crossings. Only the edges that are adjacent on the sweep line can cross,
+            so every edge is compared with its neighbours only.
+        >> The active edges are stored in a treap. A crossing reorders at once the bundle of edges that pass through its point,
+            within SWEEP_EPSILON, sorting them by slope in their treap nodes, so there is no need to compare their positions,
+            which are ambiguous at the crossing. Thus, the edges that share an endpoint or cross at the same point keep their order.
+        >> The edges that pass through an endpoint, or end there, are tested with the edge of the endpoint, so the edges that
+            touch or overlap are found too. Only the pairs that may be computed are tested there, as the proper crossings
+            are found between neighbours anyway.
+        >> Every pair of edges that intersects is reported once at most with its intersection type, thanks to a hash set of pairs,
+            so the pairs are the same as comparing all of them. The pairs that do not intersect are not stored, and neither are
+            the ones that touch and are not computed, so the pieces of the paths already intersected do not fill the hash set.
+        >> The vertical edges are kept out of the treap, as their position along the sweep line goes from their start to their end
+            with no crossing to reorder them. They are tested at once with the edges that cut the sweep line along them, and
+            with the edges that start on them later.
+        >> Each shiptype is swept separately, as the edges of different shiptypes can not intersect.
+
+    - Further development:
+        >> Sweep the shiptypes in parallel, as they are independent.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "graph_management.h"
+#include "sweep_line.h"
+#include "intersections.h"
+
+/*
+    EVENTS MANAGEMENT
+*/
+
+int compare_events(Sweep_event *a, Sweep_event *b) {
+    if (a->x != b->x) return a->x < b->x ? -1 : 1;
+    if (a->y != b->y) return a->y < b->y ? -1 : 1;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    if (a->b != b->b) return a->b < b->b ? -1 : 1;
+    return 0;
+}
+
+void push_event(Sweep_state *state, Sweep_event *event) {
+    unsigned long index, parent;
+    Sweep_event aux;
+
+    if (state->nevents == state->max_events) {
+        state->max_events = state->max_events ? 2 * state->max_events : 1024;
+        state->events = (Sweep_event *) realloc(state->events, state->max_events * sizeof(Sweep_event));
+        if (state->events == NULL) ExitError("when reallocating memory for the sweep line events", 1);
+    }
+    index = state->nevents++;
+    state->events[index] = *event;
+    while (index > 0) {
+        parent = (index - 1) / 2;
+        if (compare_events(&state->events[parent], &state->events[index]) <= 0) break;
+        aux = state->events[parent];
+        state->events[parent] = state->events[index];
+        state->events[index] = aux;
+        index = parent;
+    }
+}
+
+void pop_event(Sweep_state *state, Sweep_event *event) {
+    unsigned long index, child;
+    Sweep_event aux;
+
+    *event = state->events[0];
+    state->nevents--;
+    state->events[0] = state->events[state->nevents];
+    index = 0;
+    while (2 * index + 1 < state->nevents) {
+        child = 2 * index + 1;
+        if (child + 1 < state->nevents && compare_events(&state->events[child + 1], &state->events[child]) < 0) child++;
+        if (compare_events(&state->events[index], &state->events[child]) <= 0) break;
+        aux = state->events[child];
+        state->events[child] = state->events[index];
+        state->events[index] = aux;
+        index = child;
+    }
+}
+
+
+/*
+    STATUS MANAGEMENT
+*/
+
+double sweep_y(Sweep_segment *segment, double x, double y) {
+    if (segment->x1 == segment->x2) {
+        if (y < segment->y1) return segment->y1;
+        if (y > segment->y2) return segment->y2;
+        return y;
+    }
+    if (x <= segment->x1) return segment->y1;
+    if (x >= segment->x2) return segment->y2;
+    return segment->y1 + (x - segment->x1) * (segment->y2 - segment->y1) / (segment->x2 - segment->x1);
+}
+
+double sweep_slope(Sweep_segment *segment) {
+    if (segment->x1 == segment->x2) return INFINITY;
+    return (segment->y2 - segment->y1) / (segment->x2 - segment->x1);
+}
+
+unsigned short sweep_through(Sweep_state *state, unsigned long seg) {
+    // The latitude at the sweep line is compared, as it sorts the treap, so the segments that pass through are consecutive
+    return fabs(sweep_y(&state->segments[seg], state->x, state->y) - state->y) <= SWEEP_EPSILON;
+}
+
+int compare_status(Sweep_state *state, unsigned long s, unsigned long r) {
+    Sweep_segment *seg_s = &state->segments[s];
+    Sweep_segment *seg_r = &state->segments[r];
+    double y_s, y_r, slope_s, slope_r;
+
+    // 1. Compare the latitudes at the sweep line, unless both pass through the current point, as in sweep_through
+    y_s = sweep_y(seg_s, state->x, state->y);
+    y_r = sweep_y(seg_r, state->x, state->y);
+    if (y_s != y_r && (fabs(y_s - state->y) > SWEEP_EPSILON || fabs(y_r - state->y) > SWEEP_EPSILON)) return y_s < y_r ? -1 : 1;
+
+    // 2. If they meet at the sweep line, compare the slopes, as it is the order just after it
+    slope_s = sweep_slope(seg_s);
+    slope_r = sweep_slope(seg_r);
+    if (slope_s != slope_r) return slope_s < slope_r ? -1 : 1;
+    if (s != r) return s < r ? -1 : 1;
+    return 0;
+}
+
+void rotate_up(Sweep_state *state, Sweep_node *node) {
+    Sweep_node *parent, *grandparent;
+    parent = node->parent;
+    grandparent = parent->parent;
+    if (parent->left == node) {
+        parent->left = node->right;
+        if (node->right != NULL) node->right->parent = parent;
+        node->right = parent;
+    } else {
+        parent->right = node->left;
+        if (node->left != NULL) node->left->parent = parent;
+        node->left = parent;
+    }
+    parent->parent = node;
+    node->parent = grandparent;
+    if (grandparent == NULL) state->root = node;
+    else if (grandparent->left == parent) grandparent->left = node;
+    else grandparent->right = node;
+}
+
+void insert_segment(Sweep_state *state, unsigned long seg) {
+    Sweep_node *node, *curr;
+
+    node = &state->tree_nodes[seg];
+    node->seg = seg;
+    node->left = NULL;
+    node->right = NULL;
+    node->parent = NULL;
+    state->handle[seg] = node;
+
+    // 1. Descend as in a binary search tree
+    if (state->root == NULL) {
+        state->root = node;
+        return;
+    }
+    curr = state->root;
+    while (1) {
+        if (compare_status(state, seg, curr->seg) < 0) {
+            if (curr->left == NULL) { curr->left = node; break; }
+            curr = curr->left;
+        } else {
+            if (curr->right == NULL) { curr->right = node; break; }
+            curr = curr->right;
+        }
+    }
+    node->parent = curr;
+
+    // 2. Restore the heap property of the priorities
+    while (node->parent != NULL && node->parent->priority < node->priority) rotate_up(state, node);
+}
+
+void remove_segment(Sweep_state *state, unsigned long seg) {
+    Sweep_node *node, *child;
+
+    // 1. Move the node down until it is a leaf
+    node = state->handle[seg];
+    while (node->left != NULL || node->right != NULL) {
+        if (node->left == NULL) child = node->right;
+        else if (node->right == NULL) child = node->left;
+        else child = node->left->priority > node->right->priority ? node->left : node->right;
+        rotate_up(state, child);
+    }
+
+    // 2. Detach it
+    if (node->parent == NULL) state->root = NULL;
+    else if (node->parent->left == node) node->parent->left = NULL;
+    else node->parent->right = NULL;
+    node->parent = NULL;
+    state->handle[seg] = NULL;
+}
+
+Sweep_node *prev_node(Sweep_node *node) {
+    if (node->left != NULL) {
+        node = node->left;
+        while (node->right != NULL) node = node->right;
+        return node;
+    }
+    while (node->parent != NULL && node->parent->left == node) node = node->parent;
+    return node->parent;
+}
+
+Sweep_node *next_node(Sweep_node *node) {
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL) node = node->left;
+        return node;
+    }
+    while (node->parent != NULL && node->parent->right == node) node = node->parent;
+    return node->parent;
+}
+
+Sweep_node *lower_node(Sweep_state *state, double y) {
+    Sweep_node *node, *lower;
+    lower = NULL;
+    for (node = state->root; node != NULL; ) {
+        if (sweep_y(&state->segments[node->seg], state->x, state->y) >= y - SWEEP_EPSILON) {
+            lower = node;
+            node = node->left;
+        } else node = node->right;
+    }
+    return lower;
+}
+
+unsigned short computed_pair(Sweep_state *state, unsigned long a, unsigned long b) {
+    unsigned long path_1, path_2;
+    path_1 = state->segments[a].path < state->segments[b].path ? state->segments[a].path : state->segments[b].path;
+    path_2 = state->segments[a].path < state->segments[b].path ? state->segments[b].path : state->segments[a].path;
+    if (path_1 == path_2) return 0;
+    return state->pending == NULL || ((state->pending[path_1] & PENDING_PATH_1) && (state->pending[path_2] & PENDING_PATH_2));
+}
+
+void check_pair(Sweep_state *state, Node *nodes, unsigned long a, unsigned long b) {
+    Sweep_segment *seg_1, *seg_2;
+    unsigned long key_a, key_b, hash, index, old_size, *old_pairs;
+    unsigned short intersection_type, computed;
+    double t, u;
+    Sweep_event event;
+    Crossing *crossing;
+
+    if (a == b) return;
+
+    // 1. Identify the intersection with the edge of the lower path first, as the rest of engines
+    seg_1 = &state->segments[a];
+    seg_2 = &state->segments[b];
+    if (seg_2->path < seg_1->path || (seg_2->path == seg_1->path && seg_2->seg < seg_1->seg)) {
+        seg_1 = &state->segments[b];
+        seg_2 = &state->segments[a];
+    }
+    intersection_type = identify_intersection(&nodes[seg_1->p_id], &nodes[seg_1->q_id], &nodes[seg_2->p_id], &nodes[seg_2->q_id], &t, &u);
+    if (intersection_type == 0) return;
+    computed = computed_pair(state, a, b);
+    if (computed == 0 && intersection_type != 1) return;
+
+    // 2. Check the pair has not been tested before
+    if (2 * (state->npairs + 1) > state->pairs_size) {
+        old_size = state->pairs_size;
+        old_pairs = state->pairs;
+        state->pairs_size = old_size ? 2 * old_size : 1024;
+        state->pairs = (unsigned long *) malloc(2 * state->pairs_size * sizeof(unsigned long));
+        if (state->pairs == NULL) ExitError("when allocating memory for the sweep line pairs", 1);
+        for (index = 0; index < state->pairs_size; index++) state->pairs[2 * index] = ULONG_MAX;
+        for (index = 0; index < old_size; index++) {
+            if (old_pairs[2 * index] == ULONG_MAX) continue;
+            hash = (old_pairs[2 * index] * 0x9E3779B97F4A7C15UL ^ old_pairs[2 * index + 1] * 0xC2B2AE3D27D4EB4FUL) & (state->pairs_size - 1);
+            while (state->pairs[2 * hash] != ULONG_MAX) hash = (hash + 1) & (state->pairs_size - 1);
+            state->pairs[2 * hash] = old_pairs[2 * index];
+            state->pairs[2 * hash + 1] = old_pairs[2 * index + 1];
+        }
+        free(old_pairs);
+    }
+    key_a = a < b ? a : b;
+    key_b = a < b ? b : a;
+    hash = (key_a * 0x9E3779B97F4A7C15UL ^ key_b * 0xC2B2AE3D27D4EB4FUL) & (state->pairs_size - 1);
+    while (state->pairs[2 * hash] != ULONG_MAX) {
+        if (state->pairs[2 * hash] == key_a && state->pairs[2 * hash + 1] == key_b) return;
+        hash = (hash + 1) & (state->pairs_size - 1);
+    }
+    state->pairs[2 * hash] = key_a;
+    state->pairs[2 * hash + 1] = key_b;
+    state->npairs++;
+
+    // 3. Report it if the pair may be computed
+    if (computed) {
+        if (state->ncrossings == state->max_crossings) {
+            state->max_crossings = state->max_crossings ? 2 * state->max_crossings : 1024;
+            state->crossings = (Crossing *) realloc(state->crossings, state->max_crossings * sizeof(Crossing));
+            if (state->crossings == NULL) ExitError("when reallocating memory for the crossings", 2);
+        }
+        crossing = &state->crossings[state->ncrossings++];
+        crossing->path_1 = seg_1->path;
+        crossing->seg_1 = seg_1->seg;
+        crossing->path_2 = seg_2->path;
+        crossing->seg_2 = seg_2->seg;
+        crossing->type = intersection_type;
+    }
+
+    // 4. Schedule the crossing to reorder the segments, never behind the sweep line. A crossing behind it is dropped if a is
+    // already below b at the sweep line, as it is the rounding of a shared endpoint, or a crossing already past.
+    if (intersection_type != 1) return;
+    event.x = nodes[seg_1->p_id].lon + t * (nodes[seg_1->q_id].lon - nodes[seg_1->p_id].lon);
+    event.y = nodes[seg_1->p_id].lat + t * (nodes[seg_1->q_id].lat - nodes[seg_1->p_id].lat);
+    if (event.x < state->x || (event.x == state->x && event.y < state->y)) {
+        if (sweep_y(&state->segments[b], state->x, state->y) - sweep_y(&state->segments[a], state->x, state->y) > SWEEP_EPSILON) return;
+        event.x = state->x;
+        event.y = state->y;
+    }
+    event.kind = Segment_crossing;
+    event.a = a;
+    event.b = b;
+    push_event(state, &event);
+}
+
+void check_crossing(Sweep_state *state, Node *nodes, Sweep_node *node_a, Sweep_node *node_b) {
+    if (node_a == NULL || node_b == NULL) return;
+    check_pair(state, nodes, node_a->seg, node_b->seg);
+}
+
+void check_through(Sweep_state *state, Node *nodes, Sweep_node *node) {
+    Sweep_node *other;
+    for (other = prev_node(node); other != NULL && sweep_through(state, other->seg); other = prev_node(other))
+        if (computed_pair(state, other->seg, node->seg)) check_pair(state, nodes, other->seg, node->seg);
+    for (other = next_node(node); other != NULL && sweep_through(state, other->seg); other = next_node(other))
+        if (computed_pair(state, node->seg, other->seg)) check_pair(state, nodes, node->seg, other->seg);
+}
+
+void check_vertical(Sweep_state *state, Node *nodes, unsigned long seg) {
+    Sweep_segment *segment, *vertical;
+    Sweep_node *node;
+    unsigned long index;
+
+    // 1. Test the segments of the treap that cut the sweep line along the vertical segment, including the ones that end on it
+    segment = &state->segments[seg];
+    for (node = lower_node(state, segment->y1); node != NULL; node = next_node(node)) {
+        if (sweep_y(&state->segments[node->seg], state->x, state->y) > segment->y2 + SWEEP_EPSILON) break;
+        if (computed_pair(state, node->seg, seg)) check_pair(state, nodes, node->seg, seg);
+    }
+
+    // 2. Test the vertical segments that overlap it, which start below, and store it
+    for (index = state->first_vertical; index < state->nverticals; index++) {
+        vertical = &state->segments[state->verticals[index]];
+        if (vertical->y2 >= segment->y1 - SWEEP_EPSILON && computed_pair(state, state->verticals[index], seg))
+            check_pair(state, nodes, state->verticals[index], seg);
+    }
+    state->verticals[state->nverticals++] = seg;
+}
+
+void reorder_bundle(Sweep_state *state, Node *nodes, Sweep_node *node_a, Sweep_node *node_b) {
+    // 1. Find the run of segments around a that pass through the current point
+    Sweep_node *first, *last, *node;
+    unsigned long nrun, index, moved, seg;
+    unsigned short found;
+
+    first = node_a;
+    while (prev_node(first) != NULL && sweep_through(state, prev_node(first)->seg)) first = prev_node(first);
+    last = node_a;
+    while (next_node(last) != NULL && sweep_through(state, next_node(last)->seg)) last = next_node(last);
+    nrun = 0;
+    found = 0;
+    for (node = first; ; node = next_node(node)) {
+        if (node == node_b) found = 1;
+        state->run_nodes[nrun] = node;
+        state->run[nrun++] = node->seg;
+        if (node == last) break;
+    }
+    state->nbundles++;
+    if (found == 0) {
+        if (next_node(node_a) != node_b) return;
+        seg = node_a->seg;
+        node_a->seg = node_b->seg;
+        node_b->seg = seg;
+        state->handle[node_a->seg] = node_a;
+        state->handle[node_b->seg] = node_b;
+        check_crossing(state, nodes, prev_node(node_a), node_a);
+        check_crossing(state, nodes, node_b, next_node(node_b));
+        return;
+    }
+
+    // 2. Sort the run by slope, which is the order just after the point. Every segment is tested with the ones it passes.
+    for (index = 1; index < nrun; index++) {
+        seg = state->run[index];
+        for (moved = index; moved > 0 && sweep_slope(&state->segments[state->run[moved - 1]]) > sweep_slope(&state->segments[seg]); moved--) {
+            check_pair(state, nodes, state->run[moved - 1], seg);
+            state->run[moved] = state->run[moved - 1];
+        }
+        state->run[moved] = seg;
+    }
+
+    // 3. Store the new order in the treap and test the new neighbours
+    for (index = 0; index < nrun; index++) {
+        state->run_nodes[index]->seg = state->run[index];
+        state->handle[state->run[index]] = state->run_nodes[index];
+        state->bundle[state->run[index]] = state->nbundles;
+        if (index > 0) check_pair(state, nodes, state->run[index - 1], state->run[index]);
+    }
+    check_crossing(state, nodes, prev_node(first), first);
+    check_crossing(state, nodes, last, next_node(last));
+}
+
+
+/*
+    SWEEP LINE
+*/
+
+unsigned long sweep_crossings(Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending, Crossing **crossings_ptr) {
+    ST_counter *head_ST, *curr_ST;
+    Sweep_state state;
+    unsigned long i_path, seg, max_segments;
+    Path_node *curr_path_node;
+    Node *node_p, *node_q;
+    Sweep_segment *segment;
+
+    // 1. Initialize the state with enough memory for the largest shiptype
+    *crossings_ptr = NULL;
+    if (npaths == 0) return 0;
+
+    max_segments = 0;
+    for (i_path = 0; i_path < npaths; i_path++) if (pending == NULL || pending[i_path]) max_segments += paths[i_path].len - 1;
+    if (max_segments == 0) max_segments = 1;
+    memset(&state, 0, sizeof(Sweep_state));
+    state.pending = pending;
+    state.segments = (Sweep_segment *) malloc(max_segments * sizeof(Sweep_segment));
+    state.tree_nodes = (Sweep_node *) malloc(max_segments * sizeof(Sweep_node));
+    state.handle = (Sweep_node **) malloc(max_segments * sizeof(Sweep_node *));
+    state.run = (unsigned long *) malloc(max_segments * sizeof(unsigned long));
+    state.run_nodes = (Sweep_node **) malloc(max_segments * sizeof(Sweep_node *));
+    state.bundle = (unsigned long *) malloc(max_segments * sizeof(unsigned long));
+    state.ended = (unsigned long *) malloc(max_segments * sizeof(unsigned long));
+    state.verticals = (unsigned long *) malloc(max_segments * sizeof(unsigned long));
+    if (state.segments == NULL) ExitError("when allocating memory for the sweep line segments", 1);
+    if (state.tree_nodes == NULL || state.handle == NULL) ExitError("when allocating memory for the sweep line status", 2);
+    if (state.run == NULL || state.run_nodes == NULL || state.bundle == NULL || state.ended == NULL || state.verticals == NULL)
+        ExitError("when allocating memory for the sweep line bundles", 3);
+
+    // 2. Sweep the edges of every shiptype
+    head_ST = count_shiptypes(paths, npaths);
+    for (curr_ST = head_ST; curr_ST != NULL; curr_ST = curr_ST->next) {
+        state.nsegments = 0;
+        for (i_path = 0; i_path < npaths; i_path++) {
+            if (paths[i_path].shiptype != curr_ST->shiptype || (pending != NULL && pending[i_path] == 0)) continue;
+            seg = 0;
+            for (curr_path_node = &paths[i_path].start_node; curr_path_node->next != NULL; curr_path_node = curr_path_node->next) {
+                node_p = &nodes[curr_path_node->node_id];
+                node_q = &nodes[curr_path_node->next->node_id];
+                segment = &state.segments[state.nsegments];
+                segment->p_id = node_p->id;
+                segment->q_id = node_q->id;
+                segment->path = i_path;
+                segment->seg = seg++;
+                if (node_p->lon < node_q->lon || (node_p->lon == node_q->lon && node_p->lat < node_q->lat)) {
+                    segment->x1 = node_p->lon; segment->y1 = node_p->lat;
+                    segment->x2 = node_q->lon; segment->y2 = node_q->lat;
+                } else {
+                    segment->x1 = node_q->lon; segment->y1 = node_q->lat;
+                    segment->x2 = node_p->lon; segment->y2 = node_p->lat;
+                }
+                if (segment->x1 == segment->x2 && segment->y1 == segment->y2) continue; // Degenerated edge
+                state.nsegments++;
+            }
+        }
+        sweep_segments(&state, nodes);
+    }
+
+    // 3. Free allocated memory
+    while (head_ST != NULL) {
+        curr_ST = head_ST;
+        head_ST = head_ST->next;
+        free(curr_ST);
+    }
+    free(state.segments);
+    free(state.tree_nodes);
+    free(state.handle);
+    free(state.run);
+    free(state.run_nodes);
+    free(state.bundle);
+    free(state.ended);
+    free(state.verticals);
+    free(state.events);
+    free(state.pairs);
+    *crossings_ptr = state.crossings;
+    return state.ncrossings;
+}
+
+void sweep_segments(Sweep_state *state, Node *nodes) {
+    unsigned long seg, index, random_state;
+    Sweep_event event;
+    Sweep_node *node_a, *node_b, *below, *above;
+
+    // 1. Initialize the events with the endpoints of the segments and empty the status, the pairs, the ended and the vertical segments
+    state->nevents = 0;
+    state->root = NULL;
+    state->npairs = 0;
+    state->nbundles = 0;
+    state->first_ended = 0;
+    state->nended = 0;
+    state->first_vertical = 0;
+    state->nverticals = 0;
+    for (index = 0; index < state->pairs_size; index++) state->pairs[2 * index] = ULONG_MAX;
+    random_state = 88172645463325252UL;
+    for (seg = 0; seg < state->nsegments; seg++) {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        state->tree_nodes[seg].priority = random_state;
+        state->handle[seg] = NULL;
+        state->bundle[seg] = 0;
+
+        event.a = seg;
+        event.b = 0;
+        event.kind = Segment_start;
+        event.x = state->segments[seg].x1;
+        event.y = state->segments[seg].y1;
+        push_event(state, &event);
+        event.kind = Segment_end;
+        event.x = state->segments[seg].x2;
+        event.y = state->segments[seg].y2;
+        push_event(state, &event);
+    }
+
+    // 2. Process the events
+    while (state->nevents > 0) {
+        pop_event(state, &event);
+        state->x = event.x;
+        state->y = event.y;
+        while (state->first_ended < state->nended &&
+                state->segments[state->ended[state->first_ended]].x2 < state->x - SWEEP_EPSILON) state->first_ended++;
+        while (state->first_vertical < state->nverticals &&
+                state->segments[state->verticals[state->first_vertical]].x1 < state->x - SWEEP_EPSILON) state->first_vertical++;
+
+        if (event.kind == Segment_start && state->segments[event.a].x1 == state->segments[event.a].x2) {
+            // 2.1. Test a vertical segment with the ones that end at its start and the ones that cut it, out of the treap
+            for (index = state->first_ended; index < state->nended; index++)
+                if (computed_pair(state, state->ended[index], event.a) && sweep_through(state, state->ended[index]))
+                    check_pair(state, nodes, state->ended[index], event.a);
+            check_vertical(state, nodes, event.a);
+        } else if (event.kind == Segment_start) {
+            // 2.2. Test the segment with the ones that pass through its start, including the ones that end there and the vertical ones
+            insert_segment(state, event.a);
+            state->nbundles++;
+            node_a = state->handle[event.a];
+            check_through(state, nodes, node_a);
+            for (index = state->first_ended; index < state->nended; index++)
+                if (computed_pair(state, state->ended[index], event.a) && sweep_through(state, state->ended[index]))
+                    check_pair(state, nodes, state->ended[index], event.a);
+            for (index = state->first_vertical; index < state->nverticals; index++)
+                if (computed_pair(state, state->verticals[index], event.a) && sweep_through(state, state->verticals[index]))
+                    check_pair(state, nodes, state->verticals[index], event.a);
+
+            // Sort the bundle at its start by slope, as the segments that only touch there kept their order, and test the neighbours
+            reorder_bundle(state, nodes, node_a, node_a);
+        } else if (event.kind == Segment_end) {
+            // 2.3. Test the segment with the ones that pass through its end before removing it. The vertical ones are not in the treap.
+            node_a = state->handle[event.a];
+            if (node_a == NULL) continue;
+            check_through(state, nodes, node_a);
+            below = prev_node(node_a);
+            above = next_node(node_a);
+            remove_segment(state, event.a);
+            state->nbundles++;
+            state->ended[state->nended++] = event.a;
+            check_crossing(state, nodes, below, above);
+        } else {
+            // 2.4. Reorder all the segments that pass through the crossing, unless the last bundle already did it
+            node_a = state->handle[event.a];
+            node_b = state->handle[event.b];
+            if (node_a == NULL || node_b == NULL) continue;
+            if (state->bundle[event.a] == state->nbundles && state->bundle[event.b] == state->nbundles) continue;
+            reorder_bundle(state, nodes, node_a, node_b);
+        }
+    }
+}
+
+int compare_crossings(const void *a, const void *b) {
+    const Crossing *crossing_a = (const Crossing *) a;
+    const Crossing *crossing_b = (const Crossing *) b;
+    if (crossing_a->path_1 != crossing_b->path_1) return crossing_a->path_1 < crossing_b->path_1 ? -1 : 1;
+    if (crossing_a->path_2 != crossing_b->path_2) return crossing_a->path_2 < crossing_b->path_2 ? -1 : 1;
+    if (crossing_a->seg_1 != crossing_b->seg_1) return crossing_a->seg_1 < crossing_b->seg_1 ? -1 : 1;
+    if (crossing_a->seg_2 != crossing_b->seg_2) return crossing_a->seg_2 < crossing_b->seg_2 ? -1 : 1;
+    return 0;
+}
@@ -0,0 +1,184 @@
+#ifndef SWEEP_LINE_H
+#define SWEEP_LINE_H
+
+/*
+    CONSTANTS
+*/
+// Distance in degrees under which a segment is taken to pass through the point of an event, to absorb the rounding of the crossings
+#define SWEEP_EPSILON 1e-9
+
+/*
+    ENUMERATIONS
+*/
+// This enumeration the kinds of events. At the same point, they are processed in this order.
+enum Sweep_event_kind {Segment_end, Segment_crossing, Segment_start};
+
+/*
+    STRUCTURES TO MANAGE THE SWEEP LINE
+*/
+/*
+ * Stores a pair of intersecting edges of different paths, path_1 < path_2. seg is the position of the edge in its path
+ * and type the intersection type of the pair: 1 for a crossing, 2 to 17 when they touch or overlap.
+*/
+typedef struct {
+    unsigned long path_1, seg_1;
+    unsigned long path_2, seg_2;
+    unsigned short type;
+} Crossing;
+
+// Stores an edge of the graph with its left (x1, y1) and right (x2, y2) endpoints, being x the longitude and y the latitude
+typedef struct {
+    double x1, y1, x2, y2;
+    unsigned long p_id, q_id;
+    unsigned long path, seg;
+} Sweep_segment;
+
+// Stores an event of the sweep line. Crossings involve segments a and b, being a below b before the crossing.
+typedef struct {
+    double x, y;
+    int kind;
+    unsigned long a, b;
+} Sweep_event;
+
+// Stores a node of the treap with the segments that cut the sweep line, sorted from bottom to top
+typedef struct sweep_node {
+    unsigned long seg;
+    unsigned long priority;
+    struct sweep_node *left, *right, *parent;
+} Sweep_node;
+
+/*
+ * Stores the state of the sweep line: the segments, the priority queue of events (binary heap),
+ * the treap of active segments, the hash set of pairs of segments already tested and the crossings found.
+ * handle[seg] points to the treap node that stores seg, so crossing segments are reordered in place.
+ * run and run_nodes store the segments of a bundle and their treap nodes, and bundle[seg] the last bundle seg was sorted in.
+ * nbundles grows with every bundle and every change of the treap, so a bundle is only valid until the next one.
+ * ended stores the segments in order of their end, and the ones from first_ended end near the current point.
+ * verticals stores the vertical segments in order of their start, as they are not in the treap, and the ones from
+ * first_vertical are at the current longitude. pending marks the paths with some pair to compute, or is NULL if every pair is computed.
+*/
+typedef struct {
+    Sweep_segment *segments;
+    unsigned long nsegments;
+    Sweep_event *events;
+    unsigned long nevents, max_events;
+    Sweep_node *tree_nodes;
+    Sweep_node **handle;
+    Sweep_node *root;
+    double x, y;
+    unsigned long *pairs;
+    unsigned long pairs_size, npairs;
+    Crossing *crossings;
+    unsigned long ncrossings, max_crossings;
+    unsigned long *run;
+    Sweep_node **run_nodes;
+    unsigned long *bundle;
+    unsigned long nbundles;
+    unsigned long *ended;
+    unsigned long first_ended, nended;
+    unsigned long *verticals;
+    unsigned long first_vertical, nverticals;
+    unsigned char *pending;
+} Sweep_state;
+
+/*
+    EVENTS MANAGEMENT
+*/
+// Compares two events by point, kind and segments. Returns a negative value if a goes first.
+int compare_events(Sweep_event *a, Sweep_event *b);
+
+// Adds an event to the binary heap
+void push_event(Sweep_state *state, Sweep_event *event);
+
+// Removes the first event from the binary heap and stores it in event
+void pop_event(Sweep_state *state, Sweep_event *event);
+
+/*
+    STATUS MANAGEMENT
+*/
+// Returns the latitude of the segment at the longitude x. Vertical segments return y clamped to their range.
+double sweep_y(Sweep_segment *segment, double x, double y);
+
+// Returns the slope of the segment, INFINITY if it is vertical
+double sweep_slope(Sweep_segment *segment);
+
+// Returns 1 if the segment passes within SWEEP_EPSILON of the current point at the sweep line, and 0 otherwise
+unsigned short sweep_through(Sweep_state *state, unsigned long seg);
+
+/*
+ * Compares the position of segments s and r just after the current point. Returns a negative value if s is below r.
+ * Two segments that pass through the current point, within SWEEP_EPSILON, are compared by slope, as a segment may start
+ * on another one whose latitude there is rounded.
+*/
+int compare_status(Sweep_state *state, unsigned long s, unsigned long r);
+
+// Rotates the treap node above its parent
+void rotate_up(Sweep_state *state, Sweep_node *node);
+
+// Inserts the segment in the treap at its position at the current point
+void insert_segment(Sweep_state *state, unsigned long seg);
+
+// Removes the segment from the treap
+void remove_segment(Sweep_state *state, unsigned long seg);
+
+// Returns the treap node below (prev) or above (next) the node, or NULL if there is not
+Sweep_node *prev_node(Sweep_node *node);
+Sweep_node *next_node(Sweep_node *node);
+
+// Returns the lowest treap node whose segment is at the latitude y or above at the sweep line, within SWEEP_EPSILON, or NULL if there is not
+Sweep_node *lower_node(Sweep_state *state, double y);
+
+// Returns 1 if the segments belong to different paths, the lower one pending as path 1 and the upper one as path 2, and 0 otherwise
+unsigned short computed_pair(Sweep_state *state, unsigned long a, unsigned long b);
+
+/*
+ * Tests segments a (below) and b (above). If they intersect, belong to different paths and the lower path is pending as path 1
+ * and the upper one as path 2, the pair is appended to the crossings with its intersection type, identified with the edge of the
+ * lower path first, unless it was tested before. The rest of pairs are only stored in the hash set if they cross properly.
+ * If they cross properly, the crossing is scheduled to reorder them. A crossing that, due to rounding, is behind the current
+ * point is scheduled at the current point, unless a is already below b there.
+*/
+void check_pair(Sweep_state *state, Node *nodes, unsigned long a, unsigned long b);
+
+// Tests the segments of the treap nodes a (below) and b (above), if both exist
+void check_crossing(Sweep_state *state, Node *nodes, Sweep_node *node_a, Sweep_node *node_b);
+
+// Tests the segment of the treap node with every segment next to it that passes through the current point, if the pair is computed
+void check_through(Sweep_state *state, Node *nodes, Sweep_node *node);
+
+/*
+ * Tests the vertical segment with the segments of the treap that cut the sweep line along it and with the vertical segments
+ * at the current longitude that overlap it, if the pair is computed. It is stored in the verticals instead of the treap,
+ * as its position along the sweep line changes from its start to its end without any crossing to reorder it.
+*/
+void check_vertical(Sweep_state *state, Node *nodes, unsigned long seg);
+
+/*
+ * Reorders at once the bundle of segments around node_a that pass through the current point, a crossing of a (below) and b
+ * or the start of a if node_b is node_a, sorting them by slope, which is their order just after it. Every pair of segments
+ * whose order changes is tested, and so are the new neighbours.
+ * If b is not in the bundle, due to rounding, a and b are only swapped if they are adjacent.
+*/
+void reorder_bundle(Sweep_state *state, Node *nodes, Sweep_node *node_a, Sweep_node *node_b);
+
+/*
+    SWEEP LINE
+*/
+
+/*
+ * Finds all the pairs of edges of different paths and the same shiptype that intersect, with their intersection type
+ * (1 for a crossing, 2 to 17 when they touch or overlap), with a Bentley-Ottmann sweep line, in O((n + k) log n)
+ * for n edges and k intersections. The edges are read from the path nodes, so the paths must hold only their original edges.
+ * Only the edges of the pending paths are swept, and only their pairs that may be computed are reported, unless pending is NULL,
+ * so the paths with no pair to compute cost nothing and the touching pieces of the paths already intersected are not stored.
+ * The crossings are stored in *crossings_ptr, unsorted. Returns the number of crossings.
+*/
+unsigned long sweep_crossings(Node *nodes, Path *paths, unsigned long npaths, unsigned char *pending, Crossing **crossings_ptr);
+
+// Runs the sweep line over the segments of the state, appending the crossings found to the ones of the state
+void sweep_segments(Sweep_state *state, Node *nodes);
+
+// Compares two crossings by path_1, path_2, seg_1 and seg_2. Used to sort them with qsort.
+int compare_crossings(const void *a, const void *b);
+
+#endif
@@ -0,0 +1,876 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$    TILES.C VERSION 1.0    $$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Usage:
+        >> Through the header file "tiles.h"
+
+    - Comments:
+        >> The graph is never read at once. The sections of the binary file are located first, and then they are read
+            sequentially, node by node and path by path, with a file pointer per section.
+        >> The original edges are distributed into square tiles stored consecutively in a temporary file, in two passes:
+            the first one counts the edges of every tile and the second one writes them to their position through a buffer per tile.
+            The tiles are as big as possible while the most loaded one fits in the memory budget, and they are not refined
+            anymore once halving them does not reduce the edges of the most loaded one, as around a hotspot of edges.
+        >> An edge is stored in every tile touched by its bounding box, so the edges near the border of a tile are also
+            in the neighbour ones. A pair of edges is only computed in the tile of the lower corner of the intersection of their
+            bounding boxes, which is touched by both, so every crossing is found exactly once.
+        >> Every tile is computed with the segment kernel: the edges of every path in the tile are a run of the arrays with its own hierarchy.
+        >> The crossings are spliced as in splice_crossings, with the nodes numbered in the same order, so the resulting graph
+            is the same as with any engine. The original nodes whose edges change, where an edge is split or which are linked to
+            a coincident node, are read into memory and spliced there, and the rest of nodes are copied as they are.
+
+    - Further development:
+        >> Store the crossings in a file too, sorted by tile, and merge them when the graph is stored.
+        >> Split only the most loaded tiles instead of all of them.
+
+    - Status:
+        >> Finished.
+
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "graph_management.h"
+#include "sweep_line.h"
+#include "intersections.h"
+#include "segment_kernel.h"
+#include "tiles.h"
+
+/*
+    BINARY FILE READING
+*/
+
+void scan_bin_layout(char *bin_filename, Bin_layout *layout) {
+    // 1. Open the binary file and read the header
+    FILE *bin_file;
+    bin_file = fopen(bin_filename, "rb");
+    if (bin_file == NULL) ExitError("when opening the binary file", 1);
+
+    if (fread(&layout->nnodes, sizeof(unsigned long), 1, bin_file) +
+        fread(&layout->nedges, sizeof(unsigned long), 1, bin_file) +
+        fread(&layout->npaths, sizeof(unsigned long), 1, bin_file) != 3) {
+        ExitError("when reading the header of the binary data file", 2);
+    }
+    layout->nodes_offset = 3 * sizeof(unsigned long);
+
+    // 2. Read the nodes to count their edges and find their bounding box
+    unsigned long index, nedges;
+    Node node;
+
+    nedges = 0;
+    layout->min_lon = layout->min_lat = 0.;
+    layout->max_lon = layout->max_lat = 0.;
+    for (index = 0; index < layout->nnodes; index++) {
+        if (fread(&node, sizeof(Node), 1, bin_file) != 1) ExitError("when reading nodes from the input binary data file", 3);
+        nedges += node.nedges;
+        if (index == 0 || node.lon < layout->min_lon) layout->min_lon = node.lon;
+        if (index == 0 || node.lon > layout->max_lon) layout->max_lon = node.lon;
+        if (index == 0 || node.lat < layout->min_lat) layout->min_lat = node.lat;
+        if (index == 0 || node.lat > layout->max_lat) layout->max_lat = node.lat;
+    }
+    layout->to_nodes_offset = layout->nodes_offset + (long) (layout->nnodes * sizeof(Node));
+    layout->to_times_offset = layout->to_nodes_offset + (long) (nedges * sizeof(unsigned long));
+    layout->paths_offset = layout->to_times_offset + (long) (nedges * sizeof(double));
+
+    // 3. Read the paths to count their edges and skip the paths connections of the files stored with them
+    unsigned long nconnections;
+    Path path;
+
+    if (fseek(bin_file, layout->paths_offset, SEEK_SET) != 0) ExitError("when seeking the paths of the binary data file", 4);
+    layout->nsegments = 0;
+    nconnections = 0;
+    for (index = 0; index < layout->npaths; index++) {
+        if (fread(&path, sizeof(Path), 1, bin_file) != 1) ExitError("when reading paths from the input binary data file", 5);
+        if (path.len > 1) layout->nsegments += path.len - 1;
+        if (path.max_paths && path.npaths) nconnections += path.npaths;
+    }
+    layout->path_nodes_offset = layout->paths_offset + (long) (layout->npaths * sizeof(Path) + nconnections * sizeof(unsigned long));
+    fclose(bin_file);
+}
+
+void open_node_reader(Node_reader *reader, char *bin_filename, Bin_layout *layout) {
+    reader->file = fopen(bin_filename, "rb");
+    if (reader->file == NULL) ExitError("when opening the binary file to read the nodes", 1);
+    reader->nodes_offset = layout->nodes_offset;
+    if (fseek(reader->file, reader->nodes_offset, SEEK_SET) != 0) ExitError("when seeking the nodes of the binary data file", 2);
+    reader->next_id = 0;
+}
+
+void read_node_at(Node_reader *reader, unsigned long id, Node *node) {
+    if (id != reader->next_id && fseek(reader->file, reader->nodes_offset + (long) (id * sizeof(Node)), SEEK_SET) != 0) {
+        ExitError("when seeking a node of the binary data file", 1);
+    }
+    if (fread(node, sizeof(Node), 1, reader->file) != 1) ExitError("when reading a node from the binary data file", 2);
+    reader->next_id = id + 1;
+}
+
+/*
+    TILE GRID
+*/
+
+unsigned long tile_column(Tile_grid *grid, double lon) {
+    double column = floor((lon - grid->min_lon) / grid->tile_lon);
+    if (column < 0) return 0;
+    if (column >= (double) grid->ntiles_lon) return grid->ntiles_lon - 1;
+    return (unsigned long) column;
+}
+
+unsigned long tile_row(Tile_grid *grid, double lat) {
+    double row = floor((lat - grid->min_lat) / grid->tile_lat);
+    if (row < 0) return 0;
+    if (row >= (double) grid->ntiles_lat) return grid->ntiles_lat - 1;
+    return (unsigned long) row;
+}
+
+unsigned long tile_of(Tile_grid *grid, double lon, double lat) {
+    return tile_row(grid, lat) * grid->ntiles_lon + tile_column(grid, lon);
+}
+
+void set_tile_size(Tile_grid *grid, Bin_layout *layout, double tile_size) {
+    double width, height;
+
+    width = layout->max_lon - layout->min_lon;
+    height = layout->max_lat - layout->min_lat;
+    grid->min_lon = layout->min_lon;
+    grid->min_lat = layout->min_lat;
+    grid->ntiles_lon = width > 0 ? (unsigned long) ceil(width / tile_size) : 1;
+    grid->ntiles_lat = height > 0 ? (unsigned long) ceil(height / tile_size) : 1;
+    if (grid->ntiles_lon < 1) grid->ntiles_lon = 1;
+    if (grid->ntiles_lat < 1) grid->ntiles_lat = 1;
+    grid->tile_lon = width > 0 ? width / (double) grid->ntiles_lon : 1.;
+    grid->tile_lat = height > 0 ? height / (double) grid->ntiles_lat : 1.;
+    grid->ntiles = grid->ntiles_lon * grid->ntiles_lat;
+}
+
+void create_tile_grid(Tile_grid *grid, char *bin_filename, Bin_layout *layout, double memory_budget) {
+    // 1. Estimate the tiles needed if the edges were uniformly distributed
+    double width, height, tile_size;
+    unsigned long ntiles;
+    unsigned short refinement;
+
+    ntiles = (unsigned long) ceil((double) layout->nsegments * (double) TILE_SEGMENT_MEMORY / memory_budget);
+    if (ntiles < 1) ntiles = 1;
+    if (ntiles > TILE_MAX_TILES / 4) ntiles = TILE_MAX_TILES / 4;
+    width = layout->max_lon - layout->min_lon;
+    height = layout->max_lat - layout->min_lat;
+    if (width > 0 && height > 0) tile_size = sqrt(width * height / (double) ntiles);
+    else if (width > 0 || height > 0) tile_size = fmax(width, height) / (double) ntiles;
+    else tile_size = 1.;
+
+    // 2. Count the edges of every tile, halving the tiles while the most loaded one does not fit in the budget
+    unsigned long previous_max_count = 0;
+
+    grid->count = NULL;
+    grid->offset = NULL;
+    grid->file = NULL;
+    for (refinement = 0; ; refinement++) {
+        set_tile_size(grid, layout, tile_size);
+        grid->count = (unsigned long *) realloc(grid->count, grid->ntiles * sizeof(unsigned long));
+        if (grid->count == NULL) ExitError("when reallocating memory for the counters of the tiles", 1);
+        distribute_segments(grid, bin_filename, layout, 0);
+        printf("Tiles: %lu x %lu. Most loaded tile: %lu edges (%.2f MB)\n", grid->ntiles_lon, grid->ntiles_lat, grid->max_count,
+                (double) grid->max_count * (double) TILE_SEGMENT_MEMORY / (1024. * 1024.));
+        if ((double) grid->max_count * (double) TILE_SEGMENT_MEMORY <= memory_budget) break;
+
+        // A hotspot of edges through one point is never split, so the smaller tiles only add work once it is the most loaded
+        if (refinement > 0 && grid->max_count >= previous_max_count) {
+            printf("The most loaded tile is not split by smaller tiles, it is computed anyway\n");
+            set_tile_size(grid, layout, 2. * tile_size);
+            distribute_segments(grid, bin_filename, layout, 0);
+            break;
+        }
+        if (refinement == TILE_MAX_REFINEMENTS || 4 * grid->ntiles > TILE_MAX_TILES) {
+            printf("The most loaded tile does not fit in the memory budget, it is computed anyway\n");
+            break;
+        }
+        previous_max_count = grid->max_count;
+        tile_size = tile_size / 2.;
+    }
+
+    // 3. Store the edges of every tile consecutively in a temporary file
+    unsigned long tile, buffer_size;
+
+    grid->offset = (unsigned long *) malloc(grid->ntiles * sizeof(unsigned long));
+    if (grid->offset == NULL) ExitError("when allocating memory for the offsets of the tiles", 2);
+    grid->offset[0] = 0;
+    for (tile = 1; tile < grid->ntiles; tile++) grid->offset[tile] = grid->offset[tile - 1] + grid->count[tile - 1];
+
+    grid->file = tmpfile();
+    if (grid->file == NULL) ExitError("when creating the temporary file of the tiles", 3);
+    buffer_size = (unsigned long) (memory_budget / 2. / ((double) grid->ntiles * (double) sizeof(Tile_segment)));
+    if (buffer_size < 1) buffer_size = 1;
+    distribute_segments(grid, bin_filename, layout, buffer_size);
+}
+
+void distribute_segments(Tile_grid *grid, char *bin_filename, Bin_layout *layout, unsigned long buffer_size) {
+    // 1. Open the paths, their nodes and the nodes
+    FILE *paths_file, *path_nodes_file;
+    Node_reader reader;
+
+    paths_file = fopen(bin_filename, "rb");
+    path_nodes_file = fopen(bin_filename, "rb");
+    if (paths_file == NULL || path_nodes_file == NULL) ExitError("when opening the binary file to read the paths", 1);
+    if (fseek(paths_file, layout->paths_offset, SEEK_SET) != 0 || fseek(path_nodes_file, layout->path_nodes_offset, SEEK_SET) != 0)
+        ExitError("when seeking the paths of the binary data file", 2);
+    open_node_reader(&reader, bin_filename, layout);
+
+    // 2. Allocate the buffers of the tiles if the edges are written
+    Tile_segment *buffers;
+    unsigned long *nbuffered;
+
+    memset(grid->count, 0, grid->ntiles * sizeof(unsigned long));
+    buffers = NULL;
+    nbuffered = NULL;
+    if (grid->file != NULL) {
+        buffers = (Tile_segment *) malloc(grid->ntiles * buffer_size * sizeof(Tile_segment));
+        nbuffered = (unsigned long *) calloc(grid->ntiles, sizeof(unsigned long));
+        if (buffers == NULL || nbuffered == NULL) ExitError("when allocating memory for the buffers of the tiles", 3);
+    }
+
+    // 3. Read every original edge and store it in the tiles touched by its bounding box
+    unsigned long i_path, node_id, tile, column, row, min_column, max_column, min_row, max_row;
+    Path path;
+    Node node_p, node_q;
+    Tile_segment segment;
+
+    for (i_path = 0; i_path < layout->npaths; i_path++) {
+        if (fread(&path, sizeof(Path), 1, paths_file) != 1) ExitError("when reading paths from the input binary data file", 4);
+        if (path.len < 2) continue;
+        read_node_at(&reader, path.start_node.node_id, &node_p);
+        segment.path = i_path;
+        segment.path_id = path.id;
+        segment.watermark = path.npaths;
+        segment.shiptype = path.shiptype;
+        for (segment.seg = 0; segment.seg + 1 < path.len; segment.seg++) {
+            if (fread(&node_id, sizeof(unsigned long), 1, path_nodes_file) != 1)
+                ExitError("when reading path nodes from the input binary data file", 5);
+            read_node_at(&reader, node_id, &node_q);
+            segment.p_id = node_p.id;
+            segment.q_id = node_q.id;
+            segment.p_lon = node_p.lon;
+            segment.p_lat = node_p.lat;
+            segment.q_lon = node_q.lon;
+            segment.q_lat = node_q.lat;
+            segment.p_speed = node_p.speed;
+
+            min_column = tile_column(grid, fmin(segment.p_lon, segment.q_lon) - GRID_EPSILON);
+            max_column = tile_column(grid, fmax(segment.p_lon, segment.q_lon) + GRID_EPSILON);
+            min_row = tile_row(grid, fmin(segment.p_lat, segment.q_lat) - GRID_EPSILON);
+            max_row = tile_row(grid, fmax(segment.p_lat, segment.q_lat) + GRID_EPSILON);
+            for (row = min_row; row <= max_row; row++) for (column = min_column; column <= max_column; column++) {
+                tile = row * grid->ntiles_lon + column;
+                grid->count[tile]++;
+                if (buffers == NULL) continue;
+                buffers[tile * buffer_size + nbuffered[tile]] = segment;
+                nbuffered[tile]++;
+                if (nbuffered[tile] == buffer_size) {
+                    flush_tile_buffer(grid, tile, &buffers[tile * buffer_size], nbuffered[tile]);
+                    nbuffered[tile] = 0;
+                }
+            }
+            node_p = node_q;
+        }
+    }
+
+    // 4. Write the edges left in the buffers and find the most loaded tile
+    grid->max_count = 0;
+    for (tile = 0; tile < grid->ntiles; tile++) {
+        if (buffers != NULL && nbuffered[tile]) flush_tile_buffer(grid, tile, &buffers[tile * buffer_size], nbuffered[tile]);
+        if (grid->count[tile] > grid->max_count) grid->max_count = grid->count[tile];
+    }
+
+    fclose(paths_file);
+    fclose(path_nodes_file);
+    fclose(reader.file);
+    free(buffers);
+    free(nbuffered);
+}
+
+void flush_tile_buffer(Tile_grid *grid, unsigned long tile, Tile_segment *buffer, unsigned long nbuffered) {
+    if (fseek(grid->file, (long) ((grid->offset[tile] + grid->count[tile] - nbuffered) * sizeof(Tile_segment)), SEEK_SET) != 0)
+        ExitError("when seeking a tile of the temporary file", 1);
+    if (fwrite(buffer, sizeof(Tile_segment), nbuffered, grid->file) != nbuffered)
+        ExitError("when writing edges to the temporary file of the tiles", 2);
+}
+
+void free_tile_grid(Tile_grid *grid) {
+    free(grid->count);
+    free(grid->offset);
+    if (grid->file != NULL) fclose(grid->file);
+}
+
+/*
+    CROSSINGS DETECTION
+*/
+
+int compare_tile_segments(const void *a, const void *b) {
+    const Tile_segment *segment_a = (const Tile_segment *) a;
+    const Tile_segment *segment_b = (const Tile_segment *) b;
+    if (segment_a->path != segment_b->path) return segment_a->path < segment_b->path ? -1 : 1;
+    if (segment_a->seg != segment_b->seg) return segment_a->seg < segment_b->seg ? -1 : 1;
+    return 0;
+}
+
+unsigned long tile_crossings(Tile_grid *grid, unsigned long tile, Tile_segment *segments, unsigned long nsegments,
+                            Node *tile_nodes, Kernel_work *work,
+                            Tile_crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings) {
+    // 1. Sort the edges by path and copy them into the arrays, every path being a run with its own hierarchy
+    Segment_arrays *arrays = work->segments;
+    unsigned long index, ngroups;
+
+    qsort(segments, nsegments, sizeof(Tile_segment), compare_tile_segments);
+    ngroups = 0;
+    for (index = 0; index < nsegments; index++) {
+        if (index == 0 || segments[index].path != segments[index - 1].path) arrays->first[ngroups++] = index;
+        arrays->p_lon[index] = segments[index].p_lon;
+        arrays->p_lat[index] = segments[index].p_lat;
+        arrays->q_lon[index] = segments[index].q_lon;
+        arrays->q_lat[index] = segments[index].q_lat;
+        arrays->p_id[index] = 2 * index;
+        arrays->q_id[index] = 2 * index + 1;
+        tile_nodes[2 * index].id = segments[index].p_id;
+        tile_nodes[2 * index].lon = segments[index].p_lon;
+        tile_nodes[2 * index].lat = segments[index].p_lat;
+        tile_nodes[2 * index + 1].id = segments[index].q_id;
+        tile_nodes[2 * index + 1].lon = segments[index].q_lon;
+        tile_nodes[2 * index + 1].lat = segments[index].q_lat;
+    }
+    arrays->first[ngroups] = nsegments;
+    arrays->nsegments = nsegments;
+    create_segment_bvh(arrays, ngroups);
+
+    // 2. Compare every pair of paths to compute, as need_compute_paths
+    Crossing *crossings;
+    unsigned long group_1, group_2, ngroup_crossings, max_group_crossings, i_crossing, initial_ncrossings;
+    Tile_segment *segment_1, *segment_2;
+    Tile_crossing *new_crossing;
+    double owner_lon, owner_lat;
+
+    initial_ncrossings = *ncrossings;
+    crossings = NULL;
+    max_group_crossings = 0;
+    for (group_1 = 0; group_1 + 1 < ngroups; group_1++) {
+        segment_1 = &segments[arrays->first[group_1]];
+        ngroup_crossings = 0;
+        for (group_2 = group_1 + 1; group_2 < ngroups; group_2++) {
+            segment_2 = &segments[arrays->first[group_2]];
+            if (segment_1->shiptype != segment_2->shiptype || segment_2->path_id <= segment_1->watermark) continue;
+            kernel_pair_crossings(tile_nodes, work, group_1, group_2, &crossings, &ngroup_crossings, &max_group_crossings);
+        }
+
+        // 2.1. Keep only the crossings owned by this tile
+        for (i_crossing = 0; i_crossing < ngroup_crossings; i_crossing++) {
+            segment_1 = &segments[arrays->first[crossings[i_crossing].path_1] + crossings[i_crossing].seg_1];
+            segment_2 = &segments[arrays->first[crossings[i_crossing].path_2] + crossings[i_crossing].seg_2];
+            owner_lon = fmax(fmin(segment_1->p_lon, segment_1->q_lon), fmin(segment_2->p_lon, segment_2->q_lon));
+            owner_lat = fmax(fmin(segment_1->p_lat, segment_1->q_lat), fmin(segment_2->p_lat, segment_2->q_lat));
+            if (tile_of(grid, owner_lon, owner_lat) != tile) continue;
+
+            if (*ncrossings == *max_crossings) {
+                *max_crossings = *max_crossings ? 2 * (*max_crossings) : 64;
+                *crossings_ptr = (Tile_crossing *) realloc(*crossings_ptr, (*max_crossings) * sizeof(Tile_crossing));
+                if (*crossings_ptr == NULL) ExitError("when reallocating memory for the crossings of the tiles", 1);
+            }
+            new_crossing = &(*crossings_ptr)[*ncrossings];
+            new_crossing->crossing.path_1 = segment_1->path;
+            new_crossing->crossing.seg_1 = segment_1->seg;
+            new_crossing->crossing.path_2 = segment_2->path;
+            new_crossing->crossing.seg_2 = segment_2->seg;
+            new_crossing->crossing.type = identify_intersection(&tile_nodes[2 * (segment_1 - segments)],
+                                                                &tile_nodes[2 * (segment_1 - segments) + 1],
+                                                                &tile_nodes[2 * (segment_2 - segments)],
+                                                                &tile_nodes[2 * (segment_2 - segments) + 1],
+                                                                &new_crossing->t, &new_crossing->u);
+            new_crossing->lat = segment_1->p_lat + new_crossing->t * (segment_1->q_lat - segment_1->p_lat);
+            new_crossing->lon = segment_1->p_lon + new_crossing->t * (segment_1->q_lon - segment_1->p_lon);
+            new_crossing->speed = segment_1->p_speed > segment_2->p_speed ? segment_1->p_speed : segment_2->p_speed;
+            new_crossing->p1_id = segment_1->p_id;
+            new_crossing->q1_id = segment_1->q_id;
+            new_crossing->p2_id = segment_2->p_id;
+            new_crossing->q2_id = segment_2->q_id;
+            (*ncrossings)++;
+        }
+    }
+
+    free(crossings);
+    free_segment_bvh(arrays);
+    return *ncrossings - initial_ncrossings;
+}
+
+/*
+    GRAPH STORAGE
+*/
+
+int compare_node_ids(const void *a, const void *b) {
+    const unsigned long *id_a = (const unsigned long *) a;
+    const unsigned long *id_b = (const unsigned long *) b;
+    if (*id_a != *id_b) return *id_a < *id_b ? -1 : 1;
+    return 0;
+}
+
+Node *find_changed_node(Node *changed, unsigned long nchanged, unsigned long id) {
+    unsigned long low, high, middle;
+
+    low = 0;
+    high = nchanged;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (changed[middle].id < id) low = middle + 1;
+        else high = middle;
+    }
+    if (low == nchanged || changed[low].id != id) ExitError("when finding a node changed by the splice", 1);
+    return &changed[low];
+}
+
+void store_tiled_graph(char *bin_filename, Bin_layout *layout, Tile_crossing *crossings, unsigned long ncrossings,
+                        char *bin_new_filename, char *counter_filename, Intersections_counter *counter) {
+    // 1. Split the crossed edges as splice_crossings: every crossing creates the next new node, which splits the edges of
+    // both paths, the edges that touch or overlap are split at the existing nodes and the coincident nodes are linked
+    Tile_split *splits;
+    Edge_split touching[4];
+    Node_link *links;
+    Node node_p1, node_q1, node_p2, node_q2;
+    unsigned long index, nsplits, nlinks, nnew, ntouching, i_touching;
+    unsigned short intersection_type;
+
+    splits = (Tile_split *) malloc((ncrossings ? 2 * ncrossings : 1) * sizeof(Tile_split));
+    links = (Node_link *) malloc((ncrossings ? ncrossings : 1) * sizeof(Node_link));
+    if (splits == NULL) ExitError("when allocating memory for the edge splits", 1);
+    if (links == NULL) ExitError("when allocating memory for the node links", 2);
+    counter->computed = 0;
+    counter->touching = 0;
+    counter->ignored = 0;
+    nsplits = 0;
+    nlinks = 0;
+    nnew = 0;
+    for (index = 0; index < ncrossings; index++) {
+        intersection_type = crossings[index].crossing.type;
+        if (intersection_type == 0) {
+            counter->ignored++;
+            continue;
+        }
+
+        // 1.1. Only the ids of the nodes are needed to find where the edges that touch or overlap are split
+        if (intersection_type != 1) {
+            counter->touching++;
+            node_p1.id = crossings[index].p1_id;
+            node_q1.id = crossings[index].q1_id;
+            node_p2.id = crossings[index].p2_id;
+            node_q2.id = crossings[index].q2_id;
+            if (intersection_type >= 6 && intersection_type <= 9) {
+                links[nlinks].from = intersection_type == 6 || intersection_type == 8 ? node_p1.id : node_q1.id;
+                links[nlinks].to = intersection_type == 6 || intersection_type == 7 ? node_p2.id : node_q2.id;
+                if (links[nlinks].from > links[nlinks].to) {
+                    links[nlinks].from = links[nlinks].to;
+                    links[nlinks].to = intersection_type == 6 || intersection_type == 8 ? node_p1.id : node_q1.id;
+                }
+                if (links[nlinks].from != links[nlinks].to) nlinks++;
+                continue;
+            }
+            ntouching = touching_splits(&node_p1, &node_q1, &node_p2, &node_q2, &crossings[index].crossing, intersection_type,
+                                        crossings[index].t, crossings[index].u, touching);
+            for (i_touching = 0; i_touching < ntouching; i_touching++) {
+                splits[nsplits].split = touching[i_touching];
+                splits[nsplits].p_id = touching[i_touching].path == crossings[index].crossing.path_1 ? node_p1.id : node_p2.id;
+                splits[nsplits].q_id = touching[i_touching].path == crossings[index].crossing.path_1 ? node_q1.id : node_q2.id;
+                nsplits++;
+            }
+            continue;
+        }
+
+        splits[nsplits].split.path = crossings[index].crossing.path_1;
+        splits[nsplits].split.seg = crossings[index].crossing.seg_1;
+        splits[nsplits].split.param = crossings[index].t;
+        splits[nsplits].split.node_id = layout->nnodes + nnew;
+        splits[nsplits].split.edge = 0;
+        splits[nsplits].p_id = crossings[index].p1_id;
+        splits[nsplits].q_id = crossings[index].q1_id;
+        nsplits++;
+        splits[nsplits].split.path = crossings[index].crossing.path_2;
+        splits[nsplits].split.seg = crossings[index].crossing.seg_2;
+        splits[nsplits].split.param = crossings[index].u;
+        splits[nsplits].split.node_id = layout->nnodes + nnew;
+        splits[nsplits].split.edge = 1;
+        splits[nsplits].p_id = crossings[index].p2_id;
+        splits[nsplits].q_id = crossings[index].q2_id;
+        nsplits++;
+        nnew++;
+    }
+    counter->computed = nnew;
+
+    // 1.2. Sort the splits along every edge and drop the repeated ones
+    unsigned long first, last, split, nkept, repeated;
+
+    qsort(splits, nsplits, sizeof(Tile_split), compare_edge_splits);
+    nkept = 0;
+    for (split = 0; split < nsplits; split++) {
+        if (splits[split].split.node_id < layout->nnodes) {
+            for (repeated = nkept; repeated > 0 && splits[repeated - 1].split.path == splits[split].split.path &&
+                    splits[repeated - 1].split.seg == splits[split].split.seg &&
+                    splits[repeated - 1].split.node_id != splits[split].split.node_id; repeated--);
+            if (repeated > 0 && splits[repeated - 1].split.path == splits[split].split.path &&
+                splits[repeated - 1].split.seg == splits[split].split.seg) continue;
+        }
+        splits[nkept++] = splits[split];
+    }
+    nsplits = nkept;
+
+    // 2. Read the original nodes whose edges change: the first node of every split edge, the existing nodes where an edge
+    // is split and the linked ones. Their edges are read by seeking, as they are few.
+    unsigned long *changed_ids, nchanged, i_changed, edge_offset;
+    Node *changed, node;
+    FILE *nodes_file, *edges_file, *times_file, *paths_file, *bin_file;
+
+    changed_ids = (unsigned long *) malloc((2 * nsplits + 2 * nlinks + 1) * sizeof(unsigned long));
+    if (changed_ids == NULL) ExitError("when allocating memory for the changed nodes", 3);
+    nchanged = 0;
+    for (split = 0; split < nsplits; split++) {
+        changed_ids[nchanged++] = splits[split].p_id;
+        if (splits[split].split.node_id < layout->nnodes) changed_ids[nchanged++] = splits[split].split.node_id;
+    }
+    for (index = 0; index < nlinks; index++) {
+        changed_ids[nchanged++] = links[index].from;
+        changed_ids[nchanged++] = links[index].to;
+    }
+    qsort(changed_ids, nchanged, sizeof(unsigned long), compare_node_ids);
+    nkept = 0;
+    for (i_changed = 0; i_changed < nchanged; i_changed++) {
+        if (nkept == 0 || changed_ids[i_changed] != changed_ids[nkept - 1]) changed_ids[nkept++] = changed_ids[i_changed];
+    }
+    nchanged = nkept;
+    changed = (Node *) malloc((nchanged ? nchanged : 1) * sizeof(Node));
+    if (changed == NULL) ExitError("when allocating memory for the changed nodes", 3);
+
+    nodes_file = fopen(bin_filename, "rb");
+    edges_file = fopen(bin_filename, "rb");
+    times_file = fopen(bin_filename, "rb");
+    paths_file = fopen(bin_filename, "rb");
+    if (nodes_file == NULL || edges_file == NULL || times_file == NULL || paths_file == NULL)
+        ExitError("when opening the binary file", 4);
+    if (fseek(nodes_file, layout->nodes_offset, SEEK_SET) != 0) ExitError("when seeking the nodes of the binary data file", 5);
+    i_changed = 0;
+    edge_offset = 0;
+    for (index = 0; index < layout->nnodes && i_changed < nchanged; index++) {
+        if (fread(&node, sizeof(Node), 1, nodes_file) != 1) ExitError("when reading nodes from the input binary data file", 6);
+        if (changed_ids[i_changed] == index) {
+            node.to_nodes = NULL;
+            node.to_times = NULL;
+            if (node.nedges) {
+                node.to_nodes = (unsigned long *) malloc(node.nedges * sizeof(unsigned long));
+                node.to_times = (double *) malloc(node.nedges * sizeof(double));
+                if (node.to_nodes == NULL || node.to_times == NULL) ExitError("when allocating memory for the edges of a node", 7);
+                if (fseek(edges_file, layout->to_nodes_offset + (long) (edge_offset * sizeof(unsigned long)), SEEK_SET) != 0 ||
+                    fseek(times_file, layout->to_times_offset + (long) (edge_offset * sizeof(double)), SEEK_SET) != 0)
+                    ExitError("when seeking the edges of the binary data file", 8);
+                if (fread(node.to_nodes, sizeof(unsigned long), node.nedges, edges_file) != node.nedges ||
+                    fread(node.to_times, sizeof(double), node.nedges, times_file) != node.nedges)
+                    ExitError("when reading edges from the input binary data file", 9);
+            }
+            changed[i_changed++] = node;
+        }
+        edge_offset += node.nedges;
+    }
+    if (i_changed < nchanged) ExitError("when finding a node changed by the splice", 10);
+
+    // 3. Add an edge to the existing nodes where an edge is split, in the same order as splice_crossings
+    unsigned long added_edges;
+
+    added_edges = 0;
+    for (split = 0; split < nsplits; split++) {
+        if (splits[split].split.node_id >= layout->nnodes) continue;
+        // The edge points to the node itself until the split is done, so it is never taken for an edge of the path
+        splits[split].split.edge = append_node_edge(find_changed_node(changed, nchanged, splits[split].split.node_id),
+                                                    splits[split].split.node_id, 0.);
+        added_edges++;
+    }
+
+    // 4. Split every edge in its pieces, sorted along it: every piece goes to the next node, or to the last node of the edge
+    unsigned long *new_to_nodes, *prev_to_node, next_id;
+    double *new_to_times, *prev_to_time, edge_time, prev_param;
+    Node *prev_node;
+    unsigned i_edge;
+
+    new_to_nodes = (unsigned long *) malloc((nnew ? 2 * nnew : 1) * sizeof(unsigned long));
+    new_to_times = (double *) malloc((nnew ? 2 * nnew : 1) * sizeof(double));
+    if (new_to_nodes == NULL || new_to_times == NULL) ExitError("when allocating memory for the edges of the new nodes", 11);
+    for (first = 0; first < nsplits; first = last) {
+        for (last = first + 1; last < nsplits && splits[last].split.path == splits[first].split.path &&
+                                splits[last].split.seg == splits[first].split.seg; last++);
+
+        // The edges already rewired go to new nodes, so two paths sharing an edge rewire one each, as splice_crossings
+        prev_node = find_changed_node(changed, nchanged, splits[first].p_id);
+        for (i_edge = 0; i_edge < prev_node->nedges && prev_node->to_nodes[i_edge] != splits[first].q_id; i_edge++);
+        if (i_edge == prev_node->nedges) ExitError("when splitting an edge that does not exist", 12);
+        prev_to_node = &prev_node->to_nodes[i_edge];
+        prev_to_time = &prev_node->to_times[i_edge];
+        edge_time = *prev_to_time;
+        prev_param = 0.;
+
+        for (split = first; split < last; split++) {
+            next_id = *prev_to_node;
+            *prev_to_node = splits[split].split.node_id;
+            *prev_to_time = (splits[split].split.param - prev_param) * edge_time;
+            if (splits[split].split.node_id >= layout->nnodes) {
+                prev_to_node = &new_to_nodes[2 * (splits[split].split.node_id - layout->nnodes) + splits[split].split.edge];
+                prev_to_time = &new_to_times[2 * (splits[split].split.node_id - layout->nnodes) + splits[split].split.edge];
+            } else {
+                prev_node = find_changed_node(changed, nchanged, splits[split].split.node_id);
+                prev_to_node = &prev_node->to_nodes[splits[split].split.edge];
+                prev_to_time = &prev_node->to_times[splits[split].split.edge];
+            }
+            *prev_to_node = next_id;
+            *prev_to_time = (1 - splits[split].split.param) * edge_time;
+            prev_param = splits[split].split.param;
+        }
+    }
+
+    // 5. Link the coincident nodes of different paths both ways with edges of no travelling time
+    Node *from_node, *to_node;
+
+    qsort(links, nlinks, sizeof(Node_link), compare_node_links);
+    for (index = 0; index < nlinks; index++) {
+        if (index && links[index].from == links[index - 1].from && links[index].to == links[index - 1].to) continue;
+        from_node = find_changed_node(changed, nchanged, links[index].from);
+        to_node = find_changed_node(changed, nchanged, links[index].to);
+        for (i_edge = 0; i_edge < from_node->nedges && from_node->to_nodes[i_edge] != links[index].to; i_edge++);
+        if (i_edge == from_node->nedges) {
+            append_node_edge(from_node, links[index].to, 0.);
+            added_edges++;
+        }
+        for (i_edge = 0; i_edge < to_node->nedges && to_node->to_nodes[i_edge] != links[index].from; i_edge++);
+        if (i_edge == to_node->nedges) {
+            append_node_edge(to_node, links[index].from, 0.);
+            added_edges++;
+        }
+    }
+
+    // 6. Write the header and the nodes: the original ones, with the edges of the changed ones, and the new ones
+    unsigned long nnodes, nedges, node_id;
+
+    bin_file = fopen(bin_new_filename, "wb");
+    if (bin_file == NULL) ExitError("when opening the new binary file", 13);
+    nnodes = layout->nnodes + nnew;
+    nedges = layout->nedges + 2 * nnew + added_edges;
+    printf("The graph to store contains %lu nodes, %lu edges and %lu paths\n", nnodes, nedges, layout->npaths);
+    if (fwrite(&nnodes, sizeof(unsigned long), 1, bin_file) +
+        fwrite(&nedges, sizeof(unsigned long), 1, bin_file) +
+        fwrite(&layout->npaths, sizeof(unsigned long), 1, bin_file) != 3) {
+        ExitError("when writing header to the output binary data file", 14);
+    }
+
+    if (fseek(nodes_file, layout->nodes_offset, SEEK_SET) != 0) ExitError("when seeking the nodes of the binary data file", 5);
+    i_changed = 0;
+    for (index = 0; index < layout->nnodes; index++) {
+        if (fread(&node, sizeof(Node), 1, nodes_file) != 1) ExitError("when reading nodes from the input binary data file", 6);
+        if (i_changed < nchanged && changed[i_changed].id == index) node = changed[i_changed++];
+        if (fwrite(&node, sizeof(Node), 1, bin_file) != 1) ExitError("when writing nodes to the output binary data file", 15);
+    }
+    node_id = layout->nnodes;
+    for (index = 0; index < ncrossings; index++) {
+        if (crossings[index].crossing.type != 1) continue;
+        node.id = node_id++;
+        node.lat = crossings[index].lat;
+        node.lon = crossings[index].lon;
+        node.speed = crossings[index].speed;
+        node.nedges = 2;
+        node.max_edges = 2;
+        node.to_nodes = NULL;
+        node.to_times = NULL;
+        if (fwrite(&node, sizeof(Node), 1, bin_file) != 1) ExitError("when writing nodes to the output binary data file", 15);
+    }
+
+    // 7. Write the nodes connections and then the travelling times, taking the ones of the changed nodes from memory
+    unsigned long *to_nodes;
+    double *to_times;
+    unsigned max_edges;
+
+    max_edges = 16;
+    to_nodes = (unsigned long *) malloc(max_edges * sizeof(unsigned long));
+    to_times = (double *) malloc(max_edges * sizeof(double));
+    if (to_nodes == NULL || to_times == NULL) ExitError("when allocating memory for the edges to store", 16);
+
+    if (fseek(nodes_file, layout->nodes_offset, SEEK_SET) != 0 || fseek(edges_file, layout->to_nodes_offset, SEEK_SET) != 0)
+        ExitError("when seeking the edges of the binary data file", 8);
+    i_changed = 0;
+    for (index = 0; index < layout->nnodes; index++) {
+        if (fread(&node, sizeof(Node), 1, nodes_file) != 1) ExitError("when reading nodes from the input binary data file", 6);
+        if (node.nedges > max_edges) {
+            max_edges = node.nedges;
+            to_nodes = (unsigned long *) realloc(to_nodes, max_edges * sizeof(unsigned long));
+            to_times = (double *) realloc(to_times, max_edges * sizeof(double));
+            if (to_nodes == NULL || to_times == NULL) ExitError("when reallocating memory for the edges to store", 17);
+        }
+        if (node.nedges && fread(to_nodes, sizeof(unsigned long), node.nedges, edges_file) != node.nedges)
+            ExitError("when reading edges from the input binary data file", 9);
+        if (i_changed < nchanged && changed[i_changed].id == index) node = changed[i_changed++];
+        else node.to_nodes = to_nodes;
+        if (node.nedges && fwrite(node.to_nodes, sizeof(unsigned long), node.nedges, bin_file) != node.nedges)
+            ExitError("when writing edges to the output binary data file", 18);
+    }
+    if (nnew && fwrite(new_to_nodes, sizeof(unsigned long), 2 * nnew, bin_file) != 2 * nnew)
+        ExitError("when writing edges to the output binary data file", 18);
+
+    if (fseek(nodes_file, layout->nodes_offset, SEEK_SET) != 0 || fseek(times_file, layout->to_times_offset, SEEK_SET) != 0)
+        ExitError("when seeking the travelling times of the binary data file", 19);
+    i_changed = 0;
+    for (index = 0; index < layout->nnodes; index++) {
+        if (fread(&node, sizeof(Node), 1, nodes_file) != 1) ExitError("when reading nodes from the input binary data file", 6);
+        if (node.nedges && fread(to_times, sizeof(double), node.nedges, times_file) != node.nedges)
+            ExitError("when reading times from the input binary data file", 20);
+        if (i_changed < nchanged && changed[i_changed].id == index) node = changed[i_changed++];
+        else node.to_times = to_times;
+        if (node.nedges && fwrite(node.to_times, sizeof(double), node.nedges, bin_file) != node.nedges)
+            ExitError("when writing times to the output binary data file", 21);
+    }
+    if (nnew && fwrite(new_to_times, sizeof(double), 2 * nnew, bin_file) != 2 * nnew)
+        ExitError("when writing times to the output binary data file", 21);
+
+    // 8. Write the paths, checked with all the others, and the number of crossings of every path
+    FILE *counter_file;
+    Path path;
+    unsigned long npath_splits, npath_crossings;
+
+    counter_file = fopen(counter_filename, "w");
+    if (counter_file == NULL) ExitError("when opening the counter file", 22);
+    if (fseek(paths_file, layout->paths_offset, SEEK_SET) != 0) ExitError("when seeking the paths of the binary data file", 23);
+    split = 0;
+    for (index = 0; index < layout->npaths; index++) {
+        if (fread(&path, sizeof(Path), 1, paths_file) != 1) ExitError("when reading paths from the input binary data file", 24);
+        npath_splits = 0;
+        npath_crossings = 0;
+        for (; split < nsplits && splits[split].split.path == index; split++) {
+            npath_splits++;
+            if (splits[split].split.node_id >= layout->nnodes) npath_crossings++;
+        }
+        path.len += npath_splits;
+        if (index + 1 < layout->npaths && path.npaths < layout->npaths - 1) path.npaths = layout->npaths - 1;
+        path.max_paths = 0;
+        if (fwrite(&path, sizeof(Path), 1, bin_file) != 1) ExitError("when writing paths to the output binary data file", 25);
+        fprintf(counter_file, "%lu %lu\n", index, npath_crossings);
+    }
+    fclose(counter_file);
+
+    // 9. Write the paths' nodes, with the nodes of the splits inserted after the first node of every split edge
+    unsigned long seg;
+
+    if (fseek(paths_file, layout->paths_offset, SEEK_SET) != 0 || fseek(edges_file, layout->path_nodes_offset, SEEK_SET) != 0)
+        ExitError("when seeking the paths of the binary data file", 23);
+    split = 0;
+    for (index = 0; index < layout->npaths; index++) {
+        if (fread(&path, sizeof(Path), 1, paths_file) != 1) ExitError("when reading paths from the input binary data file", 24);
+        for (seg = 0; seg + 1 < path.len; seg++) {
+            for (; split < nsplits && splits[split].split.path == index && splits[split].split.seg == seg; split++) {
+                if (fwrite(&splits[split].split.node_id, sizeof(unsigned long), 1, bin_file) != 1)
+                    ExitError("when writing path nodes to the output binary data file", 26);
+            }
+            if (fread(&node_id, sizeof(unsigned long), 1, edges_file) != 1)
+                ExitError("when reading path nodes from the input binary data file", 27);
+            if (fwrite(&node_id, sizeof(unsigned long), 1, bin_file) != 1)
+                ExitError("when writing path nodes to the output binary data file", 26);
+        }
+    }
+
+    fclose(nodes_file);
+    fclose(edges_file);
+    fclose(times_file);
+    fclose(paths_file);
+    fclose(bin_file);
+    for (i_changed = 0; i_changed < nchanged; i_changed++) {
+        free(changed[i_changed].to_nodes);
+        free(changed[i_changed].to_times);
+    }
+    free(changed);
+    free(changed_ids);
+    free(splits);
+    free(links);
+    free(to_nodes);
+    free(to_times);
+    free(new_to_nodes);
+    free(new_to_times);
+}
+
+unsigned long tiled_intersections(char *bin_filename, char *bin_new_filename, char *counter_filename, double memory_budget,
+                                Intersections_counter *counter) {
+    // 1. Locate the sections of the binary file and distribute the edges into the tiles
+    Bin_layout layout;
+    Tile_grid grid;
+
+    scan_bin_layout(bin_filename, &layout);
+    printf("The graph contains %lu nodes, %lu edges and %lu paths\n", layout.nnodes, layout.nedges, layout.npaths);
+    create_tile_grid(&grid, bin_filename, &layout, memory_budget);
+
+    // 2. Allocate the memory of the most loaded tile once
+    Tile_segment *segments;
+    Node *tile_nodes;
+    Segment_arrays arrays;
+    Kernel_work work;
+    unsigned long max_count;
+
+    max_count = grid.max_count ? grid.max_count : 1;
+    segments = (Tile_segment *) malloc(max_count * sizeof(Tile_segment));
+    tile_nodes = (Node *) malloc(2 * max_count * sizeof(Node));
+    arrays.first = (unsigned long *) malloc((max_count + 1) * sizeof(unsigned long));
+    arrays.p_lon = (double *) malloc(max_count * sizeof(double));
+    arrays.p_lat = (double *) malloc(max_count * sizeof(double));
+    arrays.q_lon = (double *) malloc(max_count * sizeof(double));
+    arrays.q_lat = (double *) malloc(max_count * sizeof(double));
+    arrays.p_id = (unsigned long *) malloc(max_count * sizeof(unsigned long));
+    arrays.q_id = (unsigned long *) malloc(max_count * sizeof(unsigned long));
+    work.hits = (unsigned long *) malloc(BVH_LEAF_SIZE * sizeof(unsigned long));
+    if (segments == NULL || tile_nodes == NULL || arrays.first == NULL || arrays.p_lon == NULL || arrays.p_lat == NULL ||
+        arrays.q_lon == NULL || arrays.q_lat == NULL || arrays.p_id == NULL || arrays.q_id == NULL || work.hits == NULL)
+        ExitError("when allocating memory for the tiles", 1);
+    work.segments = &arrays;
+    work.stack = NULL;
+    work.max_stack = 0;
+    work.pairs_tested = 0;
+    work.pairs_total = 0;
+
+    // 3. Find the crossings of every tile
+    Tile_crossing *crossings;
+    unsigned long tile, ncrossings, max_crossings;
+    unsigned short pc, last_pc = 101;
+
+    crossings = NULL;
+    ncrossings = 0;
+    max_crossings = 0;
+    for (tile = 0; tile < grid.ntiles; tile++) {
+        if (grid.count[tile] < 2) continue;
+        // The progress is only printed when its percentage changes, there can be a million tiles
+        pc = (unsigned short) (100 * tile / grid.ntiles);
+        if (pc != last_pc) {
+            printf("\rTile: %lu out of %lu", tile, grid.ntiles);
+            fflush(stdout);
+            last_pc = pc;
+        }
+        if (fseek(grid.file, (long) (grid.offset[tile] * sizeof(Tile_segment)), SEEK_SET) != 0)
+            ExitError("when seeking a tile of the temporary file", 2);
+        if (fread(segments, sizeof(Tile_segment), grid.count[tile], grid.file) != grid.count[tile])
+            ExitError("when reading edges from the temporary file of the tiles", 3);
+        tile_crossings(&grid, tile, segments, grid.count[tile], tile_nodes, &work, &crossings, &ncrossings, &max_crossings);
+    }
+    printf("\n");
+
+    free(segments);
+    free(tile_nodes);
+    free_segment_arrays(&arrays);
+    free(work.hits);
+    free(work.stack);
+    free_tile_grid(&grid);
+
+    // 4. Splice the crossings, in the same order as the other engines, while the graph is copied
+    if (ncrossings > 1) qsort(crossings, ncrossings, sizeof(Tile_crossing), compare_crossings);
+    store_tiled_graph(bin_filename, &layout, crossings, ncrossings, bin_new_filename, counter_filename, counter);
+
+    free(crossings);
+    return counter->computed;
+}
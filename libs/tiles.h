@@ -0,0 +1,176 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <stdio.h>
+
+/*
+    STRUCTURES TO READ THE BINARY FILE BY PIECES
+*/
+
+/*
+ * Stores where every section of a stored graph starts in its binary file, so it can be read piece by piece.
+ * nsegments is the number of original edges of the paths and min_lon, max_lon, min_lat, max_lat the bounding box of the nodes.
+*/
+typedef struct {
+    unsigned long nnodes, nedges, npaths;
+    long nodes_offset, to_nodes_offset, to_times_offset, paths_offset, path_nodes_offset;
+    unsigned long nsegments;
+    double min_lon, max_lon, min_lat, max_lat;
+} Bin_layout;
+
+// Reads the nodes of a binary file by id. next_id is the node at the current position, so consecutive ids are read without seeking.
+typedef struct {
+    FILE *file;
+    long nodes_offset;
+    unsigned long next_id;
+} Node_reader;
+
+/*
+    STRUCTURES TO STORE THE TILES
+*/
+
+/*
+ * Stores an original edge of a path in a tile: the path, its id, shiptype and watermark, the position of the edge in it,
+ * the ids and coordinates of its nodes and the speed of the first one.
+*/
+typedef struct {
+    unsigned long path, path_id, watermark, seg;
+    unsigned long p_id, q_id;
+    double p_lon, p_lat, q_lon, q_lat;
+    int shiptype;
+    int p_speed;
+} Tile_segment;
+
+/*
+ * Stores a grid of ntiles_lon x ntiles_lat tiles of tile_lon x tile_lat degrees over the bounding box of the graph.
+ * The edges of every tile are stored consecutively in file, count[tile] of them from the position offset[tile].
+ * An edge is stored in every tile touched by its bounding box, enlarged GRID_EPSILON.
+*/
+typedef struct {
+    double min_lon, min_lat, tile_lon, tile_lat;
+    unsigned long ntiles_lon, ntiles_lat, ntiles;
+    unsigned long *count, *offset;
+    unsigned long max_count;
+    FILE *file;
+} Tile_grid;
+
+// Stores an intersection found in a tile, with the ids of the nodes of both edges and, for a crossing (type 1), the new node:
+// its coordinates and speed. The crossing goes first, so they can be sorted with compare_crossings.
+typedef struct {
+    Crossing crossing;
+    double t, u;
+    double lat, lon;
+    int speed;
+    unsigned long p1_id, q1_id, p2_id, q2_id;
+} Tile_crossing;
+
+// Stores a split of an original edge from p_id to q_id. The split goes first, so they can be sorted with compare_edge_splits.
+typedef struct {
+    Edge_split split;
+    unsigned long p_id, q_id;
+} Tile_split;
+
+// Bytes used by every edge of the tile being computed: the edge, its copy in the segment arrays, its two nodes and its share of the hierarchy
+#define TILE_SEGMENT_MEMORY (sizeof(Tile_segment) + 4 * sizeof(double) + 4 * sizeof(unsigned long) + 2 * sizeof(Node) + sizeof(Bvh_node))
+
+// Maximum number of tiles of the grid
+#define TILE_MAX_TILES (1UL << 20)
+
+// Maximum number of times the tiles are halved when the most loaded one does not fit in the memory budget
+#define TILE_MAX_REFINEMENTS 8
+
+/*
+    BINARY FILE READING
+*/
+
+// Scans the binary file to find where every section starts, the number of original edges and the bounding box of the nodes
+void scan_bin_layout(char *bin_filename, Bin_layout *layout);
+
+// Opens a reader of the nodes of the binary file
+void open_node_reader(Node_reader *reader, char *bin_filename, Bin_layout *layout);
+
+// Reads the node with the given id. The pointers to its edges are not valid.
+void read_node_at(Node_reader *reader, unsigned long id, Node *node);
+
+/*
+    TILE GRID
+*/
+
+// Returns the column of the tiles where the longitude is, clamped to the grid
+unsigned long tile_column(Tile_grid *grid, double lon);
+
+// Returns the row of the tiles where the latitude is, clamped to the grid
+unsigned long tile_row(Tile_grid *grid, double lat);
+
+// Returns the tile where the point is, clamped to the grid
+unsigned long tile_of(Tile_grid *grid, double lon, double lat);
+
+// Sets tiles of about tile_size degrees covering the bounding box of the graph
+void set_tile_size(Tile_grid *grid, Bin_layout *layout, double tile_size);
+
+/*
+ * Creates a grid whose most loaded tile fits in memory_budget bytes and stores the edges of every tile in a temporary file.
+ * The number of tiles is estimated from the number of edges, and the tiles are halved while the most loaded one does not fit.
+*/
+void create_tile_grid(Tile_grid *grid, char *bin_filename, Bin_layout *layout, double memory_budget);
+
+/*
+ * Reads every original edge of the binary file, in order, and counts it in every tile it touches.
+ * If the file of the grid is open, the edges are also written to it through the buffers of the tiles, of buffer_size edges each.
+*/
+void distribute_segments(Tile_grid *grid, char *bin_filename, Bin_layout *layout, unsigned long buffer_size);
+
+// Writes the nbuffered edges of the buffer of a tile to its position in the file of the grid. They are already counted.
+void flush_tile_buffer(Tile_grid *grid, unsigned long tile, Tile_segment *buffer, unsigned long nbuffered);
+
+// Frees the grid and removes its temporary file
+void free_tile_grid(Tile_grid *grid);
+
+/*
+    CROSSINGS DETECTION
+*/
+
+// Compares two edges by path and position in it. Used to sort them with qsort.
+int compare_tile_segments(const void *a, const void *b);
+
+/*
+ * Finds the crossings between the nsegments edges of a tile of the pairs of paths to compute. The edges are sorted by path
+ * and copied into the segment arrays of the work, with their nodes in tile_nodes, so every pair of paths is compared by
+ * kernel_pair_crossings. The arrays must fit nsegments edges and tile_nodes twice as many nodes.
+ * Every pair of edges is owned by the tile of the lower corner of the intersection of their bounding boxes, so a crossing
+ * of edges stored in several tiles is only kept once. They are appended to *crossings_ptr with their intersection type,
+ * crossing, touching or overlapping. Returns how many they are.
+*/
+unsigned long tile_crossings(Tile_grid *grid, unsigned long tile, Tile_segment *segments, unsigned long nsegments,
+                            Node *tile_nodes, Kernel_work *work,
+                            Tile_crossing **crossings_ptr, unsigned long *ncrossings, unsigned long *max_crossings);
+
+/*
+    GRAPH STORAGE
+*/
+
+// Compares two node ids. Used to sort them with qsort.
+int compare_node_ids(const void *a, const void *b);
+
+// Returns the node with the given id among the nchanged ones, sorted by id. It must be there.
+Node *find_changed_node(Node *changed, unsigned long nchanged, unsigned long id);
+
+/*
+ * Stores the graph of the binary file with the crossings, sorted with compare_crossings, spliced as in splice_crossings,
+ * touching and overlapping edges included, and sums them in the counter. The original nodes whose edges change are read
+ * into memory and spliced there, and the rest of the input is read and the output written section by section, so only
+ * the crossings, their splits and the changed nodes are kept in memory. Every path is marked as checked with all the others,
+ * and the number of crossings of every path is stored in the counter file.
+*/
+void store_tiled_graph(char *bin_filename, Bin_layout *layout, Tile_crossing *crossings, unsigned long ncrossings,
+                        char *bin_new_filename, char *counter_filename, Intersections_counter *counter);
+
+/*
+ * Computes the intersections of the graph stored in the binary file tile by tile, keeping in memory only one tile,
+ * of memory_budget bytes at most, and the crossings found. The graph with the intersections is stored in bin_new_filename,
+ * with the same splice as add_int, and the intersections counted in the counter. Returns the number of crossings type 1.
+*/
+unsigned long tiled_intersections(char *bin_filename, char *bin_new_filename, char *counter_filename, double memory_budget,
+                                Intersections_counter *counter);
+
+#endif
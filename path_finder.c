@@ -4,14 +4,14 @@
     $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
 
     - Compilation:
-        >> gcc -o path path_finder.c libs/graph_management.c libs/algorithms.c -lm
+        >> gcc -o path path_finder.c libs/graph_management.c libs/algorithms.c libs/metrics.c -lm -lpthread
 
     - Usage:
         >> ./path stored_graph.bin heuristic_code program_mode (+ additional args depending on program_mode)
             Program modes:
             >> 0: pq_code initial_lat initial_lon final_lat final_lon solution_filename_PATH.txt solution_filename_CONTROL.txt
             >> 1: pq_code path_id solution_filename_PATH.txt solution_filename_CONTROL.txt
-            >> 2: heuristic_metrics.txt pq_metrics.txt
+            >> 2: heuristic_metrics.txt pq_metrics.txt (+ nthreads pq_code pq_code ...)
 
     - Output:
         >> For program mode 0:
@@ -33,10 +33,17 @@
         >> Different Priority Queues can be used:
             >> 0: Linked List
             >> 1: Binary Heap
+            >> 2: 4-ary Heap
+            >> 3: 8-ary Heap
+            >> 4: Pairing Heap
+            >> 5: Lazy Heap, a Binary Heap without decrease-key
+            >> 6: Bucket Queue, with buckets of whole seconds of cost
+            Any pq_code preceded by b, as b1, runs a bidirectional A* with that queue over the incoming edges of the nodes.
         >> Different program_modes can be used:
             >> 0: finds the solution taking initial and final coordinates
             >> 1: finds the solution for every path in the binary file and stores the a summary of the solution
-            >> 2: execute both PQ for a chosen heuristic for every path and stores different performance metrics
+            >> 2: execute the chosen PQ (by default the Linked List and the Binary Heap) for a chosen heuristic for every path and stores different performance metrics
+                The paths are shared by nthreads threads (all the processors by default, or with 0), and the metrics are stored in the order of the paths.
 
         >> Speed of the ships in [kn].
     
@@ -121,27 +128,24 @@ int main (int argc, char **argv) {
         // 3.0.2. A* algorithm
         printf("Finding path...\n");
 
-        AStarPath *Sol_path;
-        Sol_path = (AStarPath *) malloc(nnodes * sizeof(AStarPath));
-        if (Sol_path == NULL) ExitError("when allocating memory for the AStarPath", 3);
+        Search_context context;
+        init_search_context(&context, nnodes);
+        AStarPath *Sol_path = context.Sol_path;
+        AStarControlData *Queue_control = context.Queue_control;
 
-        AStarControlData *Queue_control;
-        Queue_control = (AStarControlData *) malloc(nnodes * sizeof(AStarControlData));
-        if (Queue_control == NULL) ExitError("when allocating memory for the AStar Control Data vector", 4);
-        
-        for (index = 0; index < nnodes; index++) {
-            Sol_path[index].g = DBL_MAX;
-            Queue_control[index].InPQ = false;
-            Queue_control[index].extended = false;
-        }
-        int pq_code = atoi(argv[4]);
+        bool bidirectional;
+        int pq_code = read_search_code(argv[4], &bidirectional);
         int result;
-        if (pq_code == 0) {
-            result = AStar_ll(nodes, Sol_path, Queue_control, initial_node, final_node, heuristic_code);
-        } else if (pq_code == 1) {
-            result = AStar_bh(nodes, Sol_path, Queue_control, nnodes, initial_node, final_node, heuristic_code);
+        if (bidirectional) {
+            Reverse_graph reverse;
+            Search_context backward;
+            build_reverse_graph(nodes, nnodes, &reverse);
+            init_search_context(&backward, nnodes);
+            result = BiAStar(nodes, &reverse, &context, &backward, initial_node, final_node, heuristic_code, pq_code, NULL, NULL);
+            free_search_context(&backward);
+            free_reverse_graph(&reverse);
         } else {
-            ExitError("wrong pq_code. Must be 0 or 1", 5);
+            result = AStar(nodes, &context, initial_node, final_node, heuristic_code, pq_code, NULL, NULL);
         }
         
 
@@ -169,8 +173,7 @@ int main (int argc, char **argv) {
         // 3.0.5. Free allocated memory
         free(path_filename);
         free(control_filename);
-        free(Sol_path);
-        free(Queue_control);
+        free_search_context(&context);
     } else if (program_mode == 1) {
         printf("Program mode 1. Chossing initial and final nodes...\n");
         unsigned long selected_path;
@@ -183,28 +186,24 @@ int main (int argc, char **argv) {
         // 3.1.1. A* algorithm
         printf("Finding path...\n");
 
-        AStarPath *Sol_path;
-        Sol_path = (AStarPath *) malloc(nnodes * sizeof(AStarPath));
-        if (Sol_path == NULL) ExitError("when allocating memory for the AStarPath", 9);
+        Search_context context;
+        init_search_context(&context, nnodes);
+        AStarPath *Sol_path = context.Sol_path;
+        AStarControlData *Queue_control = context.Queue_control;
 
-        AStarControlData *Queue_control;
-        Queue_control = (AStarControlData *) malloc(nnodes * sizeof(AStarControlData));
-        if (Queue_control == NULL) ExitError("when allocating memory for the AStar Control Data vector", 10);
-        
-        unsigned long index;
-        for (index = 0; index < nnodes; index++) {
-            Sol_path[index].g = DBL_MAX;
-            Queue_control[index].InPQ = false;
-            Queue_control[index].extended = false;
-        }
-        int pq_code = atoi(argv[4]);
+        bool bidirectional;
+        int pq_code = read_search_code(argv[4], &bidirectional);
         int result;
-        if (pq_code == 0) {
-            result = AStar_ll(nodes, Sol_path, Queue_control, initial_node, final_node, heuristic_code);
-        } else if (pq_code == 1) {
-            result = AStar_bh(nodes, Sol_path, Queue_control, nnodes, initial_node, final_node, heuristic_code);
+        if (bidirectional) {
+            Reverse_graph reverse;
+            Search_context backward;
+            build_reverse_graph(nodes, nnodes, &reverse);
+            init_search_context(&backward, nnodes);
+            result = BiAStar(nodes, &reverse, &context, &backward, initial_node, final_node, heuristic_code, pq_code, NULL, NULL);
+            free_search_context(&backward);
+            free_reverse_graph(&reverse);
         } else {
-            ExitError("wrong pq_code. Must be 0 or 1", 11);
+            result = AStar(nodes, &context, initial_node, final_node, heuristic_code, pq_code, NULL, NULL);
         }
 
         if (result == -1) ExitError("in allocating memory for the PQ list in AStar", 12);
@@ -230,139 +229,86 @@ int main (int argc, char **argv) {
         // 3.1.4. Free allocated memory
         free(path_filename);
         free(control_filename);
-        free(Sol_path);
-        free(Queue_control);
+        free_search_context(&context);
 
     } else if (program_mode == 2) {
         printf("Program mode 2. Preparing memory...\n");
-        unsigned long index, path_index;
-        unsigned long initial_node, final_node;
 
-        Heuristic_Metrics *heuristic_metrics_ll;
-        Heuristic_Metrics *heuristic_metrics_bh;
-        PQ_Metrics *pq_metrics_ll;
-        PQ_Metrics *pq_metrics_bh;
-        heuristic_metrics_ll = (Heuristic_Metrics *) malloc(npaths * sizeof(Heuristic_Metrics));
-        heuristic_metrics_bh = (Heuristic_Metrics *) malloc(npaths * sizeof(Heuristic_Metrics));
-        pq_metrics_ll = (PQ_Metrics *) malloc(npaths * sizeof(PQ_Metrics));
-        pq_metrics_bh = (PQ_Metrics *) malloc(npaths * sizeof(PQ_Metrics));
-        if (heuristic_metrics_ll == NULL) ExitError("when allocating memory for heuristic metrics ll", 16);
-        if (heuristic_metrics_bh == NULL) ExitError("when allocating memory for heuristic metrics bh", 17);
-        if (pq_metrics_ll == NULL) ExitError("when allocating memory for pq metrics ll", 18);
-        if (pq_metrics_bh == NULL) ExitError("when allocating memory for pq metrics bh", 19);
-
-
-        printf("Iterating over every path...\n");
-        for (path_index = 0; path_index < npaths; path_index++) {
-            // 3.2.1. Choose initial node and final node
-            initial_node = paths[path_index].start_node.node_id;
-            final_node = paths[path_index].final_node->node_id;
-
-            // 3.2.2. A* algorithm
-            printf("\rFinding solution for path %lu out of %lu", path_index + 1, npaths);
-
-            // 3.2.3.1. Initialize metrics
-            heuristic_metrics_ll[path_index].path_id = paths[path_index].id;
-            heuristic_metrics_bh[path_index].path_id = paths[path_index].id;
-            // Distance computed with haversine formula
-            double sep_km = distance_km(nodes[initial_node].lon, nodes[initial_node].lat, nodes[final_node].lon, nodes[final_node].lat);
-            heuristic_metrics_ll[path_index].sep_km = sep_km;
-            heuristic_metrics_bh[path_index].sep_km = sep_km;
-            heuristic_metrics_ll[path_index].nexpanded = 0;
-            heuristic_metrics_bh[path_index].nexpanded = 0;
-            heuristic_metrics_ll[path_index].calculus_time = 0.;
-            heuristic_metrics_bh[path_index].calculus_time = 0.;
-
-            pq_metrics_ll[path_index].path_id = paths[path_index].id;
-            pq_metrics_bh[path_index].path_id = paths[path_index].id;
-            pq_metrics_ll[path_index].enqueue_time = 0.;
-            pq_metrics_bh[path_index].enqueue_time = 0.;
-            pq_metrics_ll[path_index].dequeue_time = 0.;
-            pq_metrics_bh[path_index].dequeue_time = 0.;
-            pq_metrics_ll[path_index].requeue_time = 0.;
-            pq_metrics_bh[path_index].requeue_time = 0.;
-            pq_metrics_ll[path_index].sep_km = sep_km;
-            pq_metrics_bh[path_index].sep_km = sep_km;
-
-            // 3.2.3.2. Initialize AStar structures
-            AStarPath *Sol_path_ll;
-            AStarPath *Sol_path_bh;
-            Sol_path_ll = (AStarPath *) malloc(nnodes * sizeof(AStarPath));
-            Sol_path_bh = (AStarPath *) malloc(nnodes * sizeof(AStarPath));
-            if (Sol_path_ll == NULL) ExitError("when allocating memory for the AStarPath Linked List", 20);
-            if (Sol_path_bh == NULL) ExitError("when allocating memory for the AStarPath Binary Heap", 21);
-
-            AStarControlData *Queue_control_ll;
-            AStarControlData *Queue_control_bh;
-            Queue_control_ll = (AStarControlData *) malloc(nnodes * sizeof(AStarControlData));
-            Queue_control_bh = (AStarControlData *) malloc(nnodes * sizeof(AStarControlData));
-            if (Queue_control_ll == NULL) ExitError("when allocating memory for the AStar Control Data vector Linked List", 22);
-            if (Queue_control_bh == NULL) ExitError("when allocating memory for the AStar Control Data vector Binary Heap", 23);
-
-            for (index = 0; index < nnodes; index++) {
-                Sol_path_ll[index].g = DBL_MAX;
-                Sol_path_bh[index].g = DBL_MAX;
-                Queue_control_ll[index].InPQ = false;
-                Queue_control_bh[index].InPQ = false;
-                Queue_control_ll[index].extended = false;
-                Queue_control_bh[index].extended = false;
+        // 3.2.1. Read the threads, all the processors by default, and the Priority Queues to run, both the Linked List
+        // and the Binary Heap by default
+        int nthreads, nqueues, queue;
+        int *pq_codes;
+        bool *bidirectional, any_bidirectional;
+        char **pq_names;
+        nthreads = (argc > 6) ? atoi(argv[6]) : 0;
+        nqueues = (argc > 7) ? argc - 7 : 2;
+        pq_codes = (int *) malloc(nqueues * sizeof(int));
+        bidirectional = (bool *) malloc(nqueues * sizeof(bool));
+        pq_names = (char **) malloc(nqueues * sizeof(char *));
+        if (pq_codes == NULL || bidirectional == NULL || pq_names == NULL) ExitError("when allocating memory for the pq codes", 16);
+        any_bidirectional = false;
+        for (queue = 0; queue < nqueues; queue++) {
+            if (argc > 7) {
+                pq_codes[queue] = read_search_code(argv[7 + queue], &bidirectional[queue]);
+            } else {
+                pq_codes[queue] = queue;
+                bidirectional[queue] = false;
             }
+            pq_names[queue] = (char *) malloc(16 * sizeof(char));
+            if (pq_names[queue] == NULL) ExitError("when allocating memory for the pq names", 17);
+            snprintf(pq_names[queue], 16, bidirectional[queue] ? "%s BIDIR" : "%s", pq_name(pq_codes[queue]));
+            any_bidirectional = any_bidirectional || bidirectional[queue];
+        }
 
-            // 3.2.3.3. With Linked List Priority Queue
-            int result;
-            unsigned long curr_node;
-            result = AStar_ll_metrics(nodes, Sol_path_ll, Queue_control_ll, initial_node, final_node, heuristic_code, &heuristic_metrics_ll[path_index], &pq_metrics_ll[path_index]);
-            if (result == -1) ExitError("in allocating memory for the PQ list in AStar Linked List", 24);
-            else if(result == 0) ExitError("no solution found in AStar", 25);
-            heuristic_metrics_ll[path_index].solution_cost = Sol_path_ll[final_node].g;
-            curr_node = final_node;
-            while (curr_node != initial_node) {
-                heuristic_metrics_ll[path_index].nsolution += 1;
-                curr_node = Sol_path_ll[curr_node].parent;
-            }
-            heuristic_metrics_ll[path_index].nsolution += 1;
-            pq_metrics_ll[path_index].nsolution = heuristic_metrics_ll[path_index].nsolution;
-
-            // 3.2.3.4. With Binary Heap Priority Queue
-            result = AStar_bh_metrics(nodes, Sol_path_bh, Queue_control_bh, nnodes, initial_node, final_node, heuristic_code, &heuristic_metrics_bh[path_index], &pq_metrics_bh[path_index]);
-            if (result == -1) ExitError("in allocating memory for the PQ list in AStar Binary Heap", 26);
-            else if(result == 0) ExitError("no solution found in AStar", 27);
-            heuristic_metrics_bh[path_index].solution_cost = Sol_path_bh[final_node].g;
-            curr_node = final_node;
-            while (curr_node != initial_node) {
-                heuristic_metrics_bh[path_index].nsolution += 1;
-                curr_node = Sol_path_bh[curr_node].parent;
-            }
-            heuristic_metrics_bh[path_index].nsolution += 1;
-            pq_metrics_bh[path_index].nsolution = heuristic_metrics_bh[path_index].nsolution;
-
-            // 3.2.3.5. Free allocated memory
-            free(Sol_path_ll);
-            free(Queue_control_ll);
-            free(Sol_path_bh);
-            free(Queue_control_bh);
+        Heuristic_Metrics **heuristic_metrics;
+        PQ_Metrics **pq_metrics;
+        heuristic_metrics = (Heuristic_Metrics **) malloc(nqueues * sizeof(Heuristic_Metrics *));
+        pq_metrics = (PQ_Metrics **) malloc(nqueues * sizeof(PQ_Metrics *));
+        if (heuristic_metrics == NULL) ExitError("when allocating memory for heuristic metrics", 18);
+        if (pq_metrics == NULL) ExitError("when allocating memory for pq metrics", 19);
+        for (queue = 0; queue < nqueues; queue++) {
+            heuristic_metrics[queue] = (Heuristic_Metrics *) malloc(npaths * sizeof(Heuristic_Metrics));
+            pq_metrics[queue] = (PQ_Metrics *) malloc(npaths * sizeof(PQ_Metrics));
+            if (heuristic_metrics[queue] == NULL) ExitError("when allocating memory for heuristic metrics", 18);
+            if (pq_metrics[queue] == NULL) ExitError("when allocating memory for pq metrics", 19);
         }
 
-        // 3.1.5. Store the metrics
+        // 3.2.2. Run the queries of every path, in parallel with a search context per thread
+        // The incoming edges are built once for all the bidirectional searches
+        Reverse_graph reverse;
+        if (any_bidirectional) build_reverse_graph(nodes, nnodes, &reverse);
+        run_queries(nodes, nnodes, paths, npaths, any_bidirectional ? &reverse : NULL, heuristic_code, pq_codes, bidirectional,
+                    nqueues, nthreads, heuristic_metrics, pq_metrics);
+        if (any_bidirectional) free_reverse_graph(&reverse);
+
+        // 3.2.3. Store the metrics
         printf("\nStoring heuristic metrics...\n");
         char *heuristic_filename;
         heuristic_filename = strdup(argv[4]);
         if (heuristic_filename == NULL) ExitError("when copying the name of the heuristic metrics file", 28);
 
-        store_heuristic_metrics(heuristic_metrics_ll, heuristic_metrics_bh, npaths, heuristic_filename);
+        store_heuristic_metrics(heuristic_metrics, (const char **) pq_names, nqueues, npaths, heuristic_filename);
 
         printf("\nStoring Priority Queue metrics...\n");
         char *pq_filename;
         pq_filename = strdup(argv[5]);
         if (pq_filename == NULL) ExitError("when copying the name of the pq metrics file", 28);
 
-        store_pq_metrics(pq_metrics_ll, pq_metrics_bh, npaths, pq_filename);
+        store_pq_metrics(pq_metrics, (const char **) pq_names, nqueues, npaths, pq_filename);
 
-        // 3.1.6. Free allocated memory
-        free(heuristic_metrics_ll);
-        free(heuristic_metrics_bh);
-        free(pq_metrics_ll);
-        free(pq_metrics_bh);
+        // 3.2.4. Free allocated memory
+        for (queue = 0; queue < nqueues; queue++) {
+            free(heuristic_metrics[queue]);
+            free(pq_metrics[queue]);
+            free(pq_names[queue]);
+        }
+        free(heuristic_metrics);
+        free(pq_metrics);
+        free(pq_codes);
+        free(bidirectional);
+        free(pq_names);
+        free(heuristic_filename);
+        free(pq_filename);
     } else {
         ExitError("wrong program mode", 29);
     }
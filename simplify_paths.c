@@ -0,0 +1,146 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$    SIMPLIFY_PATHS.C VERSION 1.0    $$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Compilation:
+        >> gcc -o simplify -W -Wall -Werror simplify_paths.c libs/graph_management.c libs/simplification.c -lm
+
+    - Usage:
+        >> ./simplify stored_graph.bin simplified_graph.bin tolerance_in_km max_edge_time_in_s (+ stop_radius_in_km stop_min_time_in_s)
+
+    - Output:
+        >> The simplified graph in simplified_graph.bin
+
+    - Comments:
+        >> This program removes the nodes of every path that can be approximated by the kept ones within
+            the tolerance distance, using a time-aware Douglas-Peucker algorithm.
+        >> The travelling times of the removed edges are added to the new edge, so the cost of the paths is preserved.
+        >> An edge is never merged if the result would last more than max_edge_time seconds. Use 0 to disable it.
+        >> Optionally, the stationary episodes (ships at anchor or berth) are compressed before the simplification.
+            Every sequence of nodes that stays within stop_radius km during, at least, stop_min_time seconds
+            is collapsed into a single node at its centroid, and the dwell time is kept in its adjacent edge.
+        >> It is meant to be executed between the filter and the intersections computation.
+        >> The intersections speedup is estimated as the ratio of the number of edge pairs of the same shiptype,
+            before and after the simplification. The bounding box pruning is not taken into account.
+
+    - Further development:
+
+    - Status:
+        >> Finished.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libs/graph_management.h"
+#include "libs/simplification.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 5) ExitError("Inputs missing to the program", 1);
+
+    // 1. Read the binary file
+    printf("Reading bin file...\n");
+
+    Node *nodes;
+    Path *paths;
+    unsigned long nnodes, nedges, npaths;
+    char *bin_filename;
+
+    nodes = NULL;
+    paths = NULL;
+    bin_filename = strdup(argv[1]);
+    if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
+    read_nodes(&nodes, &paths, &nnodes, &nedges, &npaths, bin_filename);
+
+    char *end_ptr;
+    double tolerance, max_edge_time, stop_radius, stop_min_time;
+    tolerance = strtod(argv[3], &end_ptr);
+    max_edge_time = strtod(argv[4], &end_ptr);
+    stop_radius = 0.;
+    stop_min_time = 0.;
+    if (argc > 6) {
+        stop_radius = strtod(argv[5], &end_ptr);
+        stop_min_time = strtod(argv[6], &end_ptr);
+    }
+
+    unsigned char *keep;
+    keep = (unsigned char *) malloc(nnodes * sizeof(unsigned char));
+    if (keep == NULL) ExitError("when allocating memory for the kept nodes", 3);
+
+    unsigned long index;
+    unsigned short last_pc;
+    Node *new_nodes;
+    Path *new_paths;
+    unsigned long new_nnodes, new_nedges;
+
+    // 2. Compress the stationary episodes of every path
+    Node *stop_nodes;
+    Path *stop_paths;
+    unsigned long stop_nnodes, stop_nedges, nstops;
+
+    stop_nodes = nodes;
+    stop_paths = paths;
+    stop_nnodes = nnodes;
+    stop_nedges = nedges;
+    if (stop_radius > 0) {
+        printf("Compressing stationary episodes...\n");
+        nstops = 0;
+        last_pc = 0;
+        for (index = 0; index < npaths; index++) {
+            nstops += compress_stops(nodes, &paths[index], stop_radius, stop_min_time, keep);
+            print_progress_bar(index + 1, npaths, &last_pc);
+        }
+        compact_graph(nodes, paths, npaths, keep, &stop_nodes, &stop_paths, &stop_nnodes, &stop_nedges);
+        printf("Stationary episodes: %lu (%lu nodes removed)\n", nstops, nnodes - stop_nnodes);
+    }
+
+    // 3. Simplify every path
+    printf("Simplifying paths...\n");
+    last_pc = 0;
+    for (index = 0; index < npaths; index++) {
+        simplify_path(stop_nodes, &stop_paths[index], tolerance, max_edge_time, keep);
+        print_progress_bar(index + 1, npaths, &last_pc);
+    }
+
+    printf("Compacting graph...\n");
+    compact_graph(stop_nodes, stop_paths, npaths, keep, &new_nodes, &new_paths, &new_nnodes, &new_nedges);
+
+    if (stop_radius > 0) {
+        free_paths(stop_paths, npaths);
+        free_nodes(stop_nodes, stop_nnodes);
+    }
+
+    // 4. Report the reduction
+    double work, new_work;
+    work = segment_pairs_work(paths, npaths);
+    new_work = segment_pairs_work(new_paths, npaths);
+
+    printf("Nodes: %lu -> %lu (%.2f %% removed)\n", nnodes, new_nnodes,
+            nnodes ? 100. * (double) (nnodes - new_nnodes) / (double) nnodes : 0.);
+    printf("Segments: %lu -> %lu (%.2f %% removed)\n", nedges, new_nedges,
+            nedges ? 100. * (double) (nedges - new_nedges) / (double) nedges : 0.);
+    printf("Estimated intersections speedup: %.2f (%g -> %g edge pairs)\n",
+            new_work > 0 ? work / new_work : 1., work, new_work);
+
+    // 5. Store the simplified graph
+    printf("Storing graph...\n");
+
+    char *bin_new_filename;
+    bin_new_filename = strdup(argv[2]);
+    if (bin_new_filename == NULL) ExitError("when copying the binary new filename", 4);
+    store_nodes(new_nodes, new_paths, new_nnodes, new_nedges, npaths, bin_new_filename);
+
+    // 6. Free allocated memory
+    printf("Freeing memory...\n");
+
+    free(keep);
+    free(bin_filename);
+    free(bin_new_filename);
+    free_paths(new_paths, npaths);
+    free_nodes(new_nodes, new_nnodes);
+    free_paths(paths, npaths);
+    free_nodes(nodes, nnodes);
+    return 0;
+}
@@ -7,7 +7,7 @@
         >> gcc -o store store_graph.c libs/graph_management.c -lm
 
     - Usage:
-        >> ./store data_input.csv shiptypes_counter.txt program_mode (+ additonal)
+        >> ./store data_input.csv shiptypes_counter.txt program_mode (+ additonal) (+ max_time_gap_in_s max_jump_in_km max_speed_in_kn)
         >> For program mode:
             >> 0: data_output.bin
             >> 1: nshiptypes data_output_1.bin  shiptype1 data_output_2.bin shiptype2 ...
@@ -23,6 +23,10 @@
         >> The node id and path id are given by order of appearance.
         >> Edges are unidirectional and are created only when two adjacent nodes belong to the same shipname.
         >> The path nodes are stored through a linked list.
+        >> Optionally, the track of a ship is split in different paths (voyages) when two adjacent nodes are separated
+            more than max_time_gap seconds or max_jump kilometers, so the bounding boxes of the paths are smaller. Use 0 to disable any of them.
+        >> Optionally, the nodes at invalid coordinates or whose implied speed with the neighbour nodes of the ship is greater than
+            max_speed knots are removed as outliers before computing the edges and paths. Use 0 to disable it.
 
     
     - Further development:
@@ -62,7 +66,23 @@ int main (int argc, char *argv[]) {
     new_nnodes = nnodes_in_csv(csv_file);
     rewind(csv_file);
 
-    // 1.3. Compute the nodes, edges and paths
+    // 1.3. Read the voyages and outliers thresholds, placed after the arguments of the program mode
+    int program_mode, i_voyage_args;
+    double max_time_gap, max_jump, max_speed;
+    program_mode = atoi(argv[3]);
+    if (program_mode == 1) i_voyage_args = 5 + 2 * atoi(argv[4]);
+    else i_voyage_args = 5;
+
+    max_time_gap = 0.;
+    max_jump = 0.;
+    if (argc > i_voyage_args + 1) {
+        max_time_gap = strtod(argv[i_voyage_args], NULL);
+        max_jump = strtod(argv[i_voyage_args + 1], NULL);
+    }
+    max_speed = 0.;
+    if (argc > i_voyage_args + 2) max_speed = strtod(argv[i_voyage_args + 2], NULL);
+
+    // 1.4. Compute the nodes, edges and paths
     printf("Computing the data of the file...\n");
     unsigned long nnodes, nedges, npaths;
     nnodes = 0;
@@ -77,7 +97,7 @@ int main (int argc, char *argv[]) {
     if (nodes == NULL) ExitError("when allocating memory for nodes", 3);
     if (paths == NULL) ExitError("when allocating memory for paths", 4);
 
-    add_nodes_from_csv(nodes, paths, new_nnodes, &nnodes, &nedges, &npaths, csv_file);
+    add_nodes_from_csv(nodes, paths, new_nnodes, &nnodes, &nedges, &npaths, max_time_gap, max_jump, max_speed, csv_file);
     fclose(csv_file);
 
     // 3. Count the number of paths for every shiptype
@@ -106,7 +126,6 @@ int main (int argc, char *argv[]) {
     // 5. Store the graph
     printf("Storing graph with %lu nodes, %lu edges and %lu paths...\n", nnodes, nedges, npaths);
 
-    int program_mode = atoi(argv[3]);
     if (program_mode == 0) {
         printf("Program mode 0 selected...\n");
         char *bin_filename;
@@ -0,0 +1,77 @@
+/*
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$    TILE_INTERSECTIONS.C VERSION 1.0    $$$$$$$$$$$$$$
+    $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
+
+    - Compilation:
+        >> gcc -o tile_int -W -Wall -Werror tile_intersections.c libs/graph_management.c libs/intersections.c libs/sweep_line.c libs/segment_kernel.c libs/tiles.c -lm -lpthread
+
+    - Usage:
+        >> ./tile_int stored_graph.bin data_output.bin counter_filename.txt (+ memory_budget_in_MB)
+
+    - Output:
+        >> The graph that is stored in data_output.bin.
+        >> The counter of intersections per each path in counter_filename.txt
+
+    - Comments:
+        >> This program computes the intersections of a stored graph too big to be read at once, as add_int does.
+        >> The original edges are distributed into spatial tiles stored in a temporary file, and only one tile is read at a time.
+            The tiles are chosen so the most loaded one fits in the memory budget (1024 MB by default). The edges near the
+            border of a tile are also stored in the neighbour ones, and every crossing is kept only by one of them.
+        >> The crossings of every tile are found with the segment kernel, as the vectorised loop engine of add_int.
+        >> The crossings are spliced while the graph is copied section by section to the output, so the resulting graph
+            is the same as with any engine of add_int, with the edges that touch or overlap resolved too. Only the crossings
+            and the original nodes whose edges change are kept in memory.
+        >> The temporary file is created by tmpfile, in the temporary directory of the system.
+
+    - Further development:
+
+    - Status:
+        >> Finished
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "libs/graph_management.h"
+#include "libs/sweep_line.h"
+#include "libs/intersections.h"
+#include "libs/segment_kernel.h"
+#include "libs/tiles.h"
+
+int main (int argc, char *argv[]) {
+    if (argc < 4) ExitError("Inputs missing to the program", 1);
+
+    // 1. Read the arguments
+    char *bin_filename, *bin_new_filename, *counter_filename;
+    char *end_ptr;
+    double memory_budget;
+
+    bin_filename = strdup(argv[1]);
+    if (bin_filename == NULL) ExitError("when copying the binary filename", 2);
+    bin_new_filename = strdup(argv[2]);
+    if (bin_new_filename == NULL) ExitError("when copying the binary new filename", 3);
+    counter_filename = strdup(argv[3]);
+    if (counter_filename == NULL) ExitError("when copying the counter filename", 4);
+
+    memory_budget = 1024.;
+    if (argc > 4) memory_budget = strtod(argv[4], &end_ptr);
+    if (memory_budget <= 0) ExitError("the memory budget must be positive", 5);
+
+    // 2. Compute the intersections tile by tile and store the graph
+    printf("Computing intersections by tiles...\n");
+
+    Intersections_counter counter;
+    tiled_intersections(bin_filename, bin_new_filename, counter_filename, memory_budget * 1024. * 1024., &counter);
+    printf("Computed intersections: %lu\nTouching intersections: %lu\nIgnored intersections: %lu\n", counter.computed,
+            counter.touching, counter.ignored);
+
+    // 3. Free allocated memory
+    free(bin_filename);
+    free(bin_new_filename);
+    free(counter_filename);
+
+    return 0;
+}